@@ -0,0 +1,382 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * batchanalysis.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "batchanalysis.hpp"
+#include "search.hpp"
+#include "clustertt.hpp"
+#include "history.hpp"
+#include "killerTable.hpp"
+#include "moveGen.hpp"
+#include "textio.hpp"
+#include "threadpool.hpp"
+#include "parameters.hpp"
+#include "treeLogger.hpp"
+#include "timeUtil.hpp"
+#include "util.hpp"
+
+#include <iostream>
+#include <cmath>
+
+
+/** Keeps track of the last reported PV for each multi-PV line. */
+class BatchAnalysis::PVCollector : public Search::Listener {
+public:
+    struct PVInfo {
+        int depth = 0;
+        int score = 0;
+        bool isMate = false;
+        bool upperBound = false;
+        bool lowerBound = false;
+        std::vector<Move> pv;
+    };
+    std::vector<PVInfo> pvs;
+
+    void notifyDepth(int depth) override {}
+    void notifyCurrMove(const Move& m, int moveNr) override {}
+    void notifyPV(int depth, int score, S64 time, S64 nodes, S64 nps, bool isMate,
+                  bool upperBound, bool lowerBound, const std::vector<Move>& pv,
+                  int multiPVIndex, S64 tbHits) override {
+        size_t idx = std::max(multiPVIndex, 0);
+        if (pvs.size() <= idx)
+            pvs.resize(idx + 1);
+        PVInfo& pi = pvs[idx];
+        pi.depth = depth;
+        pi.score = score;
+        pi.isMate = isMate;
+        pi.upperBound = upperBound;
+        pi.lowerBound = lowerBound;
+        pi.pv = pv;
+    }
+    void notifyStats(S64 nodes, S64 nps, int hashFull, S64 tbHits, S64 time) override {}
+    void notifyInfoString(const std::string& str) override {}
+};
+
+void
+BatchAnalysis::main(int nThreads, int hashSizeMB) {
+    BatchAnalysis ba(std::cin, std::cout, nThreads, hashSizeMB);
+    ba.run();
+}
+
+BatchAnalysis::BatchAnalysis(std::istream& is, std::ostream& os, int nThreads,
+                             int hashSizeMB)
+    : is(is), os(os), nThreads(std::max(nThreads, 1)), tt(1024) {
+    U64 nEntries = ((U64)std::max(hashSizeMB, 1)) * (1 << 20) / sizeof(TranspositionTable::TTEntry);
+    while (nEntries > 1024) {
+        try {
+            tt.reSize(nEntries, this->nThreads);
+            break;
+        } catch (const std::bad_alloc&) {
+            nEntries /= 2;
+        }
+    }
+}
+
+void
+BatchAnalysis::run() {
+    ThreadPool<int> pool(nThreads);
+    for (int i = 0; i < nThreads; i++)
+        pool.addTask([this](int workerNo) { workerLoop(workerNo); return 0; });
+
+    std::string line;
+    int jobNo = 0;
+    while (std::getline(is, line)) {
+        line = trim(line);
+        if (line.empty())
+            continue;
+        if (line == "quit")
+            break;
+        if (line == "stats") {
+            writeStats(false);
+            continue;
+        }
+        Job job;
+        job.id = num2Str(++jobNo);
+        job.tQueued = currentTimeMillis();
+        std::string error;
+        if (!parseJob(line, job, error)) {
+            {
+                std::lock_guard<std::mutex> L(outMutex);
+                nErrors++;
+            }
+            writeLine("{\"id\":" + jsonString(job.id) + ",\"error\":" + jsonString(error) + "}");
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> L(outMutex);
+            if (tStart < 0)
+                tStart = job.tQueued;
+        }
+        {
+            std::lock_guard<std::mutex> L(mutex);
+            queue.push_back(std::move(job));
+        }
+        cv.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> L(mutex);
+        inputDone = true;
+    }
+    cv.notify_all();
+    pool.getAllResults([](int){});
+    writeStats(true);
+}
+
+bool
+BatchAnalysis::parseJob(const std::string& line, Job& job, std::string& error) const {
+    std::vector<std::string> tokens;
+    splitString(line, tokens);
+    const int nTok = tokens.size();
+    auto isKeyword = [](const std::string& s) {
+        return s == "id" || s == "fen" || s == "startpos" || s == "moves" ||
+               s == "depth" || s == "nodes" || s == "movetime" || s == "multipv";
+    };
+
+    std::string fen;
+    std::vector<std::string> moveStrs;
+    int idx = 0;
+    while (idx < nTok) {
+        const std::string& tok = tokens[idx++];
+        if (tok == "startpos") {
+            fen = TextIO::startPosFEN;
+        } else if (tok == "fen") {
+            std::string sb;
+            while ((idx < nTok) && !isKeyword(tokens[idx])) {
+                sb += tokens[idx++];
+                sb += ' ';
+            }
+            fen = trim(sb);
+        } else if (tok == "moves") {
+            while ((idx < nTok) && !isKeyword(tokens[idx]))
+                moveStrs.push_back(tokens[idx++]);
+        } else if (idx >= nTok) {
+            error = "Missing value for " + tok;
+            return false;
+        } else if (tok == "id") {
+            job.id = tokens[idx++];
+        } else {
+            const std::string& val = tokens[idx++];
+            bool ok = false;
+            if (tok == "depth")
+                ok = str2Num(val, job.depth) && job.depth > 0;
+            else if (tok == "nodes")
+                ok = str2Num(val, job.nodes) && job.nodes > 0;
+            else if (tok == "movetime")
+                ok = str2Num(val, job.moveTime) && job.moveTime > 0;
+            else if (tok == "multipv")
+                ok = str2Num(val, job.multiPV) && job.multiPV > 0;
+            else {
+                error = "Unknown token: " + tok;
+                return false;
+            }
+            if (!ok) {
+                error = "Invalid " + tok + ": " + val;
+                return false;
+            }
+        }
+    }
+    if (fen.empty()) {
+        error = "No position given";
+        return false;
+    }
+    if ((job.depth < 0) && (job.nodes < 0) && (job.moveTime < 0)) {
+        error = "No search limit given";
+        return false;
+    }
+
+    try {
+        job.pos = TextIO::readFEN(fen);
+    } catch (ChessParseError& ex) {
+        error = ex.what();
+        return false;
+    }
+    UndoInfo ui;
+    for (const std::string& ms : moveStrs) {
+        MoveList moves;
+        MoveGen::pseudoLegalMoves(job.pos, moves);
+        MoveGen::removeIllegal(job.pos, moves);
+        bool found = false;
+        for (int i = 0; i < moves.size; i++) {
+            if (TextIO::moveToUCIString(moves[i]) == ms) {
+                job.posHashList.push_back(job.pos.zobristHash());
+                job.pos.makeMove(moves[i], ui);
+                if (job.pos.getHalfMoveClock() == 0)
+                    job.posHashList.clear();
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            error = "Illegal move: " + ms;
+            return false;
+        }
+    }
+    if (job.posHashList.size() > 100)
+        job.posHashList.clear();
+    job.posHashListSize = job.posHashList.size();
+    job.posHashList.resize(job.posHashListSize + SearchConst::MAX_SEARCH_DEPTH * 2);
+    return true;
+}
+
+void
+BatchAnalysis::workerLoop(int workerNo) {
+    Notifier notifier;
+    ThreadCommunicator comm(nullptr, tt, notifier, false);
+    KillerTable kt;
+    History ht;
+    Evaluate::EvalHashTables et;
+    TreeLogger treeLog;
+    Search::SearchTables st(comm.getCTT(), kt, ht, et);
+    const int minProbeDepth = UciParams::minProbeDepth->getIntPar();
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> L(mutex);
+            cv.wait(L, [this]() { return !queue.empty() || inputDone; });
+            if (queue.empty())
+                break;
+            job = std::move(queue.front());
+            queue.pop_front();
+            // Age the hash table once for every nThreads started jobs, so that
+            // entries from finished jobs are replaced before entries that jobs
+            // still running in other threads depend on.
+            if (++nStarted % nThreads == 0)
+                tt.nextGeneration();
+        }
+
+        MoveList moves;
+        MoveGen::pseudoLegalMoves(job.pos, moves);
+        MoveGen::removeIllegal(job.pos, moves);
+
+        S64 t0 = currentTimeMillis();
+        PVCollector pvc;
+        Move bestMove;
+        S64 nodes = 0;
+        if (moves.size > 0) {
+            ht.init();
+            Search sc(job.pos, job.posHashList, job.posHashListSize, st, comm, treeLog);
+            sc.setListener(pvc);
+            sc.timeLimit(job.moveTime, job.moveTime, -1, t0);
+            // A depth limit is always passed, because an unlimited search would
+            // generate in-memory tablebases, which uses the table non-concurrently.
+            int maxDepth = job.depth > 0 ? job.depth : SearchConst::MAX_SEARCH_DEPTH;
+            int multiPV = std::min(job.multiPV, moves.size);
+            bestMove = sc.iterativeDeepening(moves, maxDepth, job.nodes, multiPV,
+                                             false, minProbeDepth);
+            nodes = sc.getTotalNodesThisThread();
+        }
+        S64 t1 = currentTimeMillis();
+
+        std::stringstream ss;
+        ss << "{\"id\":" << jsonString(job.id) << ",\"bestmove\":";
+        if (bestMove.isEmpty())
+            ss << "null";
+        else
+            ss << jsonString(TextIO::moveToUCIString(bestMove));
+        int depth = pvc.pvs.empty() ? 0 : pvc.pvs[0].depth;
+        ss << ",\"depth\":" << depth << ",\"nodes\":" << nodes
+           << ",\"timeMs\":" << (t1 - t0) << ",\"latencyMs\":" << (t1 - job.tQueued)
+           << ",\"pvs\":[";
+        for (size_t i = 0; i < pvc.pvs.size(); i++) {
+            const PVCollector::PVInfo& pi = pvc.pvs[i];
+            if (i > 0)
+                ss << ',';
+            ss << "{\"multipv\":" << (i + 1) << ",\"depth\":" << pi.depth
+               << ",\"score\":{\"" << (pi.isMate ? "mate" : "cp") << "\":" << pi.score << '}';
+            if (pi.upperBound)
+                ss << ",\"bound\":\"upper\"";
+            else if (pi.lowerBound)
+                ss << ",\"bound\":\"lower\"";
+            ss << ",\"pv\":[";
+            for (size_t j = 0; j < pi.pv.size(); j++) {
+                if (j > 0)
+                    ss << ',';
+                ss << jsonString(TextIO::moveToUCIString(pi.pv[j]));
+            }
+            ss << "]}";
+        }
+        ss << "]}";
+
+        {
+            std::lock_guard<std::mutex> L(outMutex);
+            latency.push_back((int)(t1 - job.tQueued));
+            totalNodes += nodes;
+        }
+        writeLine(ss.str());
+    }
+}
+
+void
+BatchAnalysis::writeLine(const std::string& line) {
+    std::lock_guard<std::mutex> L(outMutex);
+    os << line << std::endl;
+}
+
+void
+BatchAnalysis::writeStats(bool final) {
+    std::lock_guard<std::mutex> L(outMutex);
+    std::vector<int> sorted(latency);
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) -> int {
+        if (sorted.empty())
+            return 0;
+        int idx = (int)std::ceil(p * sorted.size()) - 1;
+        return sorted[clamp(idx, 0, (int)sorted.size() - 1)];
+    };
+
+    const int nJobs = sorted.size();
+    S64 elapsed = tStart < 0 ? 0 : currentTimeMillis() - tStart;
+    double posPerHour = elapsed > 0 ? nJobs * 3600e3 / elapsed : 0;
+    S64 nps = elapsed > 0 ? (S64)(totalNodes / (elapsed / 1000.0)) : 0;
+    os << "{\"stats\":{\"final\":" << (final ? "true" : "false")
+       << ",\"jobs\":" << nJobs << ",\"errors\":" << nErrors
+       << ",\"threads\":" << nThreads << ",\"elapsedMs\":" << elapsed
+       << ",\"positionsPerHour\":" << (S64)std::round(posPerHour)
+       << ",\"nodes\":" << totalNodes << ",\"nps\":" << nps
+       << ",\"latencyMs\":{\"p50\":" << percentile(0.5) << ",\"p90\":" << percentile(0.9)
+       << ",\"p99\":" << percentile(0.99) << ",\"max\":" << percentile(1.0) << "}}}"
+       << std::endl;
+}
+
+std::string
+BatchAnalysis::jsonString(const std::string& s) {
+    std::string ret = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+            ret += c;
+        } else if ((unsigned char)c < 0x20) {
+            static const char* hex = "0123456789abcdef";
+            ret += "\\u00";
+            ret += hex[(c >> 4) & 15];
+            ret += hex[c & 15];
+        } else {
+            ret += c;
+        }
+    }
+    ret += '"';
+    return ret;
+}
@@ -0,0 +1,105 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * batchanalysis.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef BATCHANALYSIS_HPP_
+#define BATCHANALYSIS_HPP_
+
+#include "position.hpp"
+#include "transpositionTable.hpp"
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <iosfwd>
+
+/**
+ * Analyze a stream of positions using a pool of search threads that share one
+ * transposition table. Each input line is one job:
+ *   id <id> (fen <fen> | startpos) [moves <m1> ... <mN>] [depth <d>] [nodes <n>]
+ *      [movetime <ms>] [multipv <k>]
+ * Results are written as one JSON object per line in completion order. The
+ * line "stats" writes throughput and latency statistics, "quit" or end of input
+ * waits for all pending jobs and then writes the final statistics.
+ */
+class BatchAnalysis {
+public:
+    /** Run batch analysis reading from stdin and writing to stdout. */
+    static void main(int nThreads, int hashSizeMB);
+
+    BatchAnalysis(std::istream& is, std::ostream& os, int nThreads, int hashSizeMB);
+
+    /** Process all jobs from the input stream. */
+    void run();
+
+private:
+    struct Job {
+        std::string id;
+        Position pos;
+        std::vector<U64> posHashList;
+        int posHashListSize = 0;
+        int depth = -1;
+        S64 nodes = -1;
+        int moveTime = -1;
+        int multiPV = 1;
+        S64 tQueued = 0;
+    };
+    class PVCollector;
+
+    /** Parse a job line. Return false and set "error" if the line is invalid. */
+    bool parseJob(const std::string& line, Job& job, std::string& error) const;
+
+    /** Take jobs from the queue and analyze them until the queue is closed. */
+    void workerLoop(int workerNo);
+
+    /** Write one line to the output stream. */
+    void writeLine(const std::string& line);
+
+    /** Write throughput and latency statistics for all completed jobs. */
+    void writeStats(bool final);
+
+    static std::string jsonString(const std::string& s);
+
+    std::istream& is;
+    std::ostream& os;
+    const int nThreads;
+    TranspositionTable tt;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Job> queue;     // Jobs waiting for a worker
+    bool inputDone = false;    // True when no more jobs will be added
+    int nStarted = 0;          // Number of jobs taken from the queue
+
+    std::mutex outMutex;
+    S64 tStart = -1;           // Time when the first job was read
+    std::vector<int> latency;  // Queue + search time in ms for completed jobs
+    S64 totalNodes = 0;
+    int nErrors = 0;
+};
+
+#endif /* BATCHANALYSIS_HPP_ */
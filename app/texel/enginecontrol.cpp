@@ -38,6 +38,7 @@
 #include "numa.hpp"
 #include "cluster.hpp"
 #include "clustertt.hpp"
+#include "searchProfile.hpp"
 
 #include <iostream>
 #include <memory>
@@ -67,7 +68,7 @@ EngineMainThread::mainLoop() {
             setupTT();
         });
         UciParams::clearHash->addListener([this]() {
-            tt.clear();
+            tt.clear(UciParams::threads->getIntPar());
         }, false);
         WorkerThread worker(0, nullptr, 1, tt);
         worker.mainLoopCluster(std::move(comm));
@@ -129,7 +130,7 @@ EngineMainThread::setupTT() {
         try {
             if (nEntries < 1)
                 break;
-            tt.reSize(nEntries);
+            tt.reSize(nEntries, UciParams::threads->getIntPar());
             break;
         } catch (const std::bad_alloc&) {
             nEntries /= 2;
@@ -138,13 +139,7 @@ EngineMainThread::setupTT() {
 }
 
 void
-EngineMainThread::startSearch(EngineControl* engineControl,
-                              std::shared_ptr<Search>& sc, const Position& pos,
-                              std::shared_ptr<MoveList>& moves,
-                              bool ownBook, bool analyseMode,
-                              int maxDepth, int maxNodes,
-                              int maxPV, int minProbeDepth,
-                              std::atomic<bool>& ponder, std::atomic<bool>& infinite) {
+EngineMainThread::setupThreads() {
     int nThreads = UciParams::threads->getIntPar();
     if ((UciParams::strength->getIntPar() < 1000) ||
         (UciParams::maxNPS->getIntPar() > 0) ||
@@ -154,7 +149,19 @@ EngineMainThread::startSearch(EngineControl* engineControl,
     std::vector<int> nThreadsChildren;
     Cluster::instance().assignThreads(nThreads, nThreadsThisNode, nThreadsChildren);
     comm->sendAssignThreads(nThreadsThisNode, nThreadsChildren);
-    WorkerThread::createWorkers(1, comm.get(), nThreadsThisNode - 1, tt, children);
+    WorkerThread::createWorkers(0, comm.get(), nThreadsThisNode, tt, children);
+    tt.setTBGenThreads(nThreadsThisNode);
+}
+
+void
+EngineMainThread::startSearch(EngineControl* engineControl,
+                              std::shared_ptr<Search>& sc, const Position& pos,
+                              std::shared_ptr<MoveList>& moves,
+                              bool ownBook, bool analyseMode,
+                              int maxDepth, int maxNodes,
+                              int maxPV, int minProbeDepth,
+                              std::atomic<bool>& ponder, std::atomic<bool>& infinite) {
+    setupThreads();
 
     {
         std::lock_guard<std::mutex> L(mutex);
@@ -216,6 +223,8 @@ EngineMainThread::doSearch() {
     if (m.isEmpty()) {
         m = sc->iterativeDeepening(*moves, maxDepth, maxNodes, maxPV, false,
                                    minProbeDepth, clearHistory);
+        Cluster::instance().addLocalNodes(sc->getTotalNodesThisThread());
+        Cluster::instance().searchStopped();
         waitForStop = true;
     }
     clearHistory = false;
@@ -284,9 +293,14 @@ EngineControl::EngineControl(std::ostream& o, EngineMainThread& engineThread0,
     hashParListenerId = UciParams::hash->addListener([this]() {
         engineThread.setupTT();
     });
+    threadsParListenerId = UciParams::threads->addListener([this]() {
+        if (!Cluster::instance().isEnabled())
+            engineThread.setupThreads();
+    }, false);
     clearHashParListenerId = UciParams::clearHash->addListener([this]() {
-        engineThread.getTT().clear();
+        engineThread.getTT().clear(UciParams::threads->getIntPar());
         ht.init();
+        prevSearch.clear();
         engineThread.setClearHistory();
     }, false);
     opponentParListenerId = UciParams::opponent->addListener([this]() {
@@ -295,15 +309,24 @@ EngineControl::EngineControl(std::ostream& o, EngineMainThread& engineThread0,
     contemptFileParListenerId = UciParams::contemptFile->addListener([this]() {
         setOpponent();
     }, false);
+    auto setTBCache = [this]() {
+        U64 maxBytes = (U64)UciParams::tbGenCacheSize->getIntPar() * 1024 * 1024;
+        engineThread.getTT().setTBCache(UciParams::tbGenCachePath->getStringPar(), maxBytes);
+    };
+    tbGenCachePathParListenerId = UciParams::tbGenCachePath->addListener(setTBCache);
+    tbGenCacheSizeParListenerId = UciParams::tbGenCacheSize->addListener(setTBCache);
 
     et = Evaluate::getEvalHashTables();
 }
 
 EngineControl::~EngineControl() {
     UciParams::hash->removeListener(hashParListenerId);
+    UciParams::threads->removeListener(threadsParListenerId);
     UciParams::clearHash->removeListener(clearHashParListenerId);
     UciParams::opponent->removeListener(opponentParListenerId);
     UciParams::contemptFile->removeListener(contemptFileParListenerId);
+    UciParams::tbGenCachePath->removeListener(tbGenCachePathParListenerId);
+    UciParams::tbGenCacheSize->removeListener(tbGenCacheSizeParListenerId);
 }
 
 void
@@ -450,9 +473,11 @@ void
 EngineControl::startThread(int minTimeLimit, int maxTimeLimit, int earlyStopPercentage,
                            int maxDepth, int maxNodes, S64 startTime) {
     Communicator* comm = engineThread.getCommunicator();
+    SearchProfile::clear();
     Search::SearchTables st(comm->getCTT(), kt, ht, *et);
     sc = std::make_shared<Search>(pos, posHashList, posHashListSize, st, *comm, treeLog);
     sc->setListener(listener);
+    sc->setPrevSearchInfo(&prevSearch);
     sc->setStrength(getStrength(), randomSeed, getMaxNPS());
     std::shared_ptr<MoveList> moves(std::make_shared<MoveList>());
     MoveGen::pseudoLegalMoves(pos, *moves);
@@ -614,6 +639,11 @@ EngineControl::waitReady() {
 
 void
 EngineControl::finishSearch(Position& pos, const Move& bestMove) {
+    if (SearchProfile::enabled()) {
+        SearchProfile::Totals totals;
+        SearchProfile::getTotals(totals);
+        SearchProfile::print(os, totals);
+    }
     Move ponderMove = getPonderMove(pos, bestMove);
     listener.notifyPlayedMove(bestMove, ponderMove);
 }
@@ -32,6 +32,7 @@
 #include "parallel.hpp"
 #include "history.hpp"
 #include "killerTable.hpp"
+#include "search.hpp"
 
 #include <vector>
 #include <map>
@@ -42,7 +43,6 @@
 #include <atomic>
 
 class MoveList;
-class Search;
 class SearchParams;
 class SearchListener;
 class EngineControl;
@@ -65,6 +65,10 @@ public:
     void setupTT();
     TranspositionTable& getTT();
 
+    /** Create or update the helper search threads to match the current UCI
+     *  parameters. Existing threads are reused. */
+    void setupThreads();
+
     /** Tell the search thread to start searching. */
     void startSearch(EngineControl* engineControl,
                      std::shared_ptr<Search>& sc, const Position& pos,
@@ -182,15 +186,19 @@ private:
     std::ostream& os;
 
     int hashParListenerId;
+    int threadsParListenerId;
     int clearHashParListenerId;
     int opponentParListenerId;
     int contemptFileParListenerId;
+    int tbGenCachePathParListenerId;
+    int tbGenCacheSizeParListenerId;
 
     EngineMainThread& engineThread;
     SearchListener& listener;
     std::shared_ptr<Search> sc;
     KillerTable kt;
     History ht;
+    Search::PrevSearchInfo prevSearch;
     std::unique_ptr<Evaluate::EvalHashTables> et;
     TreeLogger treeLog;
     int opponentBasedContempt = 0;
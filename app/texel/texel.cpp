@@ -23,6 +23,7 @@
  *      Author: petero
  */
 
+#include "batchanalysis.hpp"
 #include "computerPlayer.hpp"
 #include "humanPlayer.hpp"
 #include "tuigame.hpp"
@@ -30,9 +31,13 @@
 #include "uciprotocol.hpp"
 #include "numa.hpp"
 #include "cluster.hpp"
+#include "parameters.hpp"
+#include "util.hpp"
 
+#include <iostream>
 #include <memory>
 #include <string>
+#include <thread>
 
 using namespace std::string_literals;
 
@@ -48,6 +53,15 @@ int main(int argc, char* argv[]) {
         game.play();
     } else if ((argc == 3) && (argv[1] == "tree"s)) {
         TreeLoggerReader::main(argv[2]);
+    } else if ((argc >= 2) && (argc <= 4) && (argv[1] == "batch"s)) {
+        int nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        int hashSizeMB = UciParams::hash->getIntPar();
+        if ((argc > 2) && (!str2Num(argv[2], nThreads) || nThreads < 1))
+            std::cerr << "Invalid number of threads: " << argv[2] << std::endl;
+        else if ((argc > 3) && (!str2Num(argv[3], hashSizeMB) || hashSizeMB < 1))
+            std::cerr << "Invalid hash size: " << argv[3] << std::endl;
+        else
+            BatchAnalysis::main(nThreads, hashSizeMB);
     } else {
         if ((argc == 2) && (argv[1] == "-nonuma"s))
             Numa::instance().disable();
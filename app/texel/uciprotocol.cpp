@@ -29,6 +29,7 @@
 #include "textio.hpp"
 #include "logger.hpp"
 #include "cluster.hpp"
+#include "searchStats.hpp"
 
 #include <iostream>
 
@@ -83,6 +84,11 @@ SearchListener::notifyStats(S64 nodes, S64 nps, int hashFull, S64 tbHits, S64 ti
     os << " time " << time << std::endl;
 }
 
+void
+SearchListener::notifyInfoString(const std::string& str) {
+    os << "info string " << str << std::endl;
+}
+
 void
 SearchListener::notifyPlayedMove(const Move& bestMove, const Move& ponderMove) {
     os << "bestmove " << moveToString(bestMove);
@@ -292,6 +298,17 @@ UCIProtocol::handleCommand(const std::string& cmdLine, std::ostream& os) {
                 engine->stopSearch();
         } else if (cmd == "ponderhit") {
             engine->ponderHit();
+        } else if (cmd == "stats") {
+            if ((nTok > 1) && (tokens[1] == "clear")) {
+                SearchStats::clear();
+            } else if (!SearchStats::enabled()) {
+                os << "info string search statistics not available, "
+                      "compile with USE_SEARCH_STATS" << std::endl;
+            } else {
+                SearchStats::Totals totals;
+                SearchStats::getTotals(totals);
+                os << "info string stats " << SearchStats::toString(totals) << std::endl;
+            }
         } else if (cmd == "quit") {
             if (engine)
                 engine->stopSearch();
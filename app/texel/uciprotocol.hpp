@@ -51,6 +51,8 @@ public:
 
     void notifyStats(S64 nodes, S64 nps, int hashFull, S64 tbHits, S64 time) override;
 
+    void notifyInfoString(const std::string& str) override;
+
     void notifyPlayedMove(const Move& bestMove, const Move& ponderMove);
 
 private:
@@ -37,13 +37,18 @@
 #include "stloutput.hpp"
 #include "timeUtil.hpp"
 #include "logger.hpp"
+#include "searchStats.hpp"
+#include "searchProfile.hpp"
 #include "random.hpp"
 #include "posutil.hpp"
 #include "nnutil.hpp"
+#include "game.hpp"
+#include "mappedFile.hpp"
 
 #include <queue>
 #include <unordered_set>
 #include <stdio.h>
+#include <cstring>
 
 
 // Static move ordering parameters
@@ -175,62 +180,115 @@ static void writeFEN(std::ostream& os, const std::string& fen,
 
 void
 ChessTool::pgnToFen(std::istream& is, int everyNth, bool includeUnScored) {
-    std::vector<U64> nullHist(SearchConst::MAX_SEARCH_DEPTH * 2);
+    const double t0 = currentTime();
     TranspositionTable tt(512*1024);
     Notifier notifier;
     ThreadCommunicator comm(nullptr, tt, notifier, false);
-    KillerTable kt;
-    History ht;
-    auto et = Evaluate::getEvalHashTables();
-    Search::SearchTables st(comm.getCTT(), kt, ht, *et);
-    TreeLogger treeLog;
-    Random rnd;
 
-    Position pos;
-    const int mate0 = SearchConst::MATE0;
-    Search sc(pos, nullHist, 0, st, comm, treeLog);
+    struct ThreadData {
+        std::vector<U64> nullHist = std::vector<U64>(SearchConst::MAX_SEARCH_DEPTH * 2);
+        KillerTable kt;
+        History ht;
+        std::shared_ptr<Evaluate::EvalHashTables> et;
+        TreeLogger treeLog;
+    };
+    std::vector<ThreadData> tdVec(nWorkers);
 
-    PgnReader reader(is);
-    GameTree gt;
-    int gameNo = 0;
-    while (reader.readPGN(gt)) {
-        gameNo++;
-        GameTree::Result result = gt.getResult();
-        if (result == GameTree::UNKNOWN)
-            continue;
-        double rScore = 0;
-        switch (result) {
-        case GameTree::WHITE_WIN: rScore = 1.0; break;
-        case GameTree::BLACK_WIN: rScore = 0.0; break;
-        case GameTree::DRAW:      rScore = 0.5; break;
-        default: break;
-        }
-        GameNode gn = gt.getRootNode();
-        while (true) {
-            pos = gn.getPos();
-            std::string fen = TextIO::toFEN(pos);
-            if (gn.nChildren() == 0)
-                break;
-            gn.goForward(0);
-            std::string move = TextIO::moveToUCIString(gn.getMove());
-            std::string comment = gn.getComment();
-            int commentScore = 0;
-            if (!getCommentScore(comment, commentScore) && !includeUnScored)
-                continue;
+    // Convert games to FEN lines. gameNo is the number of games before the first
+    // game. Each batch uses its own random generator, so the output does not depend
+    // on which worker thread handles which batch.
+    auto convert = [&comm,&tdVec,everyNth,includeUnScored](int workerNo,
+                                                           const std::vector<PgnGame>& games,
+                                                           int gameNo, U64 rndSeed,
+                                                           std::ostream& os) {
+        ThreadData& td = tdVec[workerNo];
+        if (!td.et)
+            td.et = Evaluate::getEvalHashTables();
+        Search::SearchTables st(comm.getCTT(), td.kt, td.ht, *td.et);
+        Random rnd(rndSeed);
 
-            if (everyNth > 1 && rnd.nextInt(everyNth) != 0)
+        Position pos;
+        const int mate0 = SearchConst::MATE0;
+        Search sc(pos, td.nullHist, 0, st, comm, td.treeLog);
+
+        for (const PgnGame& game : games) {
+            gameNo++;
+            GameTree::Result result = game.getResult();
+            if (result == GameTree::UNKNOWN)
                 continue;
+            double rScore = 0;
+            switch (result) {
+            case GameTree::WHITE_WIN: rScore = 1.0; break;
+            case GameTree::BLACK_WIN: rScore = 0.0; break;
+            case GameTree::DRAW:      rScore = 0.5; break;
+            default: break;
+            }
+            Position gamePos(game.startPos);
+            UndoInfo ui;
+            for (size_t i = 0; i < game.moves.size(); i++) {
+                if (i > 0)
+                    gamePos.makeMove(game.moves[i-1], ui);
+                int commentScore = 0;
+                if (!getCommentScore(game.comments[i], commentScore) && !includeUnScored)
+                    continue;
 
-            sc.init(pos, nullHist, 0);
-            int score = sc.quiesce(-mate0, mate0, 0, 0, MoveGen::inCheck(pos));
-            if (!pos.isWhiteMove()) {
-                score = -score;
-                commentScore = -commentScore;
+                if (everyNth > 1 && rnd.nextInt(everyNth) != 0)
+                    continue;
+
+                pos = gamePos;
+                std::string fen = TextIO::toFEN(pos);
+                std::string move = TextIO::moveToUCIString(game.moves[i]);
+                sc.init(pos, td.nullHist, 0);
+                int score = sc.quiesce(-mate0, mate0, 0, 0, MoveGen::inCheck(pos));
+                if (!pos.isWhiteMove()) {
+                    score = -score;
+                    commentScore = -commentScore;
+                }
+                writeFEN(os, fen, rScore, commentScore, score, gameNo, move);
             }
-            writeFEN(std::cout, fen, rScore, commentScore, score, gameNo, move);
         }
-    }
+    };
+
+    // Read games in this thread, convert in worker threads and write the
+    // result in input order in this thread.
+    const int batchSize = 64;
+    using Result = std::shared_ptr<std::string>;
+    PgnReader reader(is);
+    Random rnd;
+    int nGames = 0;
+    S64 nPositions = 0;
+    auto getTask = [&reader,&rnd,&convert,&nGames](std::function<Result(int)>& task) {
+        auto games = std::make_shared<std::vector<PgnGame>>();
+        games->reserve(batchSize);
+        while ((int)games->size() < batchSize) {
+            games->emplace_back();
+            if (!reader.readMainLine(games->back())) {
+                games->pop_back();
+                break;
+            }
+        }
+        if (games->empty())
+            return false;
+        int gameNo = nGames;
+        nGames += games->size();
+        U64 rndSeed = rnd.nextU64();
+        task = [games,gameNo,rndSeed,&convert](int workerNo) {
+            std::stringstream ss;
+            convert(workerNo, *games, gameNo, rndSeed, ss);
+            return std::make_shared<std::string>(ss.str());
+        };
+        return true;
+    };
+    auto consume = [&nPositions](const Result& fenLines) {
+        std::cout << *fenLines;
+        nPositions += std::count(fenLines->begin(), fenLines->end(), '\n');
+    };
+    orderedPipeline<Result>(nWorkers, nWorkers * 4, getTask, consume);
     std::cout << std::flush;
+
+    double t = currentTime() - t0;
+    std::cerr << "games: " << nGames << " positions: " << nPositions << " t: " << t
+              << " positions/s: " << (S64)(t > 0 ? nPositions / t : 0) << std::endl;
 }
 
 void
@@ -688,6 +746,63 @@ ChessTool::searchPositions(std::istream& is, int baseTime, int increment) {
     pool.getAllResults([](int){});
 }
 
+void
+ChessTool::bench(int depth) {
+    static const char* fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bq1rk1/pp2bppp/2n1pn2/2pp4/2PP4/2N1PN2/PP2BPPP/R1BQ1RK1 w - - 0 8",
+        "r2q1rk1/1b1nbppp/p2ppn2/1p6/3NP3/1BN1BP2/PPPQ2PP/2KR3R w - - 2 12",
+        "2r2rk1/pp1bqppp/2n1p3/3pP3/3P4/P1PB1N2/5PPP/R2Q1RK1 b - - 0 16",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "4k3/8/3PK3/8/8/8/8/8 w - - 0 1",
+        "6k1/5p2/6p1/8/7p/8/6PP/6K1 b - - 0 40",
+    };
+
+    TranspositionTable tt(1024*1024);
+    Notifier notifier;
+    ThreadCommunicator comm(nullptr, tt, notifier, false);
+    std::vector<U64> nullHist(SearchConst::MAX_SEARCH_DEPTH * 2);
+    KillerTable kt;
+    History ht;
+    auto et = Evaluate::getEvalHashTables();
+    TreeLogger treeLog;
+    Search::SearchTables st(comm.getCTT(), kt, ht, *et);
+
+    SearchStats::clear();
+    SearchProfile::clear();
+    S64 nodes = 0;
+    double t0 = currentTime();
+    for (const char* fen : fens) {
+        Position pos = TextIO::readFEN(fen);
+        MoveList moves;
+        MoveGen::pseudoLegalMoves(pos, moves);
+        MoveGen::removeIllegal(pos, moves);
+        tt.clear();
+        ht.init();
+        kt.clear();
+        Search sc(pos, nullHist, 0, st, comm, treeLog);
+        sc.scoreMoveList(moves, 0);
+        sc.timeLimit(-1, -1);
+        sc.iterativeDeepening(moves, depth, -1, 1, false, SearchConst::MAX_SEARCH_DEPTH);
+        nodes += sc.getTotalNodesThisThread();
+    }
+    double t = currentTime() - t0;
+
+    SearchStats::Totals totals;
+    SearchStats::getTotals(totals);
+    SearchProfile::Totals profTotals;
+    SearchProfile::getTotals(profTotals);
+    std::cout << "{\"depth\":" << depth
+              << ",\"positions\":" << (sizeof(fens) / sizeof(fens[0]))
+              << ",\"nodes\":" << nodes
+              << ",\"time\":" << t
+              << ",\"nps\":" << (S64)(t > 0 ? nodes / t : 0)
+              << ",\"stats\":" << SearchStats::toJson(totals)
+              << ",\"profile\":" << SearchProfile::toJson(profTotals)
+              << "}" << std::endl;
+}
+
 void
 ChessTool::fen2bin(std::istream& is, const std::string& outFile, bool useResult,
                    bool noInCheck, double prLimit) {
@@ -696,56 +811,229 @@ ChessTool::fen2bin(std::istream& is, const std::string& outFile, bool useResult,
     os.open(outFile.c_str(), std::ios_base::out | std::ios_base::binary);
     os.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
-    ScoreToProb sp;
-    Position pos;
-    Record r;
-    std::string line;
-    while (true) {
-        std::getline(is, line);
-        if (!is || is.eof())
-            break;
-
+    const double t0 = currentTime();
+    const ScoreToProb sp;
+    auto convert = [&sp,useResult,noInCheck,prLimit](const std::vector<std::string>& lines,
+                                                     std::vector<Record>& records) {
+        Position pos;
+        Record r;
         std::vector<std::string> fields;
-        splitString(line, " : ", fields);
+        for (const std::string& line : lines) {
+            fields.clear();
+            splitString(line, " : ", fields);
 
-        pos = TextIO::readFEN(fields[0]);
+            pos = TextIO::readFEN(fields[0]);
 
-        if (noInCheck && MoveGen::inCheck(pos))
-            continue;
-        if (prLimit >= 0) {
-            int searchScore;
-            int qScore;
-            if (!str2Num(fields[2], searchScore) || !str2Num(fields[3], qScore))
-                throw ChessParseError("Invalid score: " + line);
-            double p1 = sp.getProb(searchScore);
-            double p2 = sp.getProb(qScore);
-            if (std::abs(p1 - p2) > prLimit)
+            if (noInCheck && MoveGen::inCheck(pos))
                 continue;
-        }
+            if (prLimit >= 0) {
+                int searchScore;
+                int qScore;
+                if (!str2Num(fields[2], searchScore) || !str2Num(fields[3], qScore))
+                    throw ChessParseError("Invalid score: " + line);
+                double p1 = sp.getProb(searchScore);
+                double p2 = sp.getProb(qScore);
+                if (std::abs(p1 - p2) > prLimit)
+                    continue;
+            }
 
-        int score;
-        if (!useResult) {
-            int searchScore;
-            if (!str2Num(fields[2], searchScore))
-                throw ChessParseError("Invalid score: " + line);
-            score = searchScore;
-        } else {
-            double gameResult;
-            if (!str2Num(fields[1], gameResult))
-                gameResult = -1;
-            if (gameResult == 0.0) {
-                score = -10000;
-            } else if (gameResult == 0.5) {
-                score = 0;
-            } else if (gameResult == 1.0) {
-                score = 10000;
+            int score;
+            if (!useResult) {
+                int searchScore;
+                if (!str2Num(fields[2], searchScore))
+                    throw ChessParseError("Invalid score: " + line);
+                score = searchScore;
             } else {
-                throw ChessParseError("Invalid game result: " + line);
+                double gameResult;
+                if (!str2Num(fields[1], gameResult))
+                    gameResult = -1;
+                if (gameResult == 0.0) {
+                    score = -10000;
+                } else if (gameResult == 0.5) {
+                    score = 0;
+                } else if (gameResult == 1.0) {
+                    score = 10000;
+                } else {
+                    throw ChessParseError("Invalid game result: " + line);
+                }
             }
+            NNUtil::posToRecord(pos, score, r);
+            records.push_back(r);
+        }
+    };
+
+    // Read batches of lines in this thread, convert in worker threads and
+    // write the records in input order in this thread.
+    const int batchSize = 16384;
+    using Result = std::shared_ptr<std::vector<Record>>;
+    S64 nLines = 0;
+    S64 nRecords = 0;
+    auto getTask = [&is,&convert,&nLines](std::function<Result(int)>& task) {
+        auto lines = std::make_shared<std::vector<std::string>>();
+        lines->reserve(batchSize);
+        std::string line;
+        while ((int)lines->size() < batchSize) {
+            std::getline(is, line);
+            if (!is || is.eof())
+                break;
+            lines->push_back(line);
         }
-        NNUtil::posToRecord(pos, score, r);
-        os.write((const char*)&r, sizeof(Record));
+        if (lines->empty())
+            return false;
+        nLines += lines->size();
+        task = [lines,&convert](int workerNo) {
+            auto records = std::make_shared<std::vector<Record>>();
+            records->reserve(lines->size());
+            convert(*lines, *records);
+            return records;
+        };
+        return true;
+    };
+    auto consume = [&os,&nRecords](const Result& records) {
+        os.write((const char*)records->data(), records->size() * sizeof(Record));
+        nRecords += records->size();
+    };
+    orderedPipeline<Result>(nWorkers, nWorkers * 4, getTask, consume);
+
+    double t = currentTime() - t0;
+    std::cerr << "lines: " << nLines << " records: " << nRecords << " t: " << t
+              << " records/s: " << (S64)(t > 0 ? nRecords / t : 0) << std::endl;
+}
+
+void
+ChessTool::selfPlay(const std::string& outPrefix, const SelfPlayParams& par) {
+    using Record = NNUtil::Record;
+    const int nShards = std::max(par.nShards, 1);
+    std::vector<std::ofstream> outFiles(nShards);
+    for (int i = 0; i < nShards; i++) {
+        std::ofstream& os = outFiles[i];
+        os.open(outPrefix + num2Str(i) + ".bin",
+                std::ios_base::out | std::ios_base::binary | std::ios_base::app);
+        os.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     }
+
+    const double t0 = currentTime();
+    const ScoreToProb sp;
+    const U64 nEntries = ((U64)std::max(par.hashMB, 1)) * (1 << 20) /
+                         sizeof(TranspositionTable::TTEntry);
+    struct ThreadData {
+        std::unique_ptr<TranspositionTable> tt;
+        std::unique_ptr<Notifier> notifier;
+        std::unique_ptr<ThreadCommunicator> comm;
+        std::shared_ptr<Evaluate::EvalHashTables> et;
+        KillerTable kt;
+        History ht;
+        TreeLogger treeLog;
+    };
+    std::vector<ThreadData> tdVec(nWorkers);
+
+    // Play one game and return the accepted positions in Record format
+    auto playGame = [&tdVec,&sp,&par,nEntries](int workerNo, U64 rndSeed,
+                                                std::vector<Record>& records) {
+        ThreadData& td = tdVec[workerNo];
+        if (!td.et)
+            td.et = Evaluate::getEvalHashTables();
+        if (!td.tt) {
+            td.tt = std::make_unique<TranspositionTable>(nEntries);
+            td.notifier = std::make_unique<Notifier>();
+            td.comm = std::make_unique<ThreadCommunicator>(nullptr, *td.tt, *td.notifier, false);
+        }
+        td.tt->clear();
+        td.ht.init();
+        Search::SearchTables st(td.comm->getCTT(), td.kt, td.ht, *td.et);
+        Random rnd(rndSeed);
+        const int mate0 = SearchConst::MATE0;
+
+        Position pos = TextIO::readFEN(TextIO::startPosFEN);
+        std::vector<U64> posHashList(SearchConst::MAX_SEARCH_DEPTH * 2 + par.maxPlies);
+        int posHashListSize = 0;
+        UndoInfo ui;
+        auto doMove = [&pos,&posHashList,&posHashListSize,&ui](const Move& m) {
+            posHashList[posHashListSize++] = pos.zobristHash();
+            pos.makeMove(m, ui);
+            if (pos.getHalfMoveClock() == 0)
+                posHashListSize = 0;
+        };
+
+        for (int ply = 0; ply < par.maxPlies; ply++) {
+            MoveList moves;
+            MoveGen::pseudoLegalMoves(pos, moves);
+            MoveGen::removeIllegal(pos, moves);
+            if (moves.size == 0 || Game::insufficientMaterial(pos) ||
+                Search::canClaimDraw50(pos) ||
+                Search::canClaimDrawRep(pos, posHashList, posHashListSize, posHashListSize))
+                break;
+
+            if (ply < par.randomPlies) {
+                doMove(moves[rnd.nextInt(moves.size)]);
+                continue;
+            }
+
+            td.tt->nextGeneration();
+            Search sc(pos, posHashList, posHashListSize, st, *td.comm, td.treeLog);
+            sc.scoreMoveList(moves, 0);
+            int maxDepth = -1;
+            int maxPV = 1;
+            bool onlyExact = false;
+            int minProbeDepth = 1;
+            Move bestMove = sc.iterativeDeepening(moves, maxDepth, par.nodes, maxPV,
+                                                  onlyExact, minProbeDepth);
+            int score = bestMove.score();
+
+            const bool inCheck = MoveGen::inCheck(pos);
+            bool accept = !(par.noInCheck && inCheck);
+            if (accept && par.prLimit >= 0) {
+                sc.init(pos, posHashList, posHashListSize);
+                int qScore = sc.quiesce(-mate0, mate0, 0, 0, inCheck);
+                accept = std::abs(sp.getProb(score) - sp.getProb(qScore)) <= par.prLimit;
+            }
+            if (accept) {
+                Position tmpPos(pos);
+                Record r;
+                NNUtil::posToRecord(tmpPos, pos.isWhiteMove() ? score : -score, r);
+                records.push_back(r);
+            }
+
+            if (SearchConst::isWinScore(std::abs(score)))
+                break;
+            doMove(bestMove);
+        }
+    };
+
+    // Play games in worker threads and write the records in this thread. Game
+    // number i is written to shard i % nShards. At most nWorkers * 4 finished
+    // games are buffered before they are written.
+    using Result = std::shared_ptr<std::vector<Record>>;
+    Random rnd;
+    int nStarted = 0;
+    int nFinished = 0;
+    S64 nRecords = 0;
+    auto getTask = [&rnd,&playGame,&nStarted,&par](std::function<Result(int)>& task) {
+        if (nStarted >= par.nGames)
+            return false;
+        nStarted++;
+        U64 seed = rnd.nextU64();
+        task = [seed,&playGame](int workerNo) {
+            auto records = std::make_shared<std::vector<Record>>();
+            playGame(workerNo, seed, *records);
+            return records;
+        };
+        return true;
+    };
+    auto consume = [&](const Result& records) {
+        std::ofstream& os = outFiles[nFinished % nShards];
+        os.write((const char*)records->data(), records->size() * sizeof(Record));
+        nRecords += records->size();
+        nFinished++;
+        if (nFinished % 100 == 0 || nFinished == par.nGames) {
+            double t = currentTime() - t0;
+            std::cerr << "games: " << nFinished << " records: " << nRecords
+                      << " t: " << t
+                      << " records/hour/core: "
+                      << (S64)(t > 0 ? nRecords / t * 3600 / nWorkers : 0) << std::endl;
+        }
+    };
+    orderedPipeline<Result>(nWorkers, nWorkers * 4, getTask, consume);
 }
 
 void
@@ -936,8 +1224,7 @@ ChessTool::computeAvgError(std::vector<PositionInfo>& positions, const ScoreToPr
     Parameters& uciPars = Parameters::instance();
     for (int i = 0; i < (int)pdVal.n_rows; i++)
         uciPars.set(pdVec[i].name, num2Str(pdVal.at(i, 0)));
-    qEval(positions);
-    return computeAvgError(positions, sp);
+    return computeEvalObjective(positions, sp);
 }
 #endif
 
@@ -1498,6 +1785,44 @@ ChessTool::getCommentScore(const std::string& comment, int& score) {
 
 void
 ChessTool::readFENFile(std::istream& is, std::vector<PositionInfo>& data) {
+    const double t0 = currentTime();
+    PosCacheSource src;
+    if (!posCacheFile.empty()) {
+        src = getPosCacheSource(is);
+        if (!src.valid)
+            std::cerr << "Input is not seekable, not using position cache "
+                      << posCacheFile << std::endl;
+    }
+    const bool useCache = src.valid;
+    if (useCache && readPosCache(posCacheFile, src, data)) {
+        std::cerr << "Read " << data.size() << " positions from " << posCacheFile
+                  << " in " << currentTime() - t0 << "s" << std::endl;
+    } else {
+        parseFENFile(is, data);
+        if (useCache) {
+            std::cerr << "Parsed " << data.size() << " positions in "
+                      << currentTime() - t0 << "s" << std::endl;
+            writePosCache(posCacheFile, src, data);
+        }
+    }
+
+    if (optimizeMoveOrdering) {
+        std::cout << "positions before: " << data.size() << std::endl;
+        // Only include positions where non-capture moves were played
+        auto remove = [](const PositionInfo& pi) -> bool {
+            Position pos;
+            pos.deSerialize(pi.posData);
+            Move m;
+            m.setFromCompressed(pi.cMove);
+            return m.isEmpty() || pos.getPiece(m.to()) != Piece::EMPTY;
+        };
+        data.erase(std::remove_if(data.begin(), data.end(), remove), data.end());
+        std::cout << "positions after: " << data.size() << std::endl;
+    }
+}
+
+void
+ChessTool::parseFENFile(std::istream& is, std::vector<PositionInfo>& data) {
     std::vector<std::string> lines = readStream(is);
     data.resize(lines.size());
     const int nLines = lines.size();
@@ -1562,20 +1887,186 @@ ChessTool::readFENFile(std::istream& is, std::vector<PositionInfo>& data) {
 
     if (error)
         throw ChessParseError("Invalid file format");
+}
 
-    if (optimizeMoveOrdering) {
-        std::cout << "positions before: " << data.size() << std::endl;
-        // Only include positions where non-capture moves were played
-        auto remove = [](const PositionInfo& pi) -> bool {
-            Position pos;
-            pos.deSerialize(pi.posData);
-            Move m;
-            m.setFromCompressed(pi.cMove);
-            return m.isEmpty() || pos.getPiece(m.to()) != Piece::EMPTY;
+namespace {
+/** File format for one position in a position cache file. */
+struct PosCacheRecord {
+    U64 posData[5];
+    S32 searchScore;
+    S32 qScore;
+    S32 gameNo;
+    U16 cMove;
+    U8 result;       // Game result for white times 2
+    U8 unused;
+};
+static_assert(sizeof(PosCacheRecord) == 56, "Unsupported struct packing");
+
+/** Position cache file header. The source size and hash identify the FEN
+ *  input the cache was created from. */
+struct PosCacheHeader {
+    char magic[8];
+    U64 nPos;
+    U64 srcSize;
+    U64 srcHash;
+};
+static_assert(sizeof(PosCacheHeader) == 32, "Unsupported struct packing");
+
+const char posCacheMagic[8] = { 'T', 'X', 'P', 'O', 'S', 'C', '0', '2' };
+const int posCacheMagicVersionPos = 6; // Characters before this position identify a cache file
+}
+
+ChessTool::PosCacheSource
+ChessTool::getPosCacheSource(std::istream& is) {
+    PosCacheSource src;
+    const std::streampos start = is.tellg();
+    if (start == std::streampos(-1))
+        return src;
+    is.seekg(0, std::ios_base::end);
+    const std::streampos end = is.tellg();
+    if (!is || end == std::streampos(-1)) {
+        is.clear();
+        is.seekg(start);
+        return src;
+    }
+
+    const U64 size = end - start;
+    U64 hash = 0xcbf29ce484222325ULL ^ size;
+    std::vector<char> buf(1024 * 1024);
+    is.seekg(start);
+    for (U64 offs = 0; offs < size && is; ) {
+        const U64 len = std::min((U64)buf.size(), size - offs);
+        is.read(buf.data(), len);
+        const U64 nRead = is.gcount();
+        for (U64 i = 0; i < nRead; i++)
+            hash = (hash ^ (U8)buf[i]) * 0x100000001b3ULL; // FNV-1a
+        offs += nRead;
+    }
+    is.clear();
+    is.seekg(start);
+    if (!is)
+        throw ChessParseError("Failed to rewind input stream");
+
+    src.valid = true;
+    src.size = size;
+    src.hash = hash;
+    return src;
+}
+
+bool
+ChessTool::readPosCache(const std::string& fileName, const PosCacheSource& src,
+                        std::vector<PositionInfo>& data) {
+    MappedFile mf;
+    if (!mf.open(fileName))
+        return false;
+    PosCacheHeader hdr;
+    if (mf.size() < sizeof(hdr.magic) ||
+        memcmp(mf.data(), posCacheMagic, posCacheMagicVersionPos) != 0)
+        throw ChessParseError("Invalid position cache file: " + fileName);
+    if (mf.size() < sizeof(hdr) || memcmp(mf.data(), posCacheMagic, sizeof(posCacheMagic)) != 0) {
+        std::cerr << "Position cache " << fileName << " has an old format, recreating it" << std::endl;
+        return false;
+    }
+    memcpy(&hdr, mf.data(), sizeof(hdr));
+    const U64 nPos = hdr.nPos;
+    if (mf.size() != sizeof(hdr) + nPos * sizeof(PosCacheRecord)) {
+        std::cerr << "Position cache " << fileName << " is truncated, recreating it" << std::endl;
+        return false;
+    }
+    if (hdr.srcSize != src.size || hdr.srcHash != src.hash) {
+        std::cerr << "Position cache " << fileName << " was created from different input, "
+                  << "recreating it" << std::endl;
+        return false;
+    }
+
+    data.resize(nPos);
+    const U8* records = mf.data() + sizeof(hdr);
+    const S64 batchSize = 1024 * 1024;
+    ThreadPool<int> pool(nWorkers);
+    for (S64 b = 0; b < (S64)nPos; b += batchSize) {
+        S64 beginIndex = b;
+        S64 endIndex = std::min(b + batchSize, (S64)nPos);
+        auto func = [records,&data,beginIndex,endIndex](int workerNo) {
+            PosCacheRecord r;
+            for (S64 i = beginIndex; i < endIndex; i++) {
+                memcpy(&r, records + i * sizeof(PosCacheRecord), sizeof(r));
+                PositionInfo& pi = data[i];
+                for (int j = 0; j < 5; j++)
+                    pi.posData.v[j] = r.posData[j];
+                pi.result = r.result * 0.5;
+                pi.searchScore = r.searchScore;
+                pi.qScore = r.qScore;
+                pi.gameNo = r.gameNo;
+                pi.cMove = r.cMove;
+            }
+            return 0;
         };
-        data.erase(std::remove_if(data.begin(), data.end(), remove), data.end());
-        std::cout << "positions after: " << data.size() << std::endl;
+        pool.addTask(func);
+    }
+    pool.getAllResults([](int){});
+    return true;
+}
+
+void
+ChessTool::writePosCache(const std::string& fileName, const PosCacheSource& src,
+                         const std::vector<PositionInfo>& data) {
+    for (const PositionInfo& pi : data) {
+        double r2 = pi.result * 2;
+        if (r2 != 0 && r2 != 1 && r2 != 2) {
+            std::cerr << "Game results not representable, position cache not created" << std::endl;
+            return;
+        }
+    }
+
+    // Write to a temporary file and rename it, so that an interrupted write
+    // does not leave a truncated cache file
+    const std::string tmpName = fileName + ".tmp";
+    try {
+        writePosCacheData(tmpName, src, data);
+    } catch (...) {
+        remove(tmpName.c_str());
+        throw;
+    }
+    if (rename(tmpName.c_str(), fileName.c_str()) != 0) {
+        remove(tmpName.c_str());
+        throw ChessError("Failed to create position cache file: " + fileName);
+    }
+}
+
+void
+ChessTool::writePosCacheData(const std::string& fileName, const PosCacheSource& src,
+                             const std::vector<PositionInfo>& data) {
+    std::ofstream os;
+    os.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    os.open(fileName.c_str(), std::ios_base::out | std::ios_base::binary);
+    PosCacheHeader hdr;
+    memcpy(hdr.magic, posCacheMagic, sizeof(posCacheMagic));
+    hdr.nPos = data.size();
+    hdr.srcSize = src.size;
+    hdr.srcHash = src.hash;
+    os.write((const char*)&hdr, sizeof(hdr));
+
+    std::vector<PosCacheRecord> buf;
+    const size_t bufSize = 64 * 1024;
+    buf.reserve(bufSize);
+    for (const PositionInfo& pi : data) {
+        PosCacheRecord r;
+        for (int j = 0; j < 5; j++)
+            r.posData[j] = pi.posData.v[j];
+        r.searchScore = pi.searchScore;
+        r.qScore = pi.qScore;
+        r.gameNo = pi.gameNo;
+        r.cMove = pi.cMove;
+        r.result = (U8)(pi.result * 2);
+        r.unused = 0;
+        buf.push_back(r);
+        if (buf.size() == bufSize) {
+            os.write((const char*)buf.data(), buf.size() * sizeof(PosCacheRecord));
+            buf.clear();
+        }
     }
+    os.write((const char*)buf.data(), buf.size() * sizeof(PosCacheRecord));
+    os.close();
 }
 
 void
@@ -1599,9 +2090,45 @@ ChessTool::computeObjective(std::vector<PositionInfo>& positions, const ScoreToP
     if (optimizeMoveOrdering) {
         return computeMoveOrderObjective(positions, sp);
     } else {
-        qEval(positions);
+        return computeEvalObjective(positions, sp);
+    }
+}
+
+double
+ChessTool::computeEvalObjective(std::vector<PositionInfo>& positions, const ScoreToProb& sp) {
+    if (leafCacheRefresh <= 0 || ++nObjectiveEvals % leafCacheRefresh != 0) {
+        qEval(positions, 0, positions.size(), LeafCacheMode::USE);
         return computeAvgError(positions, sp);
     }
+
+    double t0 = currentTime();
+    qEval(positions, 0, positions.size(), LeafCacheMode::USE);
+    double cachedErr = computeAvgError(positions, sp);
+    double t1 = currentTime();
+    qEval(positions, 0, positions.size(), LeafCacheMode::REFRESH);
+    double fullErr = computeAvgError(positions, sp);
+    double t2 = currentTime();
+
+    std::stringstream ss;
+    ss << "leafcache cached:" << std::setprecision(14) << cachedErr
+       << " full:" << fullErr << " drift:" << (cachedErr - fullErr)
+       << std::setprecision(6) << " tCached:" << (t1 - t0) << " tFull:" << (t2 - t1);
+    std::cerr << ss.str() << std::endl;
+    return fullErr;
+}
+
+void
+ChessTool::setLeafCache(int refreshInterval, int staleLimit) {
+    leafCacheRefresh = refreshInterval;
+    leafCacheStaleLimit = staleLimit;
+    leafCache.clear();
+    leafCachePositions = nullptr;
+    nObjectiveEvals = 0;
+}
+
+void
+ChessTool::setPosCacheFile(const std::string& fileName) {
+    posCacheFile = fileName;
 }
 
 void
@@ -1610,7 +2137,8 @@ ChessTool::qEval(std::vector<PositionInfo>& positions) {
 }
 
 void
-ChessTool::qEval(std::vector<PositionInfo>& positions, const int beg, const int end) {
+ChessTool::qEval(std::vector<PositionInfo>& positions, const int beg, const int end,
+                 LeafCacheMode cacheMode) {
     TranspositionTable tt(512*1024);
     Notifier notifier;
     ThreadCommunicator comm(nullptr, tt, notifier, false);
@@ -1622,30 +2150,75 @@ ChessTool::qEval(std::vector<PositionInfo>& positions, const int beg, const int
         std::shared_ptr<Evaluate::EvalHashTables> et;
         TreeLogger treeLog;
         Position pos;
+        Position leafPos;
     };
     std::vector<ThreadData> tdVec(nWorkers);
 
+    const bool cacheEnabled = leafCacheRefresh > 0 && cacheMode != LeafCacheMode::NONE;
+    if (cacheEnabled && (leafCachePositions != &positions ||
+                         leafCache.size() != positions.size())) {
+        leafCache.assign(positions.size(), LeafInfo());
+        leafCachePositions = &positions;
+    }
+    const bool useLeafCache = cacheEnabled && cacheMode == LeafCacheMode::USE;
+    const int staleLimit = leafCacheStaleLimit;
+
     const int chunkSize = 5000;
     ThreadPool<int> pool(nWorkers);
     for (int c = beg; c < end; c += chunkSize) {
         int beginIndex = c;
         int endIndex = std::min(c + chunkSize, end);
-        auto func = [&comm,&positions,&tdVec,beginIndex,endIndex](int workerNo) mutable {
+        auto func = [this,&comm,&positions,&tdVec,beginIndex,endIndex,
+                     cacheEnabled,useLeafCache,staleLimit](int workerNo) mutable {
             ThreadData& td = tdVec[workerNo];
             if (!td.et)
                 td.et = Evaluate::getEvalHashTables();
             Search::SearchTables st(comm.getCTT(), td.kt, td.ht, *td.et);
+            Evaluate eval(*td.et);
 
             const int mate0 = SearchConst::MATE0;
             Position& pos = td.pos;
             Search sc(pos, td.nullHist, 0, st, comm, td.treeLog);
 
+            // Evaluate the leaf position, from the point of view of the side to move in pos
+            auto evalLeaf = [&eval,&td](const LeafInfo& li) {
+                td.leafPos.deSerialize(li.leafPos);
+                eval.connectPosition(td.leafPos);
+                int score = eval.evalPos();
+                return li.flip ? -score : score;
+            };
+
             for (int i = beginIndex; i < endIndex; i++) {
                 PositionInfo& pi = positions[i];
-                pos.deSerialize(pi.posData);
-                sc.init(pos, td.nullHist, 0);
-                int score = sc.quiesce(-mate0, mate0, 0, 0, MoveGen::inCheck(pos));
-                if (!pos.isWhiteMove())
+                bool wtm;
+                int score;
+                bool done = false;
+                if (useLeafCache) {
+                    const LeafInfo& li = leafCache[i];
+                    if (li.valid) {
+                        score = evalLeaf(li);
+                        wtm = td.leafPos.isWhiteMove() != li.flip;
+                        done = std::abs(score - li.qScore) <= staleLimit;
+                    }
+                }
+                if (!done) {
+                    pos.deSerialize(pi.posData);
+                    wtm = pos.isWhiteMove();
+                    sc.init(pos, td.nullHist, 0);
+                    if (cacheEnabled) {
+                        LeafInfo& li = leafCache[i];
+                        auto ret = sc.quiescePos(-mate0, mate0, 0, 0, MoveGen::inCheck(pos));
+                        score = ret.first;
+                        li.leafPos = ret.second;
+                        li.qScore = score;
+                        td.leafPos.deSerialize(li.leafPos);
+                        li.flip = td.leafPos.isWhiteMove() != wtm;
+                        li.valid = !MoveGen::inCheck(td.leafPos) && evalLeaf(li) == score;
+                    } else {
+                        score = sc.quiesce(-mate0, mate0, 0, 0, MoveGen::inCheck(pos));
+                    }
+                }
+                if (!wtm)
                     score = -score;
                 pi.qScore = score;
             }
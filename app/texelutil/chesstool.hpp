@@ -92,6 +92,19 @@ public:
     /** Setup tablebase directory paths. */
     static void setupTB();
 
+    /** Cache the q-search PV leaf position for each position and compute q-search
+     *  scores by only evaluating the leaf position. Every refreshInterval objective
+     *  function evaluation, all leaf positions are recomputed using a full q-search.
+     *  A leaf position is also recomputed if its score has changed more than
+     *  staleLimit since the last full q-search. */
+    void setLeafCache(int refreshInterval, int staleLimit);
+
+    /** Use a binary position cache file when reading FEN files. If the cache
+     *  file exists, positions are read from it and the FEN input is ignored.
+     *  Otherwise the FEN input is parsed and the cache file is created. The
+     *  cache is not used if the FEN input is not seekable. */
+    void setPosCacheFile(const std::string& fileName);
+
     /** Read a file into a string vector. */
     static std::vector<std::string> readFile(const std::string& fname);
 
@@ -145,6 +158,10 @@ public:
      *  not generate any output, but it is still useful if the SearchTreeSampler is enabled. */
     void searchPositions(std::istream& is, int baseTime, int increment);
 
+    /** Search a fixed set of positions to a fixed depth using one thread.
+     *  Print node count, speed and search statistics as a JSON object. */
+    void bench(int depth);
+
     /** Convert FEN+score data to binary format.
      *  If "useResult" is true, use the game result instead of the search score.
      *  If "noInCheck" is true, ignore positions where side to move is in check.
@@ -153,6 +170,23 @@ public:
     void fen2bin(std::istream& is, const std::string& outFile, bool useResult,
                  bool noInCheck, double prLimit);
 
+    /** Parameters for selfPlay(). */
+    struct SelfPlayParams {
+        int nGames = 1000;      // Number of games to play
+        int nodes = 5000;       // Number of nodes to search for each move
+        int randomPlies = 8;    // Number of random moves at the start of each game
+        int maxPlies = 400;     // Games longer than this are aborted
+        int nShards = 1;        // Number of output files
+        int hashMB = 16;        // Transposition table size for each worker thread
+        bool noInCheck = false; // Ignore positions where side to move is in check
+        double prLimit = -1;    // If >= 0, ignore positions where search and q-search
+                                // scores differ more than prLimit, measured in expected outcome
+    };
+
+    /** Play fixed nodes self-play games and append the searched positions in
+     *  binary format to the files outPrefix0.bin, outPrefix1.bin, ... */
+    void selfPlay(const std::string& outPrefix, const SelfPlayParams& par);
+
     /** Print how much position evaluation improves when parValues are applied to evaluation function.
      * Positions with no change are not printed. */
     void evalEffect(std::istream& is, const std::vector<ParamValue>& parValues);
@@ -208,8 +242,37 @@ private:
         double getErr(const ScoreToProb& sp) const { return sp.getProb(qScore) - result; }
     };
 
+    /** Read positions from a FEN file, or from the position cache if enabled. */
     void readFENFile(std::istream& is, std::vector<PositionInfo>& data);
 
+    /** Parse positions in a FEN file. */
+    void parseFENFile(std::istream& is, std::vector<PositionInfo>& data);
+
+    /** Identifies the FEN input a position cache file was created from. */
+    struct PosCacheSource {
+        bool valid = false; // False if the input stream is not seekable
+        U64 size = 0;       // Input size in bytes
+        U64 hash = 0;       // Hash of size and contents of the input
+    };
+
+    /** Compute the identity of a FEN input stream. The stream is rewound to
+     *  its current position afterwards. */
+    static PosCacheSource getPosCacheSource(std::istream& is);
+
+    /** Read positions from a position cache file. Return false if the file
+     *  does not exist, has an old format, is truncated or was created from
+     *  different input. */
+    bool readPosCache(const std::string& fileName, const PosCacheSource& src,
+                      std::vector<PositionInfo>& data);
+
+    /** Write positions to a position cache file. The file is replaced
+     *  atomically, so readers never see a partially written file. */
+    static void writePosCache(const std::string& fileName, const PosCacheSource& src,
+                              const std::vector<PositionInfo>& data);
+    /** Write position cache file contents to fileName. */
+    static void writePosCacheData(const std::string& fileName, const PosCacheSource& src,
+                                  const std::vector<PositionInfo>& data);
+
     /** Write PGN file to cout, with no moves and staring position given by pos. */
     void writePGN(const Position& pos);
 
@@ -228,10 +291,23 @@ private:
     /** Compute the optimization objective function. */
     double computeObjective(std::vector<PositionInfo>& positions, const ScoreToProb& sp);
 
+    /** Recompute all qScore values and compute average evaluation error.
+     *  If the leaf cache is enabled, periodically also compare the result to
+     *  the result obtained without using the cache. */
+    double computeEvalObjective(std::vector<PositionInfo>& positions, const ScoreToProb& sp);
+
     /** Recompute all qScore values. */
     void qEval(std::vector<PositionInfo>& positions);
-    /** Recompute all qScore values between indices beg and end. */
-    void qEval(std::vector<PositionInfo>& positions, const int beg, const int end);
+    /** How qEval interacts with the leaf cache. */
+    enum class LeafCacheMode {
+        NONE,    // Full q-search, leaf cache not read or updated
+        USE,     // Use cached leaves when not stale, update cache for other positions
+        REFRESH, // Full q-search, update cache for all positions
+    };
+    /** Recompute all qScore values between indices beg and end.
+     *  The leaf cache is only used if enabled by setLeafCache(). */
+    void qEval(std::vector<PositionInfo>& positions, const int beg, const int end,
+               LeafCacheMode cacheMode = LeafCacheMode::NONE);
 
     /** Compute average evaluation error. */
     double computeAvgError(const std::vector<PositionInfo>& positions, const ScoreToProb& sp);
@@ -246,6 +322,20 @@ private:
     const bool optimizeMoveOrdering;
     const bool useSearchScore;
     const int nWorkers;
+
+    struct LeafInfo {
+        Position::SerializeData leafPos; // Position at end of q-search PV
+        int qScore = 0;                  // q-search score, from side to move point of view
+        bool flip = false;               // True if side to move differs in leafPos
+        bool valid = false;              // True if leafPos can be used to compute qScore
+    };
+    std::vector<LeafInfo> leafCache; // Leaf info for each position, if cache enabled
+    const std::vector<PositionInfo>* leafCachePositions = nullptr; // Vector leafCache belongs to
+    int leafCacheRefresh = 0;        // Number of objective evaluations between full q-searches
+    int leafCacheStaleLimit = 0;
+    int nObjectiveEvals = 0;
+
+    std::string posCacheFile; // Binary position cache file name, or empty
 };
 
 
@@ -32,10 +32,14 @@
 #include "killerTable.hpp"
 #include "textio.hpp"
 #include "gametree.hpp"
+#include "gametreeutil.hpp"
 #include "clustertt.hpp"
 #include "threadpool.hpp"
+#include "mappedFile.hpp"
 #include <unordered_set>
 #include <random>
+#include <fstream>
+#include <functional>
 
 MatchBookCreator::MatchBookCreator(int nWorkers)
     : nWorkers(nWorkers) {
@@ -54,6 +58,44 @@ MatchBookCreator::createBook(int depth, int searchTime, std::ostream& os) {
     evaluateBookLines(lines, searchTime, os);
 }
 
+void
+MatchBookCreator::getBookLines(int depth, std::vector<std::vector<Move>>& lines) {
+    createBookLines(depth);
+    for (const auto& bl : bookLines)
+        lines.push_back(bl.second.moves);
+}
+
+void
+MatchBookCreator::readBook(std::istream& is, std::vector<std::vector<Move>>& lines) {
+    std::string line;
+    while (std::getline(is, line)) {
+        std::vector<std::string> fields;
+        splitString(line, fields);
+        if (fields.empty())
+            continue;
+        if (fields.size() < 2)
+            throw ChessParseError("Invalid book line: " + line);
+        std::vector<Move> moves;
+        Position pos = TextIO::readFEN(TextIO::startPosFEN);
+        for (size_t i = 2; i < fields.size(); i++) {
+            Move m = TextIO::uciStringToMove(fields[i]);
+            MoveList legalMoves;
+            MoveGen::pseudoLegalMoves(pos, legalMoves);
+            MoveGen::removeIllegal(pos, legalMoves);
+            bool legal = false;
+            for (int mi = 0; mi < legalMoves.size; mi++)
+                if (legalMoves[mi] == m)
+                    legal = true;
+            if (!legal)
+                throw ChessParseError("Invalid move " + fields[i] + " in book line: " + line);
+            moves.push_back(m);
+            UndoInfo ui;
+            pos.makeMove(m, ui);
+        }
+        lines.push_back(moves);
+    }
+}
+
 void
 MatchBookCreator::createBookLines(int depth) {
     std::vector<Move> moveList;
@@ -168,25 +210,26 @@ MatchBookCreator::countUniq(const std::string& pgnFile, std::ostream& os) {
     PgnReader reader(is);
     std::vector<std::unordered_set<U64>> uniqPositions;
     std::vector<int> nGames;
-    GameTree gt;
+    PgnGame game;
     int nGamesTot = 0;
     U64 nPositions = 0;
     try {
-        while (reader.readPGN(gt)) {
+        while (reader.readMainLine(game)) {
             nGamesTot++;
-            GameNode gn = gt.getRootNode();
+            Position pos(game.startPos);
+            UndoInfo ui;
             int ply = 0;
             while (true) {
                 while ((int)uniqPositions.size() <= ply)
                     uniqPositions.push_back(std::unordered_set<U64>());
                 while ((int)nGames.size() <= ply)
                     nGames.push_back(0);
-                uniqPositions[ply].insert(gn.getPos().zobristHash());
+                uniqPositions[ply].insert(pos.zobristHash());
                 nGames[ply]++;
                 nPositions++;
-                if (gn.nChildren() == 0)
+                if (ply >= (int)game.moves.size())
                     break;
-                gn.goForward(0);
+                pos.makeMove(game.moves[ply], ui);
                 ply++;
             }
         }
@@ -209,6 +252,64 @@ MatchBookCreator::countUniq(const std::string& pgnFile, std::ostream& os) {
     }
 }
 
+void
+MatchBookCreator::pgnBench(const std::string& pgnFile, std::ostream& os) {
+    MappedFile mf;
+    if (!mf.open(pgnFile))
+        throw ChessParseError("Failed to open file: " + pgnFile);
+    const double mBytes = mf.size() / (1024.0 * 1024.0);
+
+    auto bench = [&](const std::string& name, const std::function<int(S64&)>& parse) {
+        double t0 = currentTime();
+        S64 nMoves = 0;
+        int nGames = parse(nMoves);
+        double t = currentTime() - t0;
+        std::stringstream ss;
+        ss.precision(2);
+        ss << std::fixed << std::left << std::setw(9) << name
+           << " games: " << nGames << " moves: " << nMoves << " MB: " << mBytes
+           << " t: " << t << " games/s: " << (t > 0 ? nGames / t : 0)
+           << " MB/s: " << (t > 0 ? mBytes / t : 0);
+        os << ss.str() << std::endl;
+    };
+
+    bench("tree", [&](S64& nMoves) {
+        std::ifstream is(pgnFile);
+        PgnReader reader(is);
+        GameTree gt;
+        int nGames = 0;
+        while (reader.readPGN(gt)) {
+            nGames++;
+            GameNode gn = gt.getRootNode();
+            while (gn.nChildren() > 0) {
+                gn.goForward(0);
+                nMoves++;
+            }
+        }
+        return nGames;
+    });
+
+    auto readMainLines = [](PgnReader& reader, S64& nMoves) {
+        PgnGame game;
+        int nGames = 0;
+        while (reader.readMainLine(game)) {
+            nGames++;
+            nMoves += game.moves.size();
+        }
+        return nGames;
+    };
+    bench("mainline", [&](S64& nMoves) {
+        std::ifstream is(pgnFile);
+        PgnReader reader(is);
+        return readMainLines(reader, nMoves);
+    });
+    bench("mmap", [&](S64& nMoves) {
+        mf.willNeed(0, mf.size());
+        PgnReader reader((const char*)mf.data(), mf.size());
+        return readMainLines(reader, nMoves);
+    });
+}
+
 namespace {
 class PlayerInfo {
 public:
@@ -320,12 +421,8 @@ MatchBookCreator::pgnStat(const std::string& pgnFile, bool pairMode, std::ostrea
     std::vector<PlayerInfo> players;
     std::vector<GameInfo> games;
 
-    std::ifstream is(pgnFile);
-    PgnReader reader(is);
-    GameTree gt;
     int nGames = 0;
     int nMoves = 0;
-    std::map<std::string, std::string> headers;
 
     auto playerNo = [&players](const std::string& name) -> int {
         for (size_t i = 0; i < players.size(); i++)
@@ -335,134 +432,141 @@ MatchBookCreator::pgnStat(const std::string& pgnFile, bool pairMode, std::ostrea
         return players.size() - 1;
     };
 
-    try {
-        while (reader.readPGN(gt)) {
-            nGames++;
-            GameNode gn = gt.getRootNode();
-            int wMoveSum = 0, wDepthSum = 0;
-            int bMoveSum = 0, bDepthSum = 0;
-            int wTimeSum = 0, wTimeCnt = 0;
-            int bTimeSum = 0, bTimeCnt = 0;
-            int timeCnt = 0;
-            while (true) {
-                if (gn.nChildren() == 0)
-                    break;
-                bool wtm = gn.getPos().isWhiteMove();
-                gn.goForward(0);
-                int depth, ms;
-                if (getCommentDepth(gn.getComment(), depth, ms)) {
-                    if (wtm) {
-                        wDepthSum += depth;
-                        wMoveSum++;
-                    } else {
-                        bDepthSum += depth;
-                        bMoveSum++;
-                    }
+    // Games are parsed by worker threads. Player numbers are assigned in
+    // this thread in file order.
+    struct GameStat {
+        std::string white;
+        std::string black;
+        GameInfo info;
+        int nMoves;
+    };
+    auto parseGame = [](const PgnGame& game, std::vector<GameStat>& chunk) {
+        int wMoveSum = 0, wDepthSum = 0;
+        int bMoveSum = 0, bDepthSum = 0;
+        int wTimeSum = 0, wTimeCnt = 0;
+        int bTimeSum = 0, bTimeCnt = 0;
+        int timeCnt = 0;
+        bool wtm = game.startPos.isWhiteMove();
+        for (size_t i = 0; i < game.moves.size(); i++, wtm = !wtm) {
+            int depth, ms;
+            if (getCommentDepth(game.comments[i], depth, ms)) {
+                if (wtm) {
+                    wDepthSum += depth;
+                    wMoveSum++;
+                } else {
+                    bDepthSum += depth;
+                    bMoveSum++;
                 }
-                if (ms > 0 && timeCnt < 20) {
-                    timeCnt++;
-                    if (wtm) {
-                        wTimeSum += ms;
-                        wTimeCnt++;
-                    } else {
-                        bTimeSum += ms;
-                        bTimeCnt++;
-                    }
+            }
+            if (ms > 0 && timeCnt < 20) {
+                timeCnt++;
+                if (wtm) {
+                    wTimeSum += ms;
+                    wTimeCnt++;
+                } else {
+                    bTimeSum += ms;
+                    bTimeCnt++;
                 }
-                nMoves++;
             }
+        }
 
-            headers.clear();
-            gt.getHeaders(headers);
-            int pw = playerNo(headers["White"]);
-            int pb = playerNo(headers["Black"]);
-            double score;
-            switch (gt.getResult()) {
-            case GameTree::WHITE_WIN: score = 1;   break;
-            case GameTree::DRAW:      score = 0.5; break;
-            case GameTree::BLACK_WIN: score = 0;   break;
-            default:                 throw ChessParseError("Unknown result");
-            }
-            games.push_back(GameInfo{pw, pb, score, wMoveSum, wDepthSum, bMoveSum, bDepthSum,
-                                     wTimeSum, wTimeCnt, bTimeSum, bTimeCnt});
+        double score;
+        switch (game.getResult()) {
+        case GameTree::WHITE_WIN: score = 1;   break;
+        case GameTree::DRAW:      score = 0.5; break;
+        case GameTree::BLACK_WIN: score = 0;   break;
+        default:                 throw ChessParseError("Unknown result");
         }
+        chunk.push_back(GameStat{game.getTag("White"), game.getTag("Black"),
+                                 GameInfo{-1, -1, score, wMoveSum, wDepthSum, bMoveSum, bDepthSum,
+                                          wTimeSum, wTimeCnt, bTimeSum, bTimeCnt},
+                                 (int)game.moves.size()});
+    };
+    auto consume = [&](const std::vector<GameStat>& chunk) {
+        for (const GameStat& gs : chunk) {
+            nGames++;
+            nMoves += gs.nMoves;
+            GameInfo gi = gs.info;
+            gi.pw = playerNo(gs.white);
+            gi.pb = playerNo(gs.black);
+            games.push_back(gi);
+        }
+    };
+    GameTreeUtil::iteratePgnParallel<PgnGame, std::vector<GameStat>>(pgnFile, nWorkers,
+                                                                     parseGame, consume);
 
-        std::stringstream ss;
-        ss.precision(1);
-        ss << std::fixed << (nMoves / (double)nGames / 2);
-        os << "nGames: " << nGames << " moves/game: " << ss.str() << std::endl;
+    std::stringstream ss;
+    ss.precision(1);
+    ss << std::fixed << (nMoves / (double)nGames / 2);
+    os << "nGames: " << nGames << " moves/game: " << ss.str() << std::endl;
 
-        if (pairMode && players.size() != 2) {
-            std::cerr << "Pair mode requires two players" << std::endl;
-            return;
-        }
+    if (pairMode && players.size() != 2) {
+        std::cerr << "Pair mode requires two players" << std::endl;
+        return;
+    }
 
-        for (size_t i = 0; i < games.size(); i++) {
-            const GameInfo& gi = games[i];
-            players[gi.pw].addWDL(gi.score);
-            players[gi.pb].addWDL(1-gi.score);
-            if (pairMode) {
-                if (i % 2 != 0) {
-                    double score = gi.score + (1 - games[i-1].score);
-                    players[gi.pw].addScore(score);
-                    players[gi.pb].addScore(2 - score);
-                }
-            } else {
-                players[gi.pw].addScore(gi.score);
-                players[gi.pb].addScore(1-gi.score);
+    for (size_t i = 0; i < games.size(); i++) {
+        const GameInfo& gi = games[i];
+        players[gi.pw].addWDL(gi.score);
+        players[gi.pb].addWDL(1-gi.score);
+        if (pairMode) {
+            if (i % 2 != 0) {
+                double score = gi.score + (1 - games[i-1].score);
+                players[gi.pw].addScore(score);
+                players[gi.pb].addScore(2 - score);
             }
-            players[gi.pw].addDepth(gi.wMoveSum, gi.wDepthSum, gi.bMoveSum, gi.bDepthSum,
-                                    gi.wTimeSum, gi.wTimeCnt, gi.bTimeSum, gi.bTimeCnt);
-            players[gi.pb].addDepth(gi.bMoveSum, gi.bDepthSum, gi.wMoveSum, gi.wDepthSum,
-                                    gi.bTimeSum, gi.bTimeCnt, gi.wTimeSum, gi.wTimeCnt);
+        } else {
+            players[gi.pw].addScore(gi.score);
+            players[gi.pb].addScore(1-gi.score);
         }
+        players[gi.pw].addDepth(gi.wMoveSum, gi.wDepthSum, gi.bMoveSum, gi.bDepthSum,
+                                gi.wTimeSum, gi.wTimeCnt, gi.bTimeSum, gi.bTimeCnt);
+        players[gi.pb].addDepth(gi.bMoveSum, gi.bDepthSum, gi.wMoveSum, gi.wDepthSum,
+                                gi.bTimeSum, gi.bTimeCnt, gi.wTimeSum, gi.wTimeCnt);
+    }
 
-        for (const PlayerInfo& pi : players) {
-            int win, draw, loss;
-            pi.getWDLInfo(win, draw, loss);
-            double mean = pi.getMeanScore();
-            double sDev = pi.getStdDevScore();
-            if (pairMode) {
-                mean /= 2;
-                sDev /= 2;
-            }
-            os << pi.getName() << " : WDL: " << win << " - " << draw << " - " << loss
-                      << " m: " << mean << " sDev: " << sDev;
-            if (sDev > 0) {
-                std::stringstream ss;
-                ss.precision(2);
-                ss << std::fixed << (mean - 0.5) / sDev;
-                os << " c: " << ss.str();
-            }
-            os << std::endl;
-            double elo = 400 * log10(mean/(1-mean));
-            double drawRate = draw / (double)(win + draw + loss);
+    for (const PlayerInfo& pi : players) {
+        int win, draw, loss;
+        pi.getWDLInfo(win, draw, loss);
+        double mean = pi.getMeanScore();
+        double sDev = pi.getStdDevScore();
+        if (pairMode) {
+            mean /= 2;
+            sDev /= 2;
+        }
+        os << pi.getName() << " : WDL: " << win << " - " << draw << " - " << loss
+                  << " m: " << mean << " sDev: " << sDev;
+        if (sDev > 0) {
             std::stringstream ss;
-            ss.precision(1);
-            ss << "            elo: " << std::fixed << elo;
-            ss.precision(4);
-            ss << " draw: " << std::fixed << drawRate;
-            double myDepth, oppoDepth;
-            pi.getAvgDepth(myDepth, oppoDepth);
             ss.precision(2);
-            ss << " depth: " << std::fixed << myDepth << " - " << std::fixed << oppoDepth;
-            int myTime, oppoTime;
-            pi.getAvgTime(myTime, oppoTime);
-            ss << " time: " << myTime << " - " << oppoTime;
-            os << ss.str() << std::endl;
-            if (pairMode) {
-                int stat[5];
-                pi.getScoreStat(stat);
-                os << "            0.0 0.5 1.0 1.5 2.0 :";
-                for (int i = 0; i < 5; i++)
-                    os << ' ' << stat[i];
-                os << std::endl;
-                break;
-            }
+            ss << std::fixed << (mean - 0.5) / sDev;
+            os << " c: " << ss.str();
+        }
+        os << std::endl;
+        double elo = 400 * log10(mean/(1-mean));
+        double drawRate = draw / (double)(win + draw + loss);
+        std::stringstream ss;
+        ss.precision(1);
+        ss << "            elo: " << std::fixed << elo;
+        ss.precision(4);
+        ss << " draw: " << std::fixed << drawRate;
+        double myDepth, oppoDepth;
+        pi.getAvgDepth(myDepth, oppoDepth);
+        ss.precision(2);
+        ss << " depth: " << std::fixed << myDepth << " - " << std::fixed << oppoDepth;
+        int myTime, oppoTime;
+        pi.getAvgTime(myTime, oppoTime);
+        ss << " time: " << myTime << " - " << oppoTime;
+        os << ss.str() << std::endl;
+        if (pairMode) {
+            int stat[5];
+            pi.getScoreStat(stat);
+            os << "            0.0 0.5 1.0 1.5 2.0 :";
+            for (int i = 0; i < 5; i++)
+                os << ' ' << stat[i];
+            os << std::endl;
+            break;
         }
-    } catch (...) {
-        std::cerr << "Error parsing game " << nGames << std::endl;
-        throw;
     }
 }
 
@@ -28,6 +28,7 @@
 
 #include "util.hpp"
 #include "move.hpp"
+#include <istream>
 #include <ostream>
 #include <vector>
 #include <map>
@@ -46,6 +47,14 @@ public:
      * milliseconds. */
     void createBook(int depth, int searchTime, std::ostream& os);
 
+    /** Get the move sequences leading to all unique positions after
+     *  playing "depth" half-moves from the starting position. */
+    void getBookLines(int depth, std::vector<std::vector<Move>>& lines);
+
+    /** Read the move sequences from a book created by createBook().
+     *  Throws ChessParseError if a line is invalid. */
+    static void readBook(std::istream& is, std::vector<std::vector<Move>>& lines);
+
     /** Count number of unique positions in pgnFile at depth <= d
      *  for all d up to the longest game in pgnFile.
      *  PGN variations are ignored. */
@@ -54,6 +63,10 @@ public:
     /** Print statistics about all games in pgnFile. */
     void pgnStat(const std::string& pgnFile, bool pairMode, std::ostream& os);
 
+    /** Measure PGN parsing speed for pgnFile, using the game tree parser,
+     *  the main line parser and the main line parser on a memory mapped file. */
+    void pgnBench(const std::string& pgnFile, std::ostream& os);
+
 private:
     struct BookLine {
         BookLine() = default;
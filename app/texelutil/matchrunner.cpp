@@ -24,13 +24,17 @@
  */
 
 #include "matchrunner.hpp"
+#include "matchbookcreator.hpp"
 #include "gsprt.hpp"
+#include "nativegamerunner.hpp"
+#include "chessError.hpp"
 #include "threadpool.hpp"
 #include "util.hpp"
 #include "timeUtil.hpp"
 
 #include <atomic>
 #include <cmath>
+#include <fstream>
 #include <iostream>
 
 
@@ -38,8 +42,42 @@ MatchRunner::MatchRunner(int nWorkers, const EngineParams& engine1, const Engine
     : nWorkers(nWorkers), engine1Pars(engine1), engine2Pars(engine2) {
 }
 
+MatchRunner::~MatchRunner() = default;
+
+void
+MatchRunner::setNative(int hashMB, const std::string& bookFile) {
+    if (engine1Pars.name != engine2Pars.name)
+        throw ChessParseError("Native mode requires equal engine names, "
+                              "both engines use the same parameters");
+    auto tc1 = NativeGameRunner::TimeControl::parse(engine1Pars.timeControl);
+    auto tc2 = NativeGameRunner::TimeControl::parse(engine2Pars.timeControl);
+    std::vector<std::vector<Move>> openings;
+    if (bookFile.empty()) {
+        MatchBookCreator mbc(1);
+        mbc.getBookLines(3, openings);
+    } else {
+        std::ifstream is(bookFile);
+        if (!is)
+            throw ChessParseError("Failed to open file: " + bookFile);
+        MatchBookCreator::readBook(is, openings);
+        if (openings.empty())
+            throw ChessParseError("No opening lines in file: " + bookFile);
+    }
+
+    native = std::make_unique<NativeGameRunner>(nWorkers, tc1, tc2, hashMB, openings);
+}
+
+int
+MatchRunner::batchSize() const {
+    return native ? 2 : 100;
+}
+
 bool
 MatchRunner::runOneBatch(const std::string& script, int workerNo, int (&stats)[5]) const {
+    if (native) {
+        native->playGamePair(workerNo, stats);
+        return true;
+    }
 #if _MSC_VER
     return false;
 #else
@@ -93,10 +131,16 @@ computeStats(const int (&batchStats)[5], int (&totStats)[5], int& nPlayed, doubl
     elo = std::rint(elo * 10) / 10;
 }
 
+/** Return number of games played per minute, rounded to one decimal. */
+static double
+gamesPerMinute(int nPlayed, double t) {
+    return t > 0 ? std::rint(nPlayed * 60 / t * 10) / 10 : 0;
+}
+
 void
 MatchRunner::runFixedNumGames(int numGames, const std::string& script) const {
     std::atomic<bool> error(false);
-    const int batchSize = 100;
+    const int batchSize = this->batchSize();
 
     struct Result {
         int workerNo;
@@ -129,6 +173,7 @@ MatchRunner::runFixedNumGames(int numGames, const std::string& script) const {
         std::cout << "c:" << r.workerNo
                   << " n:" << nPlayed
                   << " t:" << (int)(t1 - t0)
+                  << " gpm:" << gamesPerMinute(nPlayed, t1 - t0)
                   << " s:" << score << " elo:" << elo
                   << " :";
         for (int i = 0; i < 5; i++)
@@ -200,6 +245,7 @@ MatchRunner::runGsprtGames(const Gsprt::InParams& gsprtParams, const std::string
         std::cout << "c:" << r.workerNo
                   << " n:" << nPlayed
                   << " t:" << (int)(t1 - t0)
+                  << " gpm:" << gamesPerMinute(nPlayed, t1 - t0)
                   << " llr: " << relLlr
                   << " s:" << score << " elo:" << elo
                   << " :";
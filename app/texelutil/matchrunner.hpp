@@ -29,6 +29,9 @@
 #include "gsprt.hpp"
 
 #include <string>
+#include <memory>
+
+class NativeGameRunner;
 
 
 /** Runs a match between two chess engines. */
@@ -42,6 +45,19 @@ public:
     /** Constructor. */
     MatchRunner(int nWorkers, const EngineParams& engine1, const EngineParams& engine2);
 
+    /** Destructor. */
+    ~MatchRunner();
+
+    /** Play the games in this process instead of running an external script.
+     *  Each engine instance uses its own transposition table of size hashMB.
+     *  Opening lines are read from bookFile, which has the format created by
+     *  the creatematchbook command. If bookFile is empty, all positions after
+     *  three plies from the starting position are used.
+     *  Search and evaluation parameters are process global, so both engines
+     *  use the same parameter set. Throws ChessParseError if the engine names
+     *  differ, since such a match would not compare the intended engines. */
+    void setNative(int hashMB, const std::string& bookFile);
+
     /** Run a fixed number of games. */
     void runFixedNumGames(int numGames, const std::string& script) const;
 
@@ -53,9 +69,13 @@ private:
      *  @return True if script succeeded. */
     bool runOneBatch(const std::string& script, int workerNo, int (&stats)[5]) const;
 
+    /** Number of games played by one call to runOneBatch(). */
+    int batchSize() const;
+
     const int nWorkers;   // Number of worker threads to use
     EngineParams engine1Pars;
     EngineParams engine2Pars;
+    std::unique_ptr<NativeGameRunner> native; // Null if games are played by a script
 };
 
 
@@ -44,6 +44,7 @@
 #include <fstream>
 #include <iomanip>
 #include <climits>
+#include <mutex>
 
 bool
 PosGenerator::generate(const std::string& type) {
@@ -253,33 +254,44 @@ getEPSquares(const Position& pos) {
     }
 }
 
-template <typename Func>
-static void
-iteratePositions(const std::string& tbType, bool skipSymmetric, Func func) {
-    std::vector<int> pieces;
+/** Information about the pieces in a tablebase type. */
+struct TBTypeInfo {
+    explicit TBTypeInfo(const std::string& tbType);
+
+    std::vector<int> pieces; // Non-king pieces
+    bool anyPawns;
+    bool epPossible;
+    bool symTable;           // True if white and black have the same pieces
+};
+
+TBTypeInfo::TBTypeInfo(const std::string& tbType) {
     bool whitePawns, blackPawns;
     getPieces(tbType, pieces, whitePawns, blackPawns);
-    const int nPieces = pieces.size();
-    const bool anyPawns = whitePawns || blackPawns;
-    const bool epPossible = whitePawns && blackPawns;
-
-    bool symTable = true; // True if white and black have the same pieces
-    {
-        int nPieces[Piece::nPieceTypes] = { 0 };
-        for (int p : pieces)
-            nPieces[p]++;
-        for (int pt = Piece::WQUEEN; pt <= Piece::WPAWN; pt++)
-            if (nPieces[pt] != nPieces[Piece::makeBlack(pt)])
-                symTable = false;
-    }
+    anyPawns = whitePawns || blackPawns;
+    epPossible = whitePawns && blackPawns;
+
+    symTable = true;
+    int nPieces[Piece::nPieceTypes] = { 0 };
+    for (int p : pieces)
+        nPieces[p]++;
+    for (int pt = Piece::WQUEEN; pt <= Piece::WPAWN; pt++)
+        if (nPieces[pt] != nPieces[Piece::makeBlack(pt)])
+            symTable = false;
+}
 
+/** Return all king square combinations to consider when iterating over
+ *  the positions in a tablebase. The combinations are returned in the
+ *  order used by iteratePositions(). */
+static std::vector<std::pair<Square,Square>>
+getKingSquares(const TBTypeInfo& info, bool skipSymmetric) {
+    std::vector<std::pair<Square,Square>> ret;
     for (Square wk : AllSquares()) {
         int x = wk.getX();
         int y = wk.getY();
         if (skipSymmetric) {
             if (x >= 4)
                 continue;
-            if (!anyPawns)
+            if (!info.anyPawns)
                 if (y >= 4 || y < x)
                     continue;
         }
@@ -288,109 +300,129 @@ iteratePositions(const std::string& tbType, bool skipSymmetric, Func func) {
             int y2 = bk.getY();
             if (std::abs(x2-x) < 2 && std::abs(y2-y) < 2)
                 continue;
+            ret.emplace_back(wk, bk);
+        }
+    }
+    return ret;
+}
 
-            Position pos;
-            pos.setPiece(wk, Piece::WKING);
-            pos.setPiece(bk, Piece::BKING);
-            std::vector<int> squares(nPieces, 0);
-            int nPlaced = 0;
-
-            while (true) {
-                // Place remaining pieces on first empty square. Multiple equal
-                // pieces are placed starting with the lowest square.
-                while (nPlaced < nPieces) {
-                    const int p = pieces[nPlaced];
-                    int first = 0;
-                    if (nPlaced > 0 && pieces[nPlaced-1] == p)
-                        first = squares[nPlaced-1] + 1;
-                    bool ok = false;
-                    for (int sq = first; sq < 64; sq++) {
-                        if (!squareValid(sq, p))
-                            continue;
-                        if (pos.getPiece(Square(sq)) == Piece::EMPTY) {
-                            pos.setPiece(Square(sq), p);
-                            squares[nPlaced] = sq;
-                            nPlaced++;
-                            ok = true;
-                            break;
-                        }
-                    }
-                    if (!ok)
-                        break;
+/** Call func(pos) for all positions in a given tablebase where the white
+ *  king is on wk and the black king is on bk. */
+template <typename Func>
+static void
+iterateKingPositions(const TBTypeInfo& info, bool skipSymmetric,
+                     Square wk, Square bk, Func func) {
+    const std::vector<int>& pieces = info.pieces;
+    const int nPieces = pieces.size();
+
+    Position pos;
+    pos.setPiece(wk, Piece::WKING);
+    pos.setPiece(bk, Piece::BKING);
+    std::vector<int> squares(nPieces, 0);
+    int nPlaced = 0;
+
+    while (true) {
+        // Place remaining pieces on first empty square. Multiple equal
+        // pieces are placed starting with the lowest square.
+        while (nPlaced < nPieces) {
+            const int p = pieces[nPlaced];
+            int first = 0;
+            if (nPlaced > 0 && pieces[nPlaced-1] == p)
+                first = squares[nPlaced-1] + 1;
+            bool ok = false;
+            for (int sq = first; sq < 64; sq++) {
+                if (!squareValid(sq, p))
+                    continue;
+                if (pos.getPiece(Square(sq)) == Piece::EMPTY) {
+                    pos.setPiece(Square(sq), p);
+                    squares[nPlaced] = sq;
+                    nPlaced++;
+                    ok = true;
+                    break;
                 }
+            }
+            if (!ok)
+                break;
+        }
 
-                if (nPlaced == nPieces) {
-                    pos.setWhiteMove(true);
-                    bool wKingAttacked = MoveGen::sqAttacked(pos, wk);
-                    pos.setWhiteMove(false);
-                    bool bKingAttacked = MoveGen::sqAttacked(pos, bk);
-                    for (int side = 0; side < 2; side++) {
-                        bool white = side == 0;
-                        if (white) {
-                            if (bKingAttacked)
-                                continue;
-                        } else {
-                            if (wKingAttacked)
-                                continue;
-                        }
-                        if (skipSymmetric && symTable && !white)
-                            continue;
-                        pos.setWhiteMove(white);
-
-                        U64 epSquares = epPossible ? getEPSquares(pos) : 0;
-                        while (true) {
-                            if (epSquares) {
-                                Square epSq = BitBoard::firstSquare(epSquares);
-                                pos.setEpSquare(epSq);
-                                TextIO::fixupEPSquare(pos);
-                                if (!pos.getEpSquare().isValid()) {
-                                    epSquares &= epSquares - 1;
-                                    continue;
-                                }
-                            } else {
-                                pos.setEpSquare(Square(-1));
-                            }
-                            func(pos);
-                            if (epSquares == 0)
-                                break;
-                            epSquares &= epSquares - 1;
-                        }
-                    }
+        if (nPlaced == nPieces) {
+            pos.setWhiteMove(true);
+            bool wKingAttacked = MoveGen::sqAttacked(pos, wk);
+            pos.setWhiteMove(false);
+            bool bKingAttacked = MoveGen::sqAttacked(pos, bk);
+            for (int side = 0; side < 2; side++) {
+                bool white = side == 0;
+                if (white) {
+                    if (bKingAttacked)
+                        continue;
+                } else {
+                    if (wKingAttacked)
+                        continue;
                 }
+                if (skipSymmetric && info.symTable && !white)
+                    continue;
+                pos.setWhiteMove(white);
 
-                // Set up next position
-                bool done = false;
+                U64 epSquares = info.epPossible ? getEPSquares(pos) : 0;
                 while (true) {
-                    nPlaced--;
-                    if (nPlaced < 0) {
-                        done = true;
-                        break;
-                    }
-                    int sq0 = squares[nPlaced];
-                    int p = pos.getPiece(Square(sq0));
-                    pos.setPiece(Square(sq0), Piece::EMPTY);
-                    bool foundEmpty = false;
-                    for (int sq = sq0 + 1; sq < 64; sq++) {
-                        if (!squareValid(sq, p))
+                    if (epSquares) {
+                        Square epSq = BitBoard::firstSquare(epSquares);
+                        pos.setEpSquare(epSq);
+                        TextIO::fixupEPSquare(pos);
+                        if (!pos.getEpSquare().isValid()) {
+                            epSquares &= epSquares - 1;
                             continue;
-                        if (pos.getPiece(Square(sq)) == Piece::EMPTY) {
-                            pos.setPiece(Square(sq), p);
-                            squares[nPlaced] = sq;
-                            nPlaced++;
-                            foundEmpty = true;
-                            break;
                         }
+                    } else {
+                        pos.setEpSquare(Square(-1));
                     }
-                    if (foundEmpty)
+                    func(pos);
+                    if (epSquares == 0)
                         break;
+                    epSquares &= epSquares - 1;
                 }
-                if (done)
+            }
+        }
+
+        // Set up next position
+        bool done = false;
+        while (true) {
+            nPlaced--;
+            if (nPlaced < 0) {
+                done = true;
+                break;
+            }
+            int sq0 = squares[nPlaced];
+            int p = pos.getPiece(Square(sq0));
+            pos.setPiece(Square(sq0), Piece::EMPTY);
+            bool foundEmpty = false;
+            for (int sq = sq0 + 1; sq < 64; sq++) {
+                if (!squareValid(sq, p))
+                    continue;
+                if (pos.getPiece(Square(sq)) == Piece::EMPTY) {
+                    pos.setPiece(Square(sq), p);
+                    squares[nPlaced] = sq;
+                    nPlaced++;
+                    foundEmpty = true;
                     break;
+                }
             }
+            if (foundEmpty)
+                break;
         }
+        if (done)
+            break;
     }
 }
 
+template <typename Func>
+static void
+iteratePositions(const std::string& tbType, bool skipSymmetric, Func func) {
+    TBTypeInfo info(tbType);
+    for (const auto& kk : getKingSquares(info, skipSymmetric))
+        iterateKingPositions(info, skipSymmetric, kk.first, kk.second, func);
+}
+
 /** Call func(pos) for all positions in a given tablebase.
  * func() must not modify pos. */
 template <typename Func>
@@ -399,53 +431,131 @@ iteratePositions(const std::string& tbType, Func func) {
     iteratePositions(tbType, true, func);
 }
 
+/** Call func(workerNo, taskNo, pos) for all positions in a given tablebase, using
+ *  nWorkers threads. The positions are split into tasks, one for each king square
+ *  combination. A task corresponds to a contiguous part of the tablebase index
+ *  space and is handled by a single worker, which improves probe cache locality.
+ *  Tasks are numbered in the same order as iteratePositions() visits them.
+ *  Return the number of tasks. func() must not modify pos. */
+template <typename Func>
+static int
+iteratePositionsParallel(const std::string& tbType, bool skipSymmetric, int nWorkers, Func func) {
+    TBTypeInfo info(tbType);
+    std::vector<std::pair<Square,Square>> kingSquares = getKingSquares(info, skipSymmetric);
+    const int nTasks = kingSquares.size();
+    ThreadPool<int> pool(nWorkers);
+    for (int t = 0; t < nTasks; t++) {
+        Square wk = kingSquares[t].first;
+        Square bk = kingSquares[t].second;
+        pool.addTask([&info,&func,skipSymmetric,wk,bk,t](int workerNo) {
+            iterateKingPositions(info, skipSymmetric, wk, bk, [&](Position& pos) {
+                func(workerNo, t, pos);
+            });
+            return t;
+        });
+    }
+    pool.getAllResults([](int){});
+    return nTasks;
+}
+
+template <typename Func>
+static int
+iteratePositionsParallel(const std::string& tbType, int nWorkers, Func func) {
+    return iteratePositionsParallel(tbType, true, nWorkers, func);
+}
+
+/** Print number of positions and positions per second. */
+static void
+printSpeed(U64 nPos, double t) {
+    std::cout << " nPos:" << nPos << " t:" << t
+              << " pos/s:" << (U64)(t > 0 ? nPos / t : 0) << std::endl;
+}
+
+/** Best score found so far and the position having that score. Used to find the
+ *  same position as a single threaded search would find when positions are
+ *  searched in parallel. */
+struct ScorePos {
+    int score;
+    int taskNo = std::numeric_limits<int>::max();
+    Position pos;
+
+    explicit ScorePos(int score0) : score(score0) {}
+
+    /** Update if (s, t) is better than current, as determined by "better(s, score)".
+     *  Ties are resolved by preferring the smallest task number. */
+    template <typename Better>
+    void update(int s, int t, const Position& p, Better better) {
+        if (better(s, score) || (s == score && t < taskNo)) {
+            score = s;
+            taskNo = t;
+            pos = p;
+        }
+    }
+    template <typename Better>
+    void update(const ScorePos& other, Better better) {
+        if (other.taskNo != std::numeric_limits<int>::max())
+            update(other.score, other.taskNo, other.pos, better);
+    }
+};
+
 void
-PosGenerator::dtmStat(const std::vector<std::string>& tbTypes) {
+PosGenerator::dtmStat(const std::vector<std::string>& tbTypes, int nWorkers) {
     ChessTool::setupTB();
     for (std::string tbType : tbTypes) {
         double t0 = currentTime();
-        int negScore = std::numeric_limits<int>::min(); // Largest negative score
-        int posScore = std::numeric_limits<int>::max(); // Smallest positive score
-        Position negPos, posPos;
-        U64 nPos = 0;
-        iteratePositions(tbType, [&](Position& pos) {
-            nPos++;
+        struct WorkerStat {
+            ScorePos neg { std::numeric_limits<int>::min() }; // Largest negative score
+            ScorePos pos { std::numeric_limits<int>::max() }; // Smallest positive score
+            U64 nPos = 0;
+        };
+        auto less = [](int a, int b) { return a < b; };
+        auto greater = [](int a, int b) { return a > b; };
+        std::vector<WorkerStat> stat(nWorkers);
+        iteratePositionsParallel(tbType, nWorkers, [&](int workerNo, int taskNo, Position& pos) {
+            WorkerStat& ws = stat[workerNo];
+            ws.nPos++;
             int score;
             if (!TBProbe::gtbProbeDTM(pos, 0, score))
                 throw ChessError("GTB probe failed, pos:" + TextIO::toFEN(pos));
             if (score > 0) {
-                if (score < posScore) {
-                    posScore = score;
-                    posPos = pos;
-                }
+                ws.pos.update(score, taskNo, pos, less);
             } else if (score < 0) {
-                if (score > negScore) {
-                    negScore = score;
-                    negPos = pos;
-                }
+                ws.neg.update(score, taskNo, pos, greater);
             }
         });
+        WorkerStat sum;
+        for (const WorkerStat& ws : stat) {
+            sum.nPos += ws.nPos;
+            sum.pos.update(ws.pos, less);
+            sum.neg.update(ws.neg, greater);
+        }
         double t1 = currentTime();
-        std::cout << tbType << " neg: " << negScore << " pos:" << posScore << " nPos:" << nPos
-                  << " t:" << (t1-t0) << std::endl;
-        std::cout << tbType << " negPos: " << TextIO::toFEN(negPos) << std::endl;
-        std::cout << tbType << " posPos: " << TextIO::toFEN(posPos) << std::endl;
+        std::cout << tbType << " neg: " << sum.neg.score << " pos:" << sum.pos.score;
+        printSpeed(sum.nPos, t1 - t0);
+        std::cout << tbType << " negPos: " << TextIO::toFEN(sum.neg.pos) << std::endl;
+        std::cout << tbType << " posPos: " << TextIO::toFEN(sum.pos.pos) << std::endl;
     }
 }
 
 void
-PosGenerator::dtzStat(const std::vector<std::string>& tbTypes) {
+PosGenerator::dtzStat(const std::vector<std::string>& tbTypes, int nWorkers) {
     ChessTool::setupTB();
+    std::mutex mutex;
     for (std::string tbType : tbTypes) {
         double t0 = currentTime();
-        int negScore = std::numeric_limits<int>::max(); // Smallest negative score
-        int posScore = std::numeric_limits<int>::min(); // Largest positive score
-        Position negPos, posPos;
-        U64 nPos = 0;
+        struct WorkerStat {
+            ScorePos neg { std::numeric_limits<int>::max() }; // Smallest negative score
+            ScorePos pos { std::numeric_limits<int>::min() }; // Largest positive score
+            U64 nPos = 0;
+        };
+        auto less = [](int a, int b) { return a < b; };
+        auto greater = [](int a, int b) { return a > b; };
+        std::vector<WorkerStat> stat(nWorkers);
         int negReported = -1000;
         int posReported = 1000;
-        iteratePositions(tbType, [&](Position& pos) {
-            nPos++;
+        iteratePositionsParallel(tbType, nWorkers, [&](int workerNo, int taskNo, Position& pos) {
+            WorkerStat& ws = stat[workerNo];
+            ws.nPos++;
             int success;
             int dtz = Syzygy::probe_dtz(pos, &success, true);
             if (!success)
@@ -455,33 +565,39 @@ PosGenerator::dtzStat(const std::vector<std::string>& tbTypes) {
                 throw ChessError("RTB probe failed, pos:" + TextIO::toFEN(pos));
             if (dtz > 0) {
                 if (wdl == 2) {
-                    if (dtz > posScore) {
-                        posScore = dtz;
-                        posPos = pos;
-                    }
-                    if (dtz > 100 && dtz < posReported) {
-                        posReported = dtz;
-                        std::cout << "fen: " << TextIO::toFEN(pos) << " dtz:" << dtz << std::endl;
+                    ws.pos.update(dtz, taskNo, pos, greater);
+                    if (dtz > 100) {
+                        std::lock_guard<std::mutex> L(mutex);
+                        if (dtz < posReported) {
+                            posReported = dtz;
+                            std::cout << "fen: " << TextIO::toFEN(pos) << " dtz:" << dtz << std::endl;
+                        }
                     }
                 }
             } else if (dtz < 0) {
                 if (wdl == -2) {
-                    if (dtz < negScore) {
-                        negScore = dtz;
-                        negPos = pos;
-                    }
-                    if (dtz < -100 && dtz > negReported) {
-                        negReported = dtz;
-                        std::cout << "fen: " << TextIO::toFEN(pos) << " dtz:" << dtz << std::endl;
+                    ws.neg.update(dtz, taskNo, pos, less);
+                    if (dtz < -100) {
+                        std::lock_guard<std::mutex> L(mutex);
+                        if (dtz > negReported) {
+                            negReported = dtz;
+                            std::cout << "fen: " << TextIO::toFEN(pos) << " dtz:" << dtz << std::endl;
+                        }
                     }
                 }
             }
         });
+        WorkerStat sum;
+        for (const WorkerStat& ws : stat) {
+            sum.nPos += ws.nPos;
+            sum.pos.update(ws.pos, greater);
+            sum.neg.update(ws.neg, less);
+        }
         double t1 = currentTime();
-        std::cout << tbType << " neg: " << negScore << " pos:" << posScore << " nPos:" << nPos
-                  << " t:" << (t1-t0) << std::endl;
-        std::cout << tbType << " negPos: " << TextIO::toFEN(negPos) << std::endl;
-        std::cout << tbType << " posPos: " << TextIO::toFEN(posPos) << std::endl;
+        std::cout << tbType << " neg: " << sum.neg.score << " pos:" << sum.pos.score;
+        printSpeed(sum.nPos, t1 - t0);
+        std::cout << tbType << " negPos: " << TextIO::toFEN(sum.neg.pos) << std::endl;
+        std::cout << tbType << " posPos: " << TextIO::toFEN(sum.pos.pos) << std::endl;
     }
 }
 
@@ -510,7 +626,8 @@ getPieceType(const std::string& s) {
 }
 
 void
-PosGenerator::egStat(const std::string& tbType, const std::vector<std::string>& pieceTypes) {
+PosGenerator::egStat(const std::string& tbType, const std::vector<std::string>& pieceTypes,
+                     int nWorkers) {
     ChessTool::setupTB();
     double t0 = currentTime();
 
@@ -522,39 +639,64 @@ PosGenerator::egStat(const std::string& tbType, const std::vector<std::string>&
         ptVec.push_back(p);
     }
 
-    TranspositionTable tt(512*1024);
-    Notifier notifier;
-    ThreadCommunicator comm(nullptr, tt, notifier, false);
-    std::vector<U64> nullHist(SearchConst::MAX_SEARCH_DEPTH * 2);
-    KillerTable kt;
-    History ht;
-    auto et = Evaluate::getEvalHashTables();
-    Search::SearchTables st(comm.getCTT(), kt, ht, *et);
-    TreeLogger treeLog;
-    TranspositionTable::TTEntry ent;
-
     struct ScoreStat { U64 whiteWin = 0, draw = 0, blackWin = 0; };
-    std::map<std::vector<int>, ScoreStat> stat; // sequence of squares -> wdl statistics
-    std::vector<int> key;
+    using StatMap = std::map<std::vector<int>, ScoreStat>; // sequence of squares -> wdl statistics
+
+    /** Search data and statistics for one worker thread. */
+    struct WorkerData {
+        TranspositionTable tt { 512*1024 };
+        Notifier notifier;
+        ThreadCommunicator comm { nullptr, tt, notifier, false };
+        std::vector<U64> nullHist = std::vector<U64>(SearchConst::MAX_SEARCH_DEPTH * 2);
+        KillerTable kt;
+        History ht;
+        std::unique_ptr<Evaluate::EvalHashTables> et = Evaluate::getEvalHashTables();
+        Search::SearchTables st { comm.getCTT(), kt, ht, *et };
+        TreeLogger treeLog;
+        TranspositionTable::TTEntry ent;
+        std::vector<int> key;
+
+        StatMap stat;
+        U64 total = 0, rejected = 0;
+    };
+    std::vector<std::unique_ptr<WorkerData>> wData(nWorkers);
+    for (auto& wd : wData)
+        wd = std::make_unique<WorkerData>();
+
     ScoreToProb s2p;
+    std::mutex mutex;
     U64 total = 0, rejected = 0, nextReport = 0;
-    iteratePositions(tbType, false, [&](Position& pos) {
-        total++;
+    iteratePositionsParallel(tbType, false, nWorkers, [&](int workerNo, int taskNo, Position& pos) {
+        WorkerData& wd = *wData[workerNo];
+        wd.total++;
+        if ((wd.total & 0xffff) == 0) {
+            std::lock_guard<std::mutex> L(mutex);
+            total += 0x10000;
+            if (total >= nextReport) {
+                nextReport += 4*1024*1024;
+                std::cerr << "total:" << total << " rejected:" << rejected << std::endl;
+            }
+        }
         int evScore, qScore;
         {
             const int mate0 = SearchConst::MATE0;
-            Search sc(pos, nullHist, 0, st, comm, treeLog);
-            sc.init(pos, nullHist, 0);
+            Search sc(pos, wd.nullHist, 0, wd.st, wd.comm, wd.treeLog);
+            sc.init(pos, wd.nullHist, 0);
             qScore = sc.quiesce(-mate0, mate0, 0, 0, MoveGen::inCheck(pos));
-            Evaluate ev(*et);
+            Evaluate ev(*wd.et);
             ev.connectPosition(pos);
             evScore = ev.evalPos();
             if (std::abs(s2p.getProb(qScore) - s2p.getProb(evScore)) > 0.25) {
-                rejected++;
+                wd.rejected++;
+                if ((wd.rejected & 0xffff) == 0) {
+                    std::lock_guard<std::mutex> L(mutex);
+                    rejected += 0x10000;
+                }
                 return;
             }
         }
 
+        std::vector<int>& key = wd.key;
         key.clear();
         for (auto pt : ptVec) {
             U64 m = pos.pieceTypeBB(pt);
@@ -563,10 +705,10 @@ PosGenerator::egStat(const std::string& tbType, const std::vector<std::string>&
                 key.push_back(sq.asInt());
             }
         }
-        ScoreStat& ss = stat[key];
+        ScoreStat& ss = wd.stat[key];
 
         int score;
-        if (!TBProbe::rtbProbeWDL(pos, 0, score, ent))
+        if (!TBProbe::rtbProbeWDL(pos, 0, score, wd.ent))
             throw ChessError("RTB probe failed, pos:" + TextIO::toFEN(pos));
         if (!pos.isWhiteMove())
             score = -score;
@@ -576,12 +718,20 @@ PosGenerator::egStat(const std::string& tbType, const std::vector<std::string>&
             ss.blackWin++;
         else
             ss.draw++;
+    });
 
-        if (total >= nextReport) {
-            nextReport += 4*1024*1024;
-            std::cerr << "total:" << total << " rejected:" << rejected << std::endl;
+    // Merge worker statistics
+    StatMap stat;
+    total = 0;
+    for (const auto& wd : wData) {
+        total += wd->total;
+        for (const auto& p : wd->stat) {
+            ScoreStat& ss = stat[p.first];
+            ss.whiteWin += p.second.whiteWin;
+            ss.draw += p.second.draw;
+            ss.blackWin += p.second.blackWin;
         }
-    });
+    }
     double t1 = currentTime();
 
     int nDigits = 1;
@@ -614,20 +764,25 @@ PosGenerator::egStat(const std::string& tbType, const std::vector<std::string>&
                   << std::setw(nDigits+1) << ss.blackWin
                   << ' ' << static_cast<int>(e * 1000 + 0.5) << '\n';
     }
-    std::cout << " t:" << (t1-t0) << std::endl;
+    printSpeed(total, t1 - t0);
 }
 
 void
-PosGenerator::wdlTest(const std::vector<std::string>& tbTypes) {
+PosGenerator::wdlTest(const std::vector<std::string>& tbTypes, int nWorkers) {
     ChessTool::setupTB();
-    TranspositionTable::TTEntry ent;
+    std::mutex mutex;
     for (std::string tbType : tbTypes) {
         double t0 = currentTime();
-        U64 nPos = 0, nDiff = 0, nDiff50 = 0;
-        iteratePositions(tbType, [&](Position& pos) {
-            nPos++;
+        struct WorkerStat {
+            U64 nPos = 0, nDiff = 0, nDiff50 = 0;
+            TranspositionTable::TTEntry ent;
+        };
+        std::vector<WorkerStat> stat(nWorkers);
+        iteratePositionsParallel(tbType, nWorkers, [&](int workerNo, int taskNo, Position& pos) {
+            WorkerStat& ws = stat[workerNo];
+            ws.nPos++;
             int rtbScore, gtbScore;
-            if (!TBProbe::rtbProbeWDL(pos, 0, rtbScore, ent))
+            if (!TBProbe::rtbProbeWDL(pos, 0, rtbScore, ws.ent))
                 throw ChessError("RTB probe failed, pos:" + TextIO::toFEN(pos));
             if (!TBProbe::gtbProbeWDL(pos, 0, gtbScore))
                 throw ChessError("GTB probe failed, pos:" + TextIO::toFEN(pos));
@@ -644,67 +799,123 @@ PosGenerator::wdlTest(const std::vector<std::string>& tbTypes) {
                         throw ChessError("GTB probe failed, pos:" + TextIO::toFEN(pos));
                     if (std::abs(scoreDTM) < SearchConst::MATE0 - 100) {
                         diff = false;
-                        nDiff50++;
+                        ws.nDiff50++;
                     }
                 }
             }
             if (diff) {
-                nDiff++;
+                ws.nDiff++;
+                std::lock_guard<std::mutex> L(mutex);
                 std::cout << tbType << " rtb:" << rtbScore << " gtb:" << gtbScore
                           << " pos:" << TextIO::toFEN(pos) << std::endl;
             }
         });
+        WorkerStat sum;
+        for (const WorkerStat& ws : stat) {
+            sum.nPos += ws.nPos;
+            sum.nDiff += ws.nDiff;
+            sum.nDiff50 += ws.nDiff50;
+        }
         double t1 = currentTime();
-        std::cout << tbType << " nPos:" << nPos << " nDiff:" << nDiff << " nDiff50:" << nDiff50
-                  << " t:" << (t1-t0) << std::endl;
+        std::cout << tbType << " nDiff:" << sum.nDiff << " nDiff50:" << sum.nDiff50;
+        printSpeed(sum.nPos, t1 - t0);
     }
 }
 
 void
-PosGenerator::wdlDump(const std::vector<std::string>& tbTypes) {
+PosGenerator::wdlDump(const std::vector<std::string>& tbTypes, int nWorkers) {
     ChessTool::setupTB();
     std::ofstream ofs("out.bin", std::ios::binary);
     for (std::string tbType : tbTypes) {
         double t0 = currentTime();
-        U64 nPos = 0;
-        U64 cnt[5] = {0, 0, 0, 0, 0};
-        iteratePositions(tbType, [&](Position& pos) {
-            nPos++;
+        struct WorkerStat {
+            U64 nPos = 0;
+            U64 cnt[5] = {0, 0, 0, 0, 0};
+        };
+        std::vector<WorkerStat> stat(nWorkers);
+
+        // Output must be in iteration order, so each task writes to its own buffer.
+        // A buffer is written to the file when all earlier tasks are finished.
+        std::mutex mutex;
+        std::vector<std::vector<S8>> taskData;
+        std::vector<bool> taskDone;
+        int nextToWrite = 0;
+        auto finishTask = [&](int taskNo) {
+            std::lock_guard<std::mutex> L(mutex);
+            taskDone[taskNo] = true;
+            while (nextToWrite < (int)taskDone.size() && taskDone[nextToWrite]) {
+                std::vector<S8>& data = taskData[nextToWrite];
+                ofs.write((const char*)data.data(), data.size());
+                std::vector<S8>().swap(data);
+                nextToWrite++;
+            }
+        };
+        {
+            TBTypeInfo info(tbType);
+            size_t nTasks = getKingSquares(info, true).size();
+            taskData.resize(nTasks);
+            taskDone.resize(nTasks);
+        }
+        std::vector<int> currTask(nWorkers, -1);
+        iteratePositionsParallel(tbType, nWorkers, [&](int workerNo, int taskNo, Position& pos) {
+            if (currTask[workerNo] != taskNo) {
+                if (currTask[workerNo] >= 0)
+                    finishTask(currTask[workerNo]);
+                currTask[workerNo] = taskNo;
+            }
+            WorkerStat& ws = stat[workerNo];
+            ws.nPos++;
             int success;
             int wdl = Syzygy::probe_wdl(pos, &success);
             if (!success)
                 throw ChessError("RTB probe failed, pos:" + TextIO::toFEN(pos));
             if (!pos.isWhiteMove())
                 wdl = -wdl;
-            cnt[wdl+2]++;
-            S8 c = wdl;
-            ofs.write((const char*)&c, 1);
+            ws.cnt[wdl+2]++;
+            taskData[taskNo].push_back(wdl);
         });
+        for (int taskNo = 0; taskNo < (int)taskDone.size(); taskNo++)
+            if (!taskDone[taskNo])
+                finishTask(taskNo); // Last task for each worker, and tasks without positions
+
+        WorkerStat sum;
+        for (const WorkerStat& ws : stat) {
+            sum.nPos += ws.nPos;
+            for (int i = 0; i < 5; i++)
+                sum.cnt[i] += ws.cnt[i];
+        }
         double t1 = currentTime();
-        std::cout << tbType << " nPos:" << nPos << " t:" << (t1-t0) << std::endl;
-        std::cout << cnt[0] << ' ' << cnt[1] << ' ' << cnt[2] << ' ' << cnt[3] << ' ' << cnt[4] << std::endl;
+        std::cout << tbType;
+        printSpeed(sum.nPos, t1 - t0);
+        std::cout << sum.cnt[0] << ' ' << sum.cnt[1] << ' ' << sum.cnt[2] << ' '
+                  << sum.cnt[3] << ' ' << sum.cnt[4] << std::endl;
     }
 }
 
 void
-PosGenerator::dtzTest(const std::vector<std::string>& tbTypes) {
+PosGenerator::dtzTest(const std::vector<std::string>& tbTypes, int nWorkers) {
     ChessTool::setupTB();
-    TranspositionTable::TTEntry ent;
+    std::mutex mutex;
     for (std::string tbType : tbTypes) {
         double t0 = currentTime();
-        U64 nPos = 0, nDiff = 0, nDiff50 = 0;
-        int minSlack = std::numeric_limits<int>::max();
-        int maxSlack = std::numeric_limits<int>::min();
-        int minSlack2 = std::numeric_limits<int>::max();
-        int maxSlack2 = std::numeric_limits<int>::min();
-        iteratePositions(tbType, [&](Position& pos) {
-            nPos++;
+        struct WorkerStat {
+            U64 nPos = 0, nDiff = 0, nDiff50 = 0;
+            int minSlack = std::numeric_limits<int>::max();
+            int maxSlack = std::numeric_limits<int>::min();
+            int minSlack2 = std::numeric_limits<int>::max();
+            int maxSlack2 = std::numeric_limits<int>::min();
+            TranspositionTable::TTEntry ent;
+        };
+        std::vector<WorkerStat> stat(nWorkers);
+        iteratePositionsParallel(tbType, nWorkers, [&](int workerNo, int taskNo, Position& pos) {
+            WorkerStat& ws = stat[workerNo];
+            ws.nPos++;
             int dtz, dtm, wdl;
-            if (!TBProbe::rtbProbeDTZ(pos, 0, dtz, ent))
+            if (!TBProbe::rtbProbeDTZ(pos, 0, dtz, ws.ent))
                 throw ChessError("RTB probe failed, pos:" + TextIO::toFEN(pos));
             if (!TBProbe::gtbProbeDTM(pos, 0, dtm))
                 throw ChessError("GTB probe failed, pos:" + TextIO::toFEN(pos));
-            if (!TBProbe::rtbProbeWDL(pos, 0, wdl, ent))
+            if (!TBProbe::rtbProbeWDL(pos, 0, wdl, ws.ent))
                 throw ChessError("RTB probe failed, pos:" + TextIO::toFEN(pos));
             bool diff;
             int slack = 0;
@@ -722,25 +933,36 @@ PosGenerator::dtzTest(const std::vector<std::string>& tbTypes) {
                 if (diff) {
                     if (std::abs(dtm) < SearchConst::MATE0 - 100) {
                         diff = false;
-                        nDiff50++;
+                        ws.nDiff50++;
                     }
                 }
             }
-            minSlack = std::min(minSlack, slack);
-            maxSlack = std::max(maxSlack, slack);
-            minSlack2 = std::min(minSlack2, slack2);
-            maxSlack2 = std::max(maxSlack2, slack2);
+            ws.minSlack = std::min(ws.minSlack, slack);
+            ws.maxSlack = std::max(ws.maxSlack, slack);
+            ws.minSlack2 = std::min(ws.minSlack2, slack2);
+            ws.maxSlack2 = std::max(ws.maxSlack2, slack2);
             if (diff) {
-                nDiff++;
+                ws.nDiff++;
+                std::lock_guard<std::mutex> L(mutex);
                 std::cout << tbType << " dtz:" << dtz << " dtm:" << dtm
                           << " pos:" << TextIO::toFEN(pos) << std::endl;
             }
         });
+        WorkerStat sum;
+        for (const WorkerStat& ws : stat) {
+            sum.nPos += ws.nPos;
+            sum.nDiff += ws.nDiff;
+            sum.nDiff50 += ws.nDiff50;
+            sum.minSlack = std::min(sum.minSlack, ws.minSlack);
+            sum.maxSlack = std::max(sum.maxSlack, ws.maxSlack);
+            sum.minSlack2 = std::min(sum.minSlack2, ws.minSlack2);
+            sum.maxSlack2 = std::max(sum.maxSlack2, ws.maxSlack2);
+        }
         double t1 = currentTime();
-        std::cout << tbType << " nPos:" << nPos << " nDiff:" << nDiff << " nDiff50:" << nDiff50
-                  << " t:" << (t1-t0) << std::endl;
-        std::cout << tbType << " minSlack:" << minSlack << " maxSlack:" << maxSlack
-                  << " minSlack2:" << minSlack2 << " maxSlack2:" << maxSlack2 << std::endl;
+        std::cout << tbType << " nDiff:" << sum.nDiff << " nDiff50:" << sum.nDiff50;
+        printSpeed(sum.nPos, t1 - t0);
+        std::cout << tbType << " minSlack:" << sum.minSlack << " maxSlack:" << sum.maxSlack
+                  << " minSlack2:" << sum.minSlack2 << " maxSlack2:" << sum.maxSlack2 << std::endl;
     }
 }
 
@@ -41,26 +41,30 @@ public:
     /** Print all tablebase types containing a given number of pieces. */
     static void tbList(int nPieces);
 
+    // The following commands iterate over all positions in one or more tablebases.
+    // The work is split between nWorkers threads.
+
     /** Generate tablebase DTM statistics. */
-    static void dtmStat(const std::vector<std::string>& tbTypes);
+    static void dtmStat(const std::vector<std::string>& tbTypes, int nWorkers);
 
     /** Generate tablebase DTZ statistics. */
-    static void dtzStat(const std::vector<std::string>& tbTypes);
+    static void dtzStat(const std::vector<std::string>& tbTypes, int nWorkers);
 
     /**
      * Generate WDL statistics for an endgame type, indexed by the positions of the
      * pieces specified in pieceTypes.
      * A pieceType string has the format [wb][kqrbnp]
      */
-    static void egStat(const std::string& tbType, const std::vector<std::string>& pieceTypes);
+    static void egStat(const std::string& tbType, const std::vector<std::string>& pieceTypes,
+                       int nWorkers);
 
     /** Compare RTB probe results to GTB probe results, report any differences. */
-    static void wdlTest(const std::vector<std::string>& tbTypes);
+    static void wdlTest(const std::vector<std::string>& tbTypes, int nWorkers);
 
-    static void wdlDump(const std::vector<std::string>& tbTypes);
+    static void wdlDump(const std::vector<std::string>& tbTypes, int nWorkers);
 
     /** Compare RTB DTZ probe results to GTB DTM probe results, report any unexpected differences. */
-    static void dtzTest(const std::vector<std::string>& tbTypes);
+    static void dtzTest(const std::vector<std::string>& tbTypes, int nWorkers);
 
     /** Compare tbgen probe results to GTB DTM probe results, report any differences. */
     static void tbgenTest(const std::vector<std::string>& tbTypes);
@@ -85,6 +85,10 @@ usage() {
     std::cerr << " -e : Use cross entropy error function\n";
     std::cerr << " -s : Use search score instead of game result\n";
     std::cerr << " -moveorder : Optimize static move ordering\n";
+    std::cerr << " -leafcache n lim : Evaluate cached q-search leaf positions when optimizing.\n";
+    std::cerr << "                    Use full q-search every n iterations or if score changed > lim\n";
+    std::cerr << " -poscache file : Read FEN input from binary cache file. Create it if it does not exist\n";
+    std::cerr << "                  or was created from different FEN input. Not used if input is a pipe\n";
     std::cerr << "cmd is one of:\n";
     std::cerr << "\n";
     std::cerr << " p2f [n [us]] : Convert from PGN to FEN, using each position with probability\n";
@@ -103,8 +107,14 @@ usage() {
 #endif
     std::cerr << " qsearch : Update positions in FEN file to position at end of q-search\n";
     std::cerr << " searchfens time inc : Search all positions in FEN file\n";
+    std::cerr << " bench [depth]       : Search built-in positions, print nodes, speed and\n";
+    std::cerr << "                       search statistics in JSON format\n";
     std::cerr << " fen2bin [-useResult] [-noincheck] [-prlimit lim] outFile\n";
     std::cerr << "                     : Convert FEN+score data to binary format\n";
+    std::cerr << " selfplay [-games n] [-nodes n] [-random plies] [-shards n] [-hash MB]\n";
+    std::cerr << "          [-noincheck] [-prlimit lim] outPrefix\n";
+    std::cerr << "                     : Play self-play games and append positions in binary format\n";
+    std::cerr << "                       to outPrefix0.bin, outPrefix1.bin, ...\n";
     std::cerr << "\n";
     std::cerr << " outliers threshold  : Print positions with unexpected game result\n";
     std::cerr << " evaleffect evalfile : Print eval improvement when parameters are changed\n";
@@ -162,11 +172,18 @@ usage() {
     std::cerr << " countuniq pgnFile : Count number of unique positions as function of depth\n";
     std::cerr << " pgnstat pgnFile [-p] : Print statistics for games in a PGN file\n";
     std::cerr << "           -p : Consider game pairs when computing standard deviation\n";
+    std::cerr << " pgnbench pgnFile : Measure PGN parsing speed\n";
     std::cerr << "\n";
     std::cerr << " gsprt elo0 elo1 [-ab alpha beta] (w d l | n00 n05 n10 n15 n20)\n";
 #if !_MSC_VER
     std::cerr << " match (-n nGames | -gsprt elo0 elo1 [-ab alpha beta])\n";
     std::cerr << "       engine1 tc1 engine2 tc2 script\n";
+    std::cerr << " match (-n nGames | -gsprt elo0 elo1 [-ab alpha beta]) -native\n";
+    std::cerr << "       [-book bookFile] [-hash MB] [-o name value]... engine1 tc1 engine2 tc2\n";
+    std::cerr << "       : Play games between two texel instances in this process\n";
+    std::cerr << "         tc is [moves/]time[+inc] in seconds, or nodes=N\n";
+    std::cerr << "         -o sets a UCI parameter for both engines\n";
+    std::cerr << "         engine1 and engine2 must be equal, only tc can differ\n";
 #endif
     std::cerr << "\n";
     std::cerr << " proofgame [-w a:b] [-d] [-m maxNodes] [-v] [-na] [-nokernel]\n";
@@ -300,6 +317,43 @@ doFilterCmd(int argc, char* argv[], ChessTool& chessTool) {
         usage();
 }
 
+static void
+doSelfPlay(int argc, char* argv[], ChessTool& chessTool) {
+    ChessTool::SelfPlayParams par;
+
+    int arg = 2;
+    while (arg < argc) {
+        std::string a = argv[arg];
+        auto intArg = [&](int& val, int minVal) {
+            if (arg+1 >= argc || !str2Num(argv[arg+1], val) || val < minVal)
+                usage();
+            arg += 2;
+        };
+        if (a == "-games") {
+            intArg(par.nGames, 1);
+        } else if (a == "-nodes") {
+            intArg(par.nodes, 1);
+        } else if (a == "-random") {
+            intArg(par.randomPlies, 0);
+        } else if (a == "-shards") {
+            intArg(par.nShards, 1);
+        } else if (a == "-hash") {
+            intArg(par.hashMB, 1);
+        } else if (a == "-noincheck") {
+            par.noInCheck = true;
+            arg++;
+        } else if (a == "-prlimit") {
+            if (arg+1 >= argc || !str2Num(argv[arg+1], par.prLimit) || par.prLimit < 0.0)
+                usage();
+            arg += 2;
+        } else
+            break;
+    }
+    if (argc - arg != 1)
+        usage();
+    chessTool.selfPlay(argv[arg], par);
+}
+
 static void
 doFen2Bin(int argc, char* argv[], ChessTool& chessTool) {
     bool useResult = false;
@@ -333,7 +387,7 @@ doFen2Bin(int argc, char* argv[], ChessTool& chessTool) {
 }
 
 static void
-doBookCmd(int argc, char* argv[]) {
+doBookCmd(int argc, char* argv[], int nWorkers) {
     if (argc < 4)
         usage();
     std::string bookCmd = argv[2];
@@ -371,7 +425,7 @@ doBookCmd(int argc, char* argv[]) {
         if ((argc > 5) && !str2Num(argv[5], maxPly))
             usage();
         BookBuild::Book book(logFile);
-        book.importPGN(bookFile, pgnFile, maxPly);
+        book.importPGN(bookFile, pgnFile, maxPly, nWorkers);
     } else if (bookCmd == "export") {
         if (argc < 7)
             usage();
@@ -502,6 +556,9 @@ doMatch(int argc, char* argv[], int nWorkers) {
     gsprtParams.useBounds = true;
     gsprtParams.usePentanomial = true;
     bool gsprt = false;
+    bool native = false;
+    std::string bookFile;
+    int hashMB = 16;
 
     int arg = 2;
     while (arg < argc) {
@@ -510,6 +567,22 @@ doMatch(int argc, char* argv[], int nWorkers) {
                 usage();
             fixedGames = true;
             arg += 2;
+        } else if (argv[arg] == "-native"s) {
+            native = true;
+            arg++;
+        } else if (arg+1 < argc && argv[arg] == "-book"s) {
+            bookFile = argv[arg+1];
+            arg += 2;
+        } else if (arg+1 < argc && argv[arg] == "-hash"s) {
+            if (!str2Num(argv[arg+1], hashMB) || hashMB <= 0)
+                usage();
+            arg += 2;
+        } else if (arg+2 < argc && argv[arg] == "-o"s) {
+            std::string name = argv[arg+1];
+            if (!Parameters::instance().getParam(name))
+                throw ChessParseError("No such parameter: " + name);
+            Parameters::instance().set(name, argv[arg+2]);
+            arg += 3;
         } else if (arg+2 < argc && argv[arg] == "-gsprt"s) {
             if (!str2Num(argv[arg+1], gsprtParams.elo0) ||
                 !str2Num(argv[arg+2], gsprtParams.elo1))
@@ -528,7 +601,7 @@ doMatch(int argc, char* argv[], int nWorkers) {
 
     if (fixedGames == gsprt)
         usage();
-    if (argc - arg != 5)
+    if (argc - arg != (native ? 4 : 5))
         usage();
 
     MatchRunner::EngineParams engine1;
@@ -538,9 +611,11 @@ doMatch(int argc, char* argv[], int nWorkers) {
     engine1.timeControl = argv[arg+1];
     engine2.name = argv[arg+2];
     engine2.timeControl = argv[arg+3];
-    std::string script = argv[arg+4];
+    std::string script = native ? "" : argv[arg+4];
 
     MatchRunner mr(nWorkers, engine1, engine2);
+    if (native)
+        mr.setNative(hashMB, bookFile);
     if (fixedGames)
         mr.runFixedNumGames(numGames, script);
     else
@@ -722,6 +797,9 @@ main(int argc, char* argv[]) {
         bool useEntropyErrorFunction = false;
         bool optimizeMoveOrdering = false;
         bool useSearchScore = false;
+        int leafCacheRefresh = 0;
+        int leafCacheStaleLimit = 0;
+        std::string posCacheFile;
         while (true) {
             if ((argc >= 3) && (argv[1] == "-iv"s)) {
                 setInitialValues(argv[2]);
@@ -744,6 +822,16 @@ main(int argc, char* argv[]) {
                 optimizeMoveOrdering = true;
                 argc -= 1;
                 argv += 1;
+            } else if ((argc >= 4) && (argv[1] == "-leafcache"s)) {
+                if (!str2Num(argv[2], leafCacheRefresh) || leafCacheRefresh <= 0 ||
+                    !str2Num(argv[3], leafCacheStaleLimit) || leafCacheStaleLimit < 0)
+                    usage();
+                argc -= 3;
+                argv += 3;
+            } else if ((argc >= 3) && (argv[1] == "-poscache"s)) {
+                posCacheFile = argv[2];
+                argc -= 2;
+                argv += 2;
             } else
                 break;
         }
@@ -753,6 +841,9 @@ main(int argc, char* argv[]) {
         std::string cmd = argv[1];
         ChessTool chessTool(useEntropyErrorFunction, optimizeMoveOrdering, useSearchScore,
                             nWorkers);
+        if (leafCacheRefresh > 0)
+            chessTool.setLeafCache(leafCacheRefresh, leafCacheStaleLimit);
+        chessTool.setPosCacheFile(posCacheFile);
         if (cmd == "p2f") {
             int n = 1;
             if (argc > 4)
@@ -791,8 +882,15 @@ main(int argc, char* argv[]) {
                 !str2Num(argv[3], increment) || (increment < 0))
                 usage();
             chessTool.searchPositions(std::cin, baseTime, increment);
+        } else if (cmd == "bench") {
+            int depth = 10;
+            if ((argc > 3) || ((argc == 3) && (!str2Num(argv[2], depth) || depth < 1)))
+                usage();
+            chessTool.bench(depth);
         } else if (cmd == "fen2bin") {
             doFen2Bin(argc, argv, chessTool);
+        } else if (cmd == "selfplay") {
+            doSelfPlay(argc, argv, chessTool);
         } else if (cmd == "outliers") {
             int threshold;
             if ((argc < 3) || !str2Num(argv[2], threshold))
@@ -883,14 +981,14 @@ main(int argc, char* argv[]) {
             std::vector<std::string> tbTypes;
             for (int i = 2; i < argc; i++)
                 tbTypes.push_back(argv[i]);
-            PosGenerator::dtmStat(tbTypes);
+            PosGenerator::dtmStat(tbTypes, nWorkers);
         } else if (cmd == "dtzstat") {
             if (argc < 3)
                 usage();
             std::vector<std::string> tbTypes;
             for (int i = 2; i < argc; i++)
                 tbTypes.push_back(argv[i]);
-            PosGenerator::dtzStat(tbTypes);
+            PosGenerator::dtzStat(tbTypes, nWorkers);
         } else if (cmd == "egstat") {
             if (argc < 4)
                 usage();
@@ -898,28 +996,28 @@ main(int argc, char* argv[]) {
             std::vector<std::string> pieceTypes;
             for (int i = 3; i < argc; i++)
                 pieceTypes.push_back(argv[i]);
-            PosGenerator::egStat(tbType, pieceTypes);
+            PosGenerator::egStat(tbType, pieceTypes, nWorkers);
         } else if (cmd == "wdltest") {
             if (argc < 3)
                 usage();
             std::vector<std::string> tbTypes;
             for (int i = 2; i < argc; i++)
                 tbTypes.push_back(argv[i]);
-            PosGenerator::wdlTest(tbTypes);
+            PosGenerator::wdlTest(tbTypes, nWorkers);
         } else if (cmd == "wdldump") {
             if (argc < 3)
                 usage();
             std::vector<std::string> tbTypes;
             for (int i = 2; i < argc; i++)
                 tbTypes.push_back(argv[i]);
-            PosGenerator::wdlDump(tbTypes);
+            PosGenerator::wdlDump(tbTypes, nWorkers);
         } else if (cmd == "dtztest") {
             if (argc < 3)
                 usage();
             std::vector<std::string> tbTypes;
             for (int i = 2; i < argc; i++)
                 tbTypes.push_back(argv[i]);
-            PosGenerator::dtzTest(tbTypes);
+            PosGenerator::dtzTest(tbTypes, nWorkers);
         } else if (cmd == "dtz") {
             if (argc < 3)
                 usage();
@@ -1021,7 +1119,7 @@ main(int argc, char* argv[]) {
                 tbTypes.push_back(argv[i]);
             PosGenerator::tbgenTest(tbTypes);
         } else if (cmd == "book") {
-            doBookCmd(argc, argv);
+            doBookCmd(argc, argv, nWorkers);
         } else if (cmd == "creatematchbook") {
             if (argc != 4)
                 usage();
@@ -1050,6 +1148,12 @@ main(int argc, char* argv[]) {
             std::string pgnFile = argv[2];
             MatchBookCreator mbc(nWorkers);
             mbc.pgnStat(pgnFile, pairMode, std::cout);
+        } else if (cmd == "pgnbench") {
+            if (argc != 3)
+                usage();
+            std::string pgnFile = argv[2];
+            MatchBookCreator mbc(nWorkers);
+            mbc.pgnBench(pgnFile, std::cout);
         } else if (cmd == "gsprt") {
             doGsprt(argc, argv);
 #if !_MSC_VER
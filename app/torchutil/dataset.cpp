@@ -41,6 +41,16 @@ FileDataSet::FileDataSet(const std::string& filename)
 
 // ------------------------------------------------------------------------------
 
+MappedDataSet::MappedDataSet(const std::string& filename)
+    : data(nullptr), size(0) {
+    if (!file.open(filename))
+        throw ChessError("Failed to map file: " + filename);
+    data = file.data();
+    size = file.size() / sizeof(Record);
+}
+
+// ------------------------------------------------------------------------------
+
 MemDataSet::MemDataSet() {
 }
 
@@ -52,7 +62,7 @@ const S64 trainDataMaxChunkSize = 128 * 1024 * 1024;
 SplitData::SplitData(FileDataSet& fileDs, int batchSize)
     : fileDs(fileDs), batchSize(batchSize),
       fSize(fileDs.getSize()),
-      nValidate(std::min(fSize / 10, maxValidateData)),
+      nValidate(numValidate(fSize)),
       splitPerm(fSize, 0) {
 
     S64 nTrain = fSize - nValidate;
@@ -67,6 +77,11 @@ SplitData::SplitData(FileDataSet& fileDs, int batchSize)
     trainDataChunkSize = (trainDataChunkSize + batchSize - 1) / batchSize * batchSize;
 }
 
+S64
+SplitData::numValidate(S64 fSize) {
+    return std::min(fSize / 10, maxValidateData);
+}
+
 void
 SplitData::getData(U64 seed,
                    int part1, MemDataSet* trainData1,
@@ -104,3 +119,51 @@ SplitData::getData(U64 seed,
         }
     });
 }
+
+// ------------------------------------------------------------------------------
+
+MappedSplitData::MappedSplitData(MappedDataSet& ds, int batchSize, S64 blockSize)
+    : ds(ds), batchSize(batchSize), blockSize(blockSize),
+      fSize(ds.getSize()),
+      nValidate(SplitData::numValidate(fSize)),
+      splitPerm(fSize, 0) {
+    if (fSize - nValidate <= 0)
+        throw ChessError("No training data");
+}
+
+void
+MappedSplitData::getValidateData(MemDataSet& validateData) {
+    MemDataSet tmp(ds, [this](S64 idx) { return isValidate(idx); }, nValidate);
+    validateData.swap(tmp);
+}
+
+std::unique_ptr<BlockShuffledDataSet<MappedDataSet>>
+MappedSplitData::shuffledData(U64 seed) const {
+    return std::make_unique<BlockShuffledDataSet<MappedDataSet>>(ds, blockSize, seed);
+}
+
+S64
+MappedSplitData::getTrainBatch(const BlockShuffledDataSet<MappedDataSet>& shuffled, S64 pos,
+                               MemDataSet& batch) const {
+    const S64 size = shuffled.getSize();
+    batch.reserve(batchSize);
+    Record r;
+    auto skipValidate = [&]() {
+        for ( ; pos < size; pos++) {
+            if (pos % blockSize == 0) {
+                if (pos == 0)
+                    shuffled.prefetchBlock(pos);
+                shuffled.prefetchBlock(pos + blockSize);
+            }
+            if (!isValidate(shuffled.getBaseIdx(pos)))
+                break;
+        }
+    };
+    skipValidate();
+    while (batch.getSize() < batchSize && pos < size) {
+        shuffled.getItem(pos++, r);
+        batch.addData(r);
+        skipValidate();
+    }
+    return pos;
+}
@@ -28,9 +28,13 @@
 
 #include "nnutil.hpp"
 #include "randperm.hpp"
+#include "mappedFile.hpp"
+#include "random.hpp"
 
 #include <string>
 #include <fstream>
+#include <memory>
+#include <cstring>
 #include <cassert>
 
 using Record = NNUtil::Record;
@@ -57,15 +61,43 @@ private:
 };
 
 
+/** A data set where the data is stored in a memory mapped file.
+ *  Supports O(1) random access. Data is paged in by the operating system
+ *  when it is accessed, so the data set can be larger than the available RAM. */
+class MappedDataSet {
+public:
+    /** Constructor. */
+    explicit MappedDataSet(const std::string& filename);
+    MappedDataSet(const MappedDataSet& other) = delete;
+
+    /** Get number of records in the data set. */
+    S64 getSize() const;
+    /** Get the idx:th record in the data set. */
+    void getItem(S64 idx, Record& r) const;
+
+    /** Call action(Record& r) for all elements in the data set, in file order. */
+    template <typename Consumer> void forEach(Consumer action);
+
+    /** Tell the operating system that records [beg,end) will soon be accessed. */
+    void prefetch(S64 beg, S64 end) const;
+
+private:
+    MappedFile file;
+    const U8* data;
+    S64 size;
+};
+
+
 /** A data set stored in memory. */
 class MemDataSet {
 public:
     /** Constructor. Create an empty data set. */
     MemDataSet();
-    /** Create a data set from all entries in fileDs that satisfy pred(i) == true.
-     *  pred() is called only once for idx=0,1,...,(fileDs.getSize()-1), in that order. */
-    template <typename Pred>
-    MemDataSet(FileDataSet& fileDs, Pred pred, S64 expectedSize = 0);
+    /** Create a data set from all entries in ds that satisfy pred(i) == true.
+     *  pred() is called only once for idx=0,1,...,(ds.getSize()-1), in that order.
+     *  DataSet is FileDataSet or MappedDataSet. */
+    template <typename DataSet, typename Pred>
+    MemDataSet(DataSet& ds, Pred pred, S64 expectedSize = 0);
     MemDataSet(const MemDataSet& other) = delete;
 
     /** Clear all data and reserve space for "expectedSize" new entries. */
@@ -101,6 +133,40 @@ public:
 };
 
 
+/** A randomly shuffled version of the base data set, where the shuffling
+ *  preserves locality. The base data set is divided into blocks of consecutive
+ *  records. The block order is shuffled and the records within each block are
+ *  shuffled. Accessing items in index order therefore only touches one block
+ *  of the base data set at a time. The last block can be smaller than the
+ *  other blocks and is always placed last. */
+template <typename Base>
+class BlockShuffledDataSet {
+public:
+    BlockShuffledDataSet(Base& baseSet, S64 blockSize, U64 seed);
+
+    S64 getSize() const;
+    void getItem(S64 idx, Record& r) const;
+
+    /** Get the index in the base data set corresponding to index idx. */
+    S64 getBaseIdx(S64 idx) const;
+
+    /** Get block size. */
+    S64 getBlockSize() const;
+    /** Prefetch the base data set block containing index idx. */
+    void prefetchBlock(S64 idx) const;
+
+private:
+    Base& baseSet;
+    const S64 size;
+    const S64 blockSize;
+    const S64 nFullBlocks;
+    const RandPerm blockPerm;     // Permutation of full blocks
+    const RandPerm inBlockPerm;   // Permutation within a full block
+    const RandPerm lastBlockPerm; // Permutation within the last, partial, block
+    const U64 rotKey;             // Makes the permutation different for each block
+};
+
+
 /** Splits a data set in a training part and a validation part.
  *  The training part is further split into chunks that fit in memory. */
 class SplitData {
@@ -108,6 +174,9 @@ public:
     /** Constructor. */
     SplitData(FileDataSet& fileDs, int batchSize);
 
+    /** Number of validation records for a data set of size "fSize". */
+    static S64 numValidate(S64 fSize);
+
     /** Get number of training data samples. */
     S64 numTrainData() const;
     /** Get number of training data parts. */
@@ -139,6 +208,51 @@ private:
     const RandPerm splitPerm;
 };
 
+
+/** Splits a memory mapped data set in a training part and a validation part.
+ *  The validation part is the same as for SplitData. The training part is
+ *  not copied to memory. Instead each epoch reads it directly from the file
+ *  in block shuffled order, which avoids reading the whole file once for
+ *  each chunk of training data. */
+class MappedSplitData {
+public:
+    /** Constructor. "blockSize" is the number of consecutive records that
+     *  are shuffled together. */
+    MappedSplitData(MappedDataSet& ds, int batchSize, S64 blockSize = defaultBlockSize);
+
+    /** Get number of training data samples. */
+    S64 numTrainData() const;
+    /** Get batch size. */
+    int getBatchSize() const;
+
+    /** Get the validation data. Requires one pass over the data file. */
+    void getValidateData(MemDataSet& validateData);
+
+    /** Create a block shuffled view of the data set for one training epoch.
+     *  The view also contains the validation data, which is skipped by getTrainBatch(). */
+    std::unique_ptr<BlockShuffledDataSet<MappedDataSet>> shuffledData(U64 seed) const;
+
+    /** Get the next batch of training data from "shuffled", starting at index "pos".
+     *  Return the position to use for the next batch, which is shuffled.getSize()
+     *  when all training data has been returned. The next block is prefetched
+     *  when a block boundary is crossed. */
+    S64 getTrainBatch(const BlockShuffledDataSet<MappedDataSet>& shuffled, S64 pos,
+                      MemDataSet& batch) const;
+
+    static const S64 defaultBlockSize = 1024 * 1024;
+
+private:
+    /** Return true if the idx:th record in the data set is validation data. */
+    bool isValidate(S64 idx) const;
+
+    MappedDataSet& ds;
+    const int batchSize;
+    const S64 blockSize;
+    const S64 fSize;
+    const S64 nValidate;
+    const RandPerm splitPerm;
+};
+
 // ------------------------------------------------------------------------------
 
 inline S64
@@ -159,11 +273,44 @@ FileDataSet::forEach(Consumer action) {
 
 // ------------------------------------------------------------------------------
 
-template <typename Pred>
-MemDataSet::MemDataSet(FileDataSet& fileDs, Pred pred, S64 expectedSize) {
+inline S64
+MappedDataSet::getSize() const {
+    return size;
+}
+
+inline void
+MappedDataSet::getItem(S64 idx, Record& r) const {
+    std::memcpy(&r, data + idx * sizeof(Record), sizeof(Record));
+}
+
+template <typename Consumer>
+inline void
+MappedDataSet::forEach(Consumer action) {
+    const S64 prefetchSize = 1024 * 1024;
+    Record r;
+    for (S64 i = 0; i < size; i++) {
+        if (i % prefetchSize == 0)
+            prefetch(i + prefetchSize, i + 2 * prefetchSize);
+        getItem(i, r);
+        action(r);
+    }
+}
+
+inline void
+MappedDataSet::prefetch(S64 beg, S64 end) const {
+    beg = std::max(beg, (S64)0);
+    end = std::min(end, size);
+    if (beg < end)
+        file.willNeed(beg * sizeof(Record), (end - beg) * sizeof(Record));
+}
+
+// ------------------------------------------------------------------------------
+
+template <typename DataSet, typename Pred>
+MemDataSet::MemDataSet(DataSet& ds, Pred pred, S64 expectedSize) {
     reserve(expectedSize);
     S64 fIdx = 0;
-    fileDs.forEach([&pred,this,&fIdx](Record& r) {
+    ds.forEach([&pred,this,&fIdx](Record& r) {
         if (pred(fIdx++))
             data.push_back(r);
     });
@@ -216,6 +363,58 @@ ShuffledDataSet<Base>::getItem(S64 idx, Record& r) const {
 
 // ------------------------------------------------------------------------------
 
+template <typename Base>
+BlockShuffledDataSet<Base>::BlockShuffledDataSet(Base& baseSet, S64 blockSize, U64 seed)
+    : baseSet(baseSet), size(baseSet.getSize()), blockSize(blockSize),
+      nFullBlocks(size / blockSize),
+      blockPerm(std::max(nFullBlocks, (S64)1), seed),
+      inBlockPerm(blockSize, hashU64(seed + 1)),
+      lastBlockPerm(std::max(size % blockSize, (S64)1), hashU64(seed + 2)),
+      rotKey(hashU64(seed + 3)) {
+}
+
+template <typename Base>
+inline S64
+BlockShuffledDataSet<Base>::getSize() const {
+    return size;
+}
+
+template <typename Base>
+inline void
+BlockShuffledDataSet<Base>::getItem(S64 idx, Record& r) const {
+    baseSet.getItem(getBaseIdx(idx), r);
+}
+
+template <typename Base>
+inline S64
+BlockShuffledDataSet<Base>::getBaseIdx(S64 idx) const {
+    S64 block = idx / blockSize;
+    S64 offs = idx % blockSize;
+    if (block >= nFullBlocks)
+        return block * blockSize + lastBlockPerm.perm(offs);
+    S64 rot = hashU64(block + rotKey) % blockSize;
+    offs = inBlockPerm.perm(offs + rot < blockSize ? offs + rot : offs + rot - blockSize);
+    return blockPerm.perm(block) * blockSize + offs;
+}
+
+template <typename Base>
+inline S64
+BlockShuffledDataSet<Base>::getBlockSize() const {
+    return blockSize;
+}
+
+template <typename Base>
+inline void
+BlockShuffledDataSet<Base>::prefetchBlock(S64 idx) const {
+    if (idx < 0 || idx >= size)
+        return;
+    S64 block = idx / blockSize;
+    S64 baseBlock = block >= nFullBlocks ? block : blockPerm.perm(block);
+    baseSet.prefetch(baseBlock * blockSize, (baseBlock + 1) * blockSize);
+}
+
+// ------------------------------------------------------------------------------
+
 inline S64
 SplitData::numTrainData() const {
     return fSize - nValidate;
@@ -231,4 +430,21 @@ SplitData::getBatchSize() const {
     return batchSize;
 }
 
+// ------------------------------------------------------------------------------
+
+inline S64
+MappedSplitData::numTrainData() const {
+    return fSize - nValidate;
+}
+
+inline int
+MappedSplitData::getBatchSize() const {
+    return batchSize;
+}
+
+inline bool
+MappedSplitData::isValidate(S64 idx) const {
+    return splitPerm.perm(idx) < (U64)nValidate;
+}
+
 #endif /* DATASET_HPP_ */
@@ -27,6 +27,7 @@
 #include "random.hpp"
 #include "randperm.hpp"
 #include "timeUtil.hpp"
+#include "threadpool.hpp"
 
 #include <iostream>
 #include <cassert>
@@ -34,19 +35,31 @@
 
 const int maxGrpSize = 4;
 
-FeaturePerm::FeaturePerm(NetData& net)
-    : net(net) {
+FeaturePerm::FeaturePerm(NetData& net, int nWorkers)
+    : net(net), nWorkers(nWorkers) {
 }
 
 void
 FeaturePerm::permute(const std::vector<BitSet>& featureActivations, int nPos,
                      bool useLocalSearch, U64 rndSeed) {
     std::vector<int> permutation;
+    computePermutation(featureActivations, nPos, useLocalSearch, rndSeed, permutation);
+    permuteNet(permutation);
+}
+
+double
+FeaturePerm::computePermutation(const std::vector<BitSet>& featureActivations, int nPos,
+                                bool useLocalSearch, U64 rndSeed,
+                                std::vector<int>& permutation) {
     std::vector<int> groupCount;
     computeGreedyPerm(featureActivations, nPos, permutation, groupCount);
     if (useLocalSearch)
         localOptimize(featureActivations, nPos, rndSeed, permutation, groupCount);
-    permuteNet(permutation);
+
+    S64 totCnt = 0;
+    for (int cnt : groupCount)
+        totCnt += cnt;
+    return (double)totCnt / (2*nPos) / groupCount.size();
 }
 
 void
@@ -57,10 +70,11 @@ FeaturePerm::computeGreedyPerm(const std::vector<BitSet>& featureActivations,
     for (int f = 0; f < NetData::n1; f++)
         remainingF.push_back(f);
 
-    std::vector<BitSet> tmpSets(2);
+    std::vector<BitSet> tmpSets(1);
     BitSet& currAct = tmpSets[0];
-    BitSet& tmpSet = tmpSets[1];
     int grpSize = 0;
+    ThreadPool<int> pool(nWorkers);
+    std::vector<int> totCnts(remainingF.size());
 
     std::cout << "Computing greedy permutation..." << std::endl;
     permutation.clear();
@@ -75,13 +89,24 @@ FeaturePerm::computeGreedyPerm(const std::vector<BitSet>& featureActivations,
             std::cout << "---" << std::endl;
         }
 
+        // Compute the union size for all candidate features in parallel
+        const int nRemain = remainingF.size();
+        const int chunkSize = std::max(1, nRemain / (nWorkers * 4));
+        for (int c = 0; c < nRemain; c += chunkSize) {
+            int beginIdx = c;
+            int endIdx = std::min(c + chunkSize, nRemain);
+            pool.addTask([&,beginIdx,endIdx](int workerNo) {
+                for (int i = beginIdx; i < endIdx; i++)
+                    totCnts[i] = currAct.orBitCount(featureActivations[remainingF[i]], 2*nPos);
+                return 0;
+            });
+        }
+        pool.getAllResults([](int){});
+
         int bestI = -1;
         int bestCnt = 0;
-        for (int i = 0; i < (int)remainingF.size(); i++) {
-            int f = remainingF[i];
-            tmpSet = currAct;
-            tmpSet |= featureActivations[f];
-            int totCnt = tmpSet.bitCount();
+        for (int i = 0; i < nRemain; i++) {
+            int totCnt = totCnts[i];
             if (bestI == -1 || totCnt < bestCnt) {
                 bestI = i;
                 bestCnt = totCnt;
@@ -134,12 +159,19 @@ FeaturePerm::localOptimize(const std::vector<BitSet>& featureActivations,
         totCnt += groupCount[g];
     const double initProb = activationProb(totCnt);
 
-    auto getGroupCount = [&featureActivations,&permutation](int g) -> int {
-        int f0 = g * maxGrpSize;
-        BitSet bs(featureActivations[permutation[f0]]);
-        for (int i = 1; i < maxGrpSize; i++)
-            bs |= featureActivations[permutation[f0+i]];
-        return bs.bitCount();
+    // Number of positions where group g is non-zero, if the features at
+    // permutation indices f1 and f2 were swapped
+    auto getGroupCount = [&featureActivations,&permutation,nPos](int g, int f1, int f2) -> int {
+        const BitSet* sets[maxGrpSize];
+        for (int i = 0; i < maxGrpSize; i++) {
+            int f = g * maxGrpSize + i;
+            if (f == f1)
+                f = f2;
+            else if (f == f2)
+                f = f1;
+            sets[i] = &featureActivations[permutation[f]];
+        }
+        return BitSet::unionBitCount(sets, maxGrpSize, 2*nPos);
     };
 
     if (rndSeed == 0) {
@@ -155,54 +187,77 @@ FeaturePerm::localOptimize(const std::vector<BitSet>& featureActivations,
         return activeVec[f1*nFeats+f2];
     };
 
+    // Candidate swaps are evaluated in parallel in batches. The batch is then
+    // processed in order, accepting the first improving swap, so the result is
+    // the same as when trying one swap at a time.
+    struct Candidate {
+        int f1, f2;
+        int g1Cnt, g2Cnt;
+    };
+    const int batchSize = nWorkers * 8;
+    std::vector<Candidate> batch;
+    ThreadPool<int> pool(nWorkers);
+
     int iter = 0;
     bool improved;
     do {
         improved = false;
         const int N2 = nFeats * nFeats;
         RandPerm rp(N2, rnd.nextU64());
-        for (int i = 0; i < N2; i++) {
-            int p = rp.perm(i);
-            int f1 = p / nFeats;
-            int f2 = p % nFeats;
-            if (f1 / maxGrpSize == f2 / maxGrpSize)
-                continue; // Same group
-            if (!active(f1,f2))
-                continue;
-            active(f1,f2) = false;
-            iter++;
-
-            int g1 = f1 / maxGrpSize;
-            int g2 = f2 / maxGrpSize;
-
-            int oldG1Cnt = groupCount[g1];
-            int oldG2Cnt = groupCount[g2];
-
-            std::swap(permutation[f1], permutation[f2]);
-
-            int g1Cnt = getGroupCount(g1);
-            int g2Cnt = getGroupCount(g2);
-
-            int delta = g1Cnt + g2Cnt - (oldG1Cnt + oldG2Cnt);
-            if (delta < 0) {
-                groupCount[g1] = g1Cnt;
-                groupCount[g2] = g2Cnt;
-                totCnt += delta;
-                double actProb = activationProb(totCnt);
-                std::cout << "i: " << iter << " f1: " << f1 << " f2: " << f2 << " delta: " << delta
-                          << " prob: " << actProb << " (" << (actProb/initProb) << ")"
-                          << std::endl;
-                improved = true;
-                auto activateGroup = [&active,nFeats](int g) {
-                    for (int f1 = g*maxGrpSize; f1 < (g+1)*maxGrpSize; f1++)
-                        for (int f2 = 0; f2 < nFeats; f2++)
-                            active(f1,f2) = true;
-                };
-                activateGroup(g1);
-                activateGroup(g2);
-                break;
-            } else {
-                std::swap(permutation[f1], permutation[f2]);
+        int i = 0;
+        while (i < N2 && !improved) {
+            batch.clear();
+            for ( ; i < N2 && (int)batch.size() < batchSize; i++) {
+                int p = rp.perm(i);
+                int f1 = p / nFeats;
+                int f2 = p % nFeats;
+                if (f1 / maxGrpSize == f2 / maxGrpSize)
+                    continue; // Same group
+                if (!active(f1,f2))
+                    continue;
+                batch.push_back(Candidate{f1, f2, 0, 0});
+            }
+
+            for (Candidate& c : batch) {
+                pool.addTask([&getGroupCount,&c](int workerNo) {
+                    c.g1Cnt = getGroupCount(c.f1 / maxGrpSize, c.f1, c.f2);
+                    c.g2Cnt = getGroupCount(c.f2 / maxGrpSize, c.f1, c.f2);
+                    return 0;
+                });
+            }
+            pool.getAllResults([](int){});
+
+            for (const Candidate& c : batch) {
+                const int f1 = c.f1;
+                const int f2 = c.f2;
+                if (!active(f1,f2))
+                    continue; // Same pair as an earlier candidate in the batch
+                active(f1,f2) = false;
+                iter++;
+
+                int g1 = f1 / maxGrpSize;
+                int g2 = f2 / maxGrpSize;
+
+                int delta = c.g1Cnt + c.g2Cnt - (groupCount[g1] + groupCount[g2]);
+                if (delta < 0) {
+                    std::swap(permutation[f1], permutation[f2]);
+                    groupCount[g1] = c.g1Cnt;
+                    groupCount[g2] = c.g2Cnt;
+                    totCnt += delta;
+                    double actProb = activationProb(totCnt);
+                    std::cout << "i: " << iter << " f1: " << f1 << " f2: " << f2 << " delta: " << delta
+                              << " prob: " << actProb << " (" << (actProb/initProb) << ")"
+                              << std::endl;
+                    improved = true;
+                    auto activateGroup = [&active,nFeats](int g) {
+                        for (int f1 = g*maxGrpSize; f1 < (g+1)*maxGrpSize; f1++)
+                            for (int f2 = 0; f2 < nFeats; f2++)
+                                active(f1,f2) = true;
+                    };
+                    activateGroup(g1);
+                    activateGroup(g2);
+                    break;
+                }
             }
         }
     } while (improved);
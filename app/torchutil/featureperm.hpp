@@ -37,7 +37,7 @@
 class FeaturePerm {
 public:
     /** Constructor. */
-    FeaturePerm(NetData& net);
+    FeaturePerm(NetData& net, int nWorkers);
 
     constexpr static int maxN = 1024 * 1024 * 8;
     using BitSet = ::BitSet<maxN>;
@@ -47,6 +47,13 @@ public:
     void permute(const std::vector<BitSet>& featureActivations, int nPos,
                  bool useLocalSearch, U64 rndSeed);
 
+    /** Compute a feature permutation that minimizes the number of non-zero
+     *  groups, without modifying the network. Return the average probability
+     *  that a group is non-zero after permuting. */
+    double computePermutation(const std::vector<BitSet>& featureActivations, int nPos,
+                              bool useLocalSearch, U64 rndSeed,
+                              std::vector<int>& permutation);
+
 private:
     /** Compute initial feature permutation using a greedy algorithm. */
     void computeGreedyPerm(const std::vector<BitSet>& featureActivations,
@@ -63,6 +70,7 @@ private:
     void permuteNet(std::vector<int>& permutation);
 
     NetData& net;
+    const int nWorkers;
 };
 
 #endif /* FEATUREPERM_HPP_ */
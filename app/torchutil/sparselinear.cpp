@@ -0,0 +1,107 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * sparselinear.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "sparselinear.hpp"
+#include "util.hpp"
+
+
+void
+SparseLinear::forward(const int* idx, int nIdx, int begB, int endB,
+                      const float* w, int nOut, float* out) {
+    for (int b = begB; b < endB; b++) {
+        float* __restrict o = &out[(S64)b * nOut];
+        for (int j = 0; j < nOut; j++)
+            o[j] = 0;
+        const int* bIdx = &idx[(S64)b * nIdx];
+        for (int i = 0; i < nIdx; i++) {
+            int f = bIdx[i];
+            if (f < 0)
+                break;
+            const float* __restrict row = &w[(S64)f * nOut];
+            for (int j = 0; j < nOut; j++) // Vectorized by the compiler
+                o[j] += row[j];
+        }
+    }
+}
+
+void
+SparseLinear::backward(const int* idx, int nIdx, int batchSize,
+                       const float* gradOut, int nOut, int begJ, int endJ,
+                       float* gradW) {
+    const int n = endJ - begJ;
+    for (int b = 0; b < batchSize; b++) {
+        const float* __restrict g = &gradOut[(S64)b * nOut + begJ];
+        const int* bIdx = &idx[(S64)b * nIdx];
+        for (int i = 0; i < nIdx; i++) {
+            int f = bIdx[i];
+            if (f < 0)
+                break;
+            float* __restrict row = &gradW[(S64)f * nOut + begJ];
+            for (int j = 0; j < n; j++) // Vectorized by the compiler
+                row[j] += g[j];
+        }
+    }
+}
+
+torch::Tensor
+SparseLinearFunction::forward(torch::autograd::AutogradContext* ctx,
+                              torch::Tensor idx, torch::Tensor w) {
+    idx = idx.contiguous();
+    w = w.contiguous();
+    ctx->save_for_backward({idx});
+    ctx->saved_data["nIn"] = w.size(0);
+
+    const int batchSize = idx.size(0);
+    const int nIdx = idx.size(1);
+    const int nOut = w.size(1);
+    torch::Tensor out = torch::empty({batchSize, nOut}, w.options());
+    const int* idxP = idx.data_ptr<int>();
+    const float* wP = w.data_ptr<float>();
+    float* outP = out.data_ptr<float>();
+    at::parallel_for(0, batchSize, 256, [&](S64 beg, S64 end) {
+        SparseLinear::forward(idxP, nIdx, beg, end, wP, nOut, outP);
+    });
+    return out;
+}
+
+torch::autograd::tensor_list
+SparseLinearFunction::backward(torch::autograd::AutogradContext* ctx,
+                               torch::autograd::tensor_list gradOutputs) {
+    torch::Tensor idx = ctx->get_saved_variables()[0];
+    torch::Tensor gradOut = gradOutputs[0].contiguous();
+    const S64 nIn = ctx->saved_data["nIn"].toInt();
+
+    const int batchSize = idx.size(0);
+    const int nIdx = idx.size(1);
+    const int nOut = gradOut.size(1);
+    torch::Tensor gradW = torch::zeros({nIn, nOut}, gradOut.options());
+    const int* idxP = idx.data_ptr<int>();
+    const float* gP = gradOut.data_ptr<float>();
+    float* gradWP = gradW.data_ptr<float>();
+    at::parallel_for(0, nOut, 16, [&](S64 beg, S64 end) {
+        SparseLinear::backward(idxP, nIdx, batchSize, gP, nOut, beg, end, gradWP);
+    });
+    return { torch::Tensor(), gradW };
+}
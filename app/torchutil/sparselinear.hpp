@@ -0,0 +1,66 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * sparselinear.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef SPARSELINEAR_HPP_
+#define SPARSELINEAR_HPP_
+
+#include <torch/torch.h>
+
+/** CPU kernels for a linear layer with sparse binary input, without bias.
+ *  The input for position b is given as a list of active feature indices,
+ *  idx[b*nIdx + i], i = 0, ..., nIdx-1. The list is terminated by the first
+ *  negative index, or after nIdx entries. A feature can occur more than once
+ *  in the list, in which case it contributes once for each occurrence.
+ *  The weight matrix w has shape (nIn, nOut), i.e. it is the transpose of the
+ *  torch::nn::Linear weight matrix, so that each feature corresponds to a
+ *  contiguous row. */
+class SparseLinear {
+public:
+    /** Compute out[b][j] = sum(w[f][j]) for all active features f in
+     *  position b, for begB <= b < endB. */
+    static void forward(const int* idx, int nIdx, int begB, int endB,
+                        const float* w, int nOut, float* out);
+
+    /** Compute gradW[f][j] += sum(gradOut[b][j]) for all positions b where
+     *  feature f is active, for begJ <= j < endJ. Different threads can
+     *  process disjoint column ranges concurrently. */
+    static void backward(const int* idx, int nIdx, int batchSize,
+                         const float* gradOut, int nOut, int begJ, int endJ,
+                         float* gradW);
+};
+
+/** Autograd function computing x*W for sparse binary x, given as an int32
+ *  index tensor of shape (batchSize, maxActive) padded with negative values,
+ *  and W of shape (nIn, nOut). Runs on the CPU using the SparseLinear kernels. */
+class SparseLinearFunction : public torch::autograd::Function<SparseLinearFunction> {
+public:
+    static torch::Tensor forward(torch::autograd::AutogradContext* ctx,
+                                 torch::Tensor idx, torch::Tensor w);
+
+    static torch::autograd::tensor_list backward(torch::autograd::AutogradContext* ctx,
+                                                 torch::autograd::tensor_list gradOutputs);
+};
+
+#endif /* SPARSELINEAR_HPP_ */
@@ -32,6 +32,7 @@
 #include "square.hpp"
 #include "threadpool.hpp"
 #include "featureperm.hpp"
+#include "sparselinear.hpp"
 #include "dataset.hpp"
 
 #include <torch/torch.h>
@@ -59,6 +60,7 @@ const int inFeats1 = nKIdx * 10 * 64;
 const int inFeats2 =         10 * 64;
 const int inFeats3 =         10;
 const int inFeatures = inFeats1 + inFeats2 + inFeats3;
+const int maxActive = 30 * 3; // Max number of active features for one side
 using Record = NNUtil::Record;
 
 /** Compute feature indices for a king+piece combination.
@@ -110,9 +112,21 @@ toSparse(const Record& r, std::vector<int>& idxVecW, std::vector<int>& idxVecB)
     }
 }
 
+/** Store the active features in idxVec in row b of the index tensor acc.
+ *  Unused entries are set to -1. */
+static void
+toIndexRow(const std::vector<int>& idxVec, int b, at::TensorAccessor<int,2>& acc) {
+    const int nnz = idxVec.size();
+    for (int i = 0; i < nnz; i++)
+        acc[b][i] = idxVec[i];
+    for (int i = nnz; i < maxActive; i++)
+        acc[b][i] = -1;
+}
+
 /** Get a batch of training data from ds[beg:end].
- * @param inW, inB: Shape (batchSize, inFeatures). The sparse binary inputs for
- *                  white/black corresponding to the training positions.
+ * @param inW, inB: Shape (batchSize, maxActive). The indices of the active
+ *                  input features for white/black corresponding to the
+ *                  training positions, padded with -1.
  * @param headIdx   headIdx[i] = i * nHeads + hi[i], where hi[i] is the head
  *                  to use for position i.
  * @param out:      Shape (batchSize, 1). The corresponding desired outputs
@@ -124,32 +138,40 @@ getData(DataSet& ds, size_t beg, size_t end,
         torch::Tensor& out) {
     int batchSize = end - beg;
     Record r;
-    std::vector<int> idxVec1W; idxVec1W.reserve(batchSize * 30);
-    std::vector<int> idxVec1B; idxVec1B.reserve(batchSize * 30);
-    std::vector<int> idxVec2;  idxVec2.reserve(batchSize * 30);
+    std::vector<int> idxVecW; idxVecW.reserve(maxActive);
+    std::vector<int> idxVecB; idxVecB.reserve(maxActive);
+    inW = torch::empty({batchSize, maxActive}, torch::kI32);
+    inB = torch::empty({batchSize, maxActive}, torch::kI32);
+    auto inWAcc = inW.accessor<int,2>();
+    auto inBAcc = inB.accessor<int,2>();
     headIdx = torch::empty({batchSize}, torch::kI64);
     auto headIdxAcc = headIdx.accessor<S64,1>();
     out = torch::empty({batchSize, 1}, torch::kF32);
+    auto outAcc = out.accessor<float,2>();
     for (int b = 0; b < batchSize; b++) {
         ds.getItem(beg + b, r);
-        toSparse(r, idxVec1W, idxVec1B);
-        idxVec2.resize(idxVec1W.size(), b);
-        out[b][0] = r.searchScore * 1e-2;
+        idxVecW.clear();
+        idxVecB.clear();
+        toSparse(r, idxVecW, idxVecB);
+        toIndexRow(idxVecW, b, inWAcc);
+        toIndexRow(idxVecB, b, inBAcc);
+        outAcc[b][0] = r.searchScore * 1e-2;
         int hi = NetData::getHeadNo(NNUtil::nPieces(r));
         headIdxAcc[b] = b * NetData::nHeads + hi;
     }
-    int nnz = idxVec1W.size();
-
-    for (int c = 0; c < 2; c++) {
-        torch::Tensor indices = torch::empty({2, nnz}, torch::kI64);
-        auto acc = indices.accessor<S64,2>();
-        for (int i = 0; i < nnz; i++) {
-            acc[0][i] = idxVec2[i];
-            acc[1][i] = c == 0 ? idxVec1W[i] : idxVec1B[i];
-        }
-        torch::Tensor values = torch::ones({nnz}, torch::kF32);
-        (c == 0 ? inW : inB) = sparse_coo_tensor(indices, values, {batchSize, inFeatures});
-    }
+}
+
+/** Convert an index tensor, as returned by getData(), to a sparse COO tensor
+ *  of shape (batchSize, inFeatures). */
+static torch::Tensor
+toSparseCOO(torch::Tensor idx) {
+    const S64 batchSize = idx.size(0);
+    torch::Tensor mask = idx.ge(0);
+    torch::Tensor rows = torch::arange(batchSize, idx.options().dtype(torch::kI64))
+                             .unsqueeze(1).expand_as(idx).masked_select(mask);
+    torch::Tensor cols = idx.masked_select(mask).to(torch::kI64);
+    torch::Tensor values = torch::ones({rows.size(0)}, idx.options().dtype(torch::kF32));
+    return sparse_coo_tensor(torch::stack({rows, cols}), values, {batchSize, inFeatures});
 }
 
 /** Loads training data from file into tensors.
@@ -282,6 +304,88 @@ DataLoader::startGetData() {
 
 // ------------------------------------------------------------------------------
 
+/** Loads training data from a memory mapped file into tensors.
+ *  Each epoch reads the training data directly from the file in block
+ *  shuffled order. A helper thread converts the next batch to tensors while
+ *  the previous batch is being processed. */
+class MappedDataLoader {
+public:
+    /** Constructor. */
+    MappedDataLoader(MappedSplitData& splitData, int numEpochs, U64 seed);
+
+    /** Get tensor data for the next batch of training data.
+     *  @return True if returned data is the last data for the current epoch. */
+    bool getData(torch::Tensor& inW, torch::Tensor& inB, torch::Tensor& headIdx,
+                 torch::Tensor& out);
+
+private:
+    void startGetData();
+
+    MappedSplitData& splitData;
+    const int numEpochs;
+    const U64 seed;
+
+    int epoch = 0;             // Epoch corresponding to shuffledData
+    S64 pos = 0;               // Position in shuffledData of next batch
+    std::unique_ptr<BlockShuffledDataSet<MappedDataSet>> shuffledData;
+    MemDataSet batch;
+
+    struct TensorResult {
+        torch::Tensor inW;
+        torch::Tensor inB;
+        torch::Tensor headIdx;
+        torch::Tensor out;
+        bool lastInEpoch;
+    };
+    ThreadPool<TensorResult> tensorWorker; // Converts the next batch to tensors
+};
+
+inline
+MappedDataLoader::MappedDataLoader(MappedSplitData& splitData, int numEpochs, U64 seed)
+    : splitData(splitData), numEpochs(numEpochs), seed(seed), tensorWorker(1) {
+    startGetData();
+}
+
+bool
+MappedDataLoader::getData(torch::Tensor& inW, torch::Tensor& inB, torch::Tensor& headIdx,
+                          torch::Tensor& out) {
+    TensorResult r;
+    if (!tensorWorker.getResult(r))
+        throw ChessError("startGetData() not called");
+    inW = r.inW;
+    inB = r.inB;
+    headIdx = r.headIdx;
+    out = r.out;
+
+    startGetData();
+    return r.lastInEpoch;
+}
+
+void
+MappedDataLoader::startGetData() {
+    if (epoch >= numEpochs)
+        return; // No more data to get
+
+    auto getNextData = [this](int workerNo) -> TensorResult {
+        if (!shuffledData)
+            shuffledData = splitData.shuffledData(hashU64(hashU64(seed) + epoch));
+        pos = splitData.getTrainBatch(*shuffledData, pos, batch);
+
+        TensorResult r;
+        ::getData(batch, 0, batch.getSize(), r.inW, r.inB, r.headIdx, r.out);
+        r.lastInEpoch = pos >= shuffledData->getSize();
+        if (r.lastInEpoch) {
+            epoch++;
+            pos = 0;
+            shuffledData.reset();
+        }
+        return r;
+    };
+    tensorWorker.addTask(getNextData);
+}
+
+// ------------------------------------------------------------------------------
+
 /** Write the first "nPos" positions from "ds" to "outFile". */
 template <typename DataSet>
 static void
@@ -312,14 +416,79 @@ extractSubset(const std::string& inFile, S64 nPos, const std::string& outFile) {
 
 // ------------------------------------------------------------------------------
 
+/** First network layer. Works like torch::nn::Linear, except that the weight
+ *  matrix has shape (nIn, nOut), which is the layout SparseLinearFunction
+ *  uses. This avoids transposing the weight matrix in each training step.
+ *  In model files the weight is stored in the torch::nn::Linear layout, so
+ *  files stay compatible with program versions that used torch::nn::Linear. */
+class SparseInputLinear : public torch::nn::Module {
+public:
+    SparseInputLinear(int nIn, int nOut);
+
+    /** Compute x*weight + bias. x is an index tensor as returned by getData().
+     *  If useCOO is true, or the layer is not on the CPU, x is converted to a
+     *  sparse COO tensor, otherwise SparseLinearFunction is used. */
+    torch::Tensor forward(torch::Tensor x, bool useCOO);
+
+    /** Save/load parameters, using the torch::nn::Linear weight layout. */
+    void save(torch::serialize::OutputArchive& archive) const override;
+    void load(torch::serialize::InputArchive& archive) override;
+
+    torch::Tensor weight; // (nIn, nOut)
+    torch::Tensor bias;   // (nOut)
+};
+
+SparseInputLinear::SparseInputLinear(int nIn, int nOut) {
+    // Same initialization as torch::nn::Linear
+    const double bound = 1.0 / std::sqrt(nIn);
+    weight = register_parameter("weight", torch::empty({nIn, nOut}).uniform_(-bound, bound));
+    bias = register_parameter("bias", torch::empty({nOut}).uniform_(-bound, bound));
+}
+
+torch::Tensor
+SparseInputLinear::forward(torch::Tensor x, bool useCOO) {
+    if (useCOO || !weight.device().is_cpu())
+        return torch::addmm(bias, toSparseCOO(x), weight);
+    return SparseLinearFunction::apply(x, weight) + bias;
+}
+
+void
+SparseInputLinear::save(torch::serialize::OutputArchive& archive) const {
+    c10::NoGradGuard guard;
+    archive.write("weight", weight.t().contiguous());
+    archive.write("bias", bias);
+}
+
+void
+SparseInputLinear::load(torch::serialize::InputArchive& archive) {
+    torch::Tensor w, b;
+    archive.read("weight", w);
+    archive.read("bias", b);
+    if (w.dim() != 2 || w.size(0) != weight.size(1) || w.size(1) != weight.size(0) ||
+        b.dim() != 1 || b.size(0) != bias.size(0))
+        throw ChessError("Incompatible first layer size in model file");
+    c10::NoGradGuard guard;
+    weight.set_data(w.t().contiguous());
+    bias.set_data(b);
+}
+
+// ------------------------------------------------------------------------------
+
 /** A PyTorch net that will be used as evaluation function after quantization. */
 class Net : public torch::nn::Module {
 public:
     Net();
 
+    /** Compute network output. xW and xB are index tensors as returned by
+     *  getData(). */
     torch::Tensor forward(torch::Tensor xW, torch::Tensor xB,
                           torch::Tensor headIdx);
 
+    /** If true, compute the first layer using sparse COO tensors instead of
+     *  SparseLinearFunction. The COO path is always used when the net is not
+     *  on the CPU. */
+    void setUseCOO(bool coo);
+
     /** Clamp weights to remain within a range that is compatible
      *  with later quantization. */
     void clamp(bool useQAT);
@@ -338,23 +507,31 @@ private:
                                torch::Tensor headIdx) const;
 
     static constexpr int nHeads = NetData::nHeads;
-    torch::nn::Linear lin1 = nullptr; const int n1 = 384;
+    std::shared_ptr<SparseInputLinear> lin1; const int n1 = 384;
     torch::nn::Linear lin2 = nullptr; const int n2 = 32;
     torch::nn::Linear lin3 = nullptr; const int n3 = 32;
     torch::nn::Linear lin4 = nullptr;
+    bool useCOO = false;
 };
 
 Net::Net() {
-    lin1 = register_module("lin1", torch::nn::Linear(inFeatures, n1));
+    lin1 = register_module("lin1", std::make_shared<SparseInputLinear>(inFeatures, n1));
     lin2 = register_module("lin2", torch::nn::Linear(n1*2, n2*nHeads));
     lin3 = register_module("lin3", torch::nn::Linear(n2, n3*nHeads));
     lin4 = register_module("lin4", torch::nn::Linear(n3, 1*nHeads));
 }
 
+void
+Net::setUseCOO(bool coo) {
+    useCOO = coo;
+}
+
 torch::Tensor
 Net::forward(torch::Tensor xW, torch::Tensor xB, torch::Tensor idx) {
-    xW = torch::clamp(lin1->forward(xW), 0.0f, 1.0f);
-    xB = torch::clamp(lin1->forward(xB), 0.0f, 1.0f);
+    xW = lin1->forward(xW, useCOO);
+    xB = lin1->forward(xB, useCOO);
+    xW = torch::clamp(xW, 0.0f, 1.0f);
+    xB = torch::clamp(xB, 0.0f, 1.0f);
     torch::Tensor x = torch::hstack({xW, xB});
 
     x = torch::clamp(fwdAndSelect(lin2, x, idx), 0.0f, 1.0f);
@@ -446,7 +623,8 @@ Net::printWeights(int epoch) const {
         printTensor(getName(name + "b", epoch), lin->bias);
     };
 
-    printLin(lin1, "lin1");
+    printTensor(getName("lin1w", epoch), lin1->weight.t());
+    printTensor(getName("lin1b", epoch), lin1->bias);
     printLin(lin2, "lin2");
     printLin(lin3, "lin3");
     printLin(lin4, "lin4");
@@ -484,7 +662,7 @@ scaleCopy(const std::vector<float>& in, T* out, int scaleFactor, int offs) {
 void
 Net::quantize(NetData& qNet) const {
     // Apply factorized weights to non-factorized weights
-    torch::Tensor lin1W = lin1->weight.t().clone();
+    torch::Tensor lin1W = lin1->weight.clone();
     torch::Tensor lin1B = lin1->bias;
     {
         auto sameSquare = [](int kIdx, int sq) -> bool {
@@ -560,9 +738,12 @@ toProb(T score) {
     return 1 / (1 + exp(score * k));
 }
 
-/** Compute RMS loss for a quantized network over a data set. */
+/** Compute RMS loss for a quantized network over a data set. Consecutive
+ *  positions in a task are evaluated using the same Position and NNEvaluator
+ *  objects, so the first layer can be updated incrementally when possible. */
 static double
 getQLoss(MemDataSet& ds, const NetData& qNet, int nWorkers) {
+    const double t0 = currentTime();
     struct ThreadData {
         std::shared_ptr<NNEvaluator> qEval;
         Record r;
@@ -603,16 +784,26 @@ getQLoss(MemDataSet& ds, const NetData& qNet, int nWorkers) {
         qLoss += batchLoss;
     });
     qLoss = sqrt(qLoss / nPos);
+    const double t = currentTime() - t0;
+    std::cout << "Quantized loss: " << nPos << " positions, "
+              << (S64)(nPos / std::max(t, 1e-6)) << " pos/s" << std::endl;
     return qLoss;
 }
 
 /** Train a network using training data from "inFile". After each training epoch,
- *  the current net is saved in PyTorch format in the file modelNN.pt. */
+ *  the current net is saved in PyTorch format in the file modelNN.pt.
+ *  If useMmap is true, the training data is read from a memory mapped file in
+ *  block shuffled order, instead of being loaded to memory in chunks.
+ *  If useCPU is true, training is performed on the CPU instead of on a CUDA
+ *  device. The first layer then uses SparseLinearFunction, unless useCOO is true. */
 static void
 train(const std::string& inFile, int nEpochs, bool useQAT, double initialLR, U64 seed,
-      const std::string& initialModel, int nWorkers) {
-    const auto dev = torch::kCUDA;
+      const std::string& initialModel, bool useMmap, bool useCPU, bool useCOO,
+      int nWorkers) {
+    const auto dev = useCPU ? torch::kCPU : torch::kCUDA;
     const double t0 = currentTime();
+    if (useCPU)
+        torch::set_num_threads(nWorkers);
 
     auto netP = std::make_shared<Net>();
     Net& net = *netP;
@@ -622,6 +813,7 @@ train(const std::string& inFile, int nEpochs, bool useQAT, double initialLR, U64
         torch::load(netP, initialModel.c_str());
     }
     net.to(dev);
+    net.setUseCOO(useCOO);
 
     size_t nPars = 0;
     for (auto& p : net.parameters())
@@ -630,18 +822,38 @@ train(const std::string& inFile, int nEpochs, bool useQAT, double initialLR, U64
     std::cout << "Number of parameters: " << nPars << std::endl;
 
     const int batchSize = 16*1024;
-    FileDataSet allData(inFile);
-    const size_t nData = allData.getSize();
-    std::cout << "nData    : " << nData << std::endl;
-
-    SplitData splitData(allData, batchSize);
-    const size_t nTrain = splitData.numTrainData();
-    std::cout << "nTrain   : " << nTrain << " (" << (nTrain / batchSize) << " batches)" << std::endl;
-    std::cout << "nParts   : " << splitData.numTrainParts() << std::endl;
-    std::cout << "batchSize: " << batchSize << std::endl;
-
+    std::unique_ptr<FileDataSet> fileData;
+    std::unique_ptr<SplitData> splitData;
+    std::unique_ptr<DataLoader> loader;
+    std::unique_ptr<MappedDataSet> mappedData;
+    std::unique_ptr<MappedSplitData> mappedSplitData;
+    std::unique_ptr<MappedDataLoader> mappedLoader;
     MemDataSet validateData;
-    DataLoader loader(splitData, validateData, nEpochs, seed);
+    if (useMmap) {
+        mappedData = std::make_unique<MappedDataSet>(inFile);
+        std::cout << "nData    : " << mappedData->getSize() << std::endl;
+        mappedSplitData = std::make_unique<MappedSplitData>(*mappedData, batchSize);
+        const size_t nTrain = mappedSplitData->numTrainData();
+        std::cout << "nTrain   : " << nTrain << " (" << (nTrain / batchSize) << " batches)" << std::endl;
+        std::cout << "batchSize: " << batchSize << std::endl;
+        mappedSplitData->getValidateData(validateData);
+        mappedLoader = std::make_unique<MappedDataLoader>(*mappedSplitData, nEpochs, seed);
+    } else {
+        fileData = std::make_unique<FileDataSet>(inFile);
+        std::cout << "nData    : " << fileData->getSize() << std::endl;
+        splitData = std::make_unique<SplitData>(*fileData, batchSize);
+        const size_t nTrain = splitData->numTrainData();
+        std::cout << "nTrain   : " << nTrain << " (" << (nTrain / batchSize) << " batches)" << std::endl;
+        std::cout << "nParts   : " << splitData->numTrainParts() << std::endl;
+        std::cout << "batchSize: " << batchSize << std::endl;
+        loader = std::make_unique<DataLoader>(*splitData, validateData, nEpochs, seed);
+    }
+    auto getTrainData = [&](torch::Tensor& inW, torch::Tensor& inB, torch::Tensor& headIdx,
+                            torch::Tensor& out) -> bool {
+        if (mappedLoader)
+            return mappedLoader->getData(inW, inB, headIdx, out);
+        return loader->getData(inW, inB, headIdx, out);
+    };
     const size_t nValidate = validateData.getSize();
     std::cout << "nValidate: " << nValidate << " (" << (nValidate / batchSize) << " batches)" << std::endl;
 
@@ -651,12 +863,15 @@ train(const std::string& inFile, int nEpochs, bool useQAT, double initialLR, U64
     net.printWeights(0);
     for (int epoch = 1; epoch <= nEpochs; epoch++) {
         std::cout << "Epoch: " << epoch << " lr: " << lr << std::endl;
+        const double epochT0 = currentTime();
 
         torch::Tensor lossSum = torch::zeros({}, torch::kF32).to(dev);
         int lossNum = 0;
+        S64 nSamples = 0;
         for (size_t batch = 0; ; batch++) {
             torch::Tensor inputW, inputB, headIdx, target;
-            bool lastInEpoch = loader.getData(inputW, inputB, headIdx, target);
+            bool lastInEpoch = getTrainData(inputW, inputB, headIdx, target);
+            nSamples += inputW.size(0);
 
             inputW  = inputW.to(dev);
             inputB  = inputB.to(dev);
@@ -685,6 +900,9 @@ train(const std::string& inFile, int nEpochs, bool useQAT, double initialLR, U64
             if (lastInEpoch)
                 break;
         }
+        const double epochTime = currentTime() - epochT0;
+        std::cout << "Epoch time: " << epochTime
+                  << " samples/s: " << (S64)(nSamples / epochTime) << std::endl;
 
         {
             {
@@ -879,7 +1097,7 @@ permuteFeatures(NetData& net, MemDataSet& ds, bool useLocalSearch, U64 rndSeed,
         pool.getAllResults([](int){});
     }
 
-    FeaturePerm fp(net);
+    FeaturePerm fp(net, nWorkers);
     fp.permute(featureActivations, nPos, useLocalSearch, rndSeed);
 }
 
@@ -980,6 +1198,63 @@ extractValidationData(const std::string& inFile, const std::string& outFile) {
     writeDataSet(validateData, validateData.getSize(), outFile);
 }
 
+/** Measure the time needed to read one epoch of training data from "inFile",
+ *  both using SplitData and using MappedSplitData. Both methods read the same
+ *  training data, so the printed checksums must be equal. */
+static void
+dataSetBench(const std::string& inFile) {
+    const int batchSize = 16*1024;
+    const U64 seed = 1;
+    auto printResult = [](const std::string& name, double t, S64 nRec, U64 checkSum) {
+        std::cout << name << " t:" << t << " nRec:" << nRec
+                  << " rec/s:" << (S64)(t > 0 ? nRec / t : 0)
+                  << " checksum:" << num2Hex(checkSum) << std::endl;
+    };
+    auto recHash = [](const Record& r) -> U64 {
+        return hashU64((U64)r.searchScore + ((U64)(U8)r.wKing << 32) + ((U64)(U8)r.bKing << 40));
+    };
+
+    {
+        double t0 = currentTime();
+        FileDataSet allData(inFile);
+        SplitData splitData(allData, batchSize);
+        S64 nRec = 0;
+        U64 checkSum = 0;
+        MemDataSet chunk;
+        Record r;
+        for (int part = 0; part < splitData.numTrainParts(); part++) {
+            splitData.getData(seed, part, &chunk, -1, nullptr, nullptr);
+            ShuffledDataSet<MemDataSet> shuffled(chunk, seed + part);
+            for (S64 i = 0; i < shuffled.getSize(); i++) {
+                shuffled.getItem(i, r);
+                checkSum += recHash(r);
+                nRec++;
+            }
+        }
+        printResult("SplitData", currentTime() - t0, nRec, checkSum);
+    }
+
+    {
+        double t0 = currentTime();
+        MappedDataSet allData(inFile);
+        MappedSplitData splitData(allData, batchSize);
+        auto shuffled = splitData.shuffledData(seed);
+        S64 nRec = 0;
+        U64 checkSum = 0;
+        MemDataSet batch;
+        Record r;
+        for (S64 pos = 0; pos < shuffled->getSize(); ) {
+            pos = splitData.getTrainBatch(*shuffled, pos, batch);
+            for (S64 i = 0; i < batch.getSize(); i++) {
+                batch.getItem(i, r);
+                checkSum += recHash(r);
+                nRec++;
+            }
+        }
+        printResult("Mapped   ", currentTime() - t0, nRec, checkSum);
+    }
+}
+
 /** Convert a data set binary file "inFile" to FEN format written to "os". */
 static void
 bin2Fen(const std::string& inFile, std::ostream& os) {
@@ -997,9 +1272,10 @@ bin2Fen(const std::string& inFile, std::ostream& os) {
 /** Evaluate one or more chess positions using both a floating point network
  *  (read from "modelFile") and a corresponding quantized network.
  *  If "fen" is "-", read a sequence of positions in fen format from standard
- *  input, otherwise evaluate the position given by "fen". */
+ *  input, otherwise evaluate the position given by "fen". Positions are
+ *  evaluated in batches, using nWorkers threads for the quantized network. */
 static void
-eval(const std::string& modelFile, const std::string& fen) {
+eval(const std::string& modelFile, const std::string& fen, int nWorkers) {
     auto netP = std::make_shared<Net>();
     Net& net = *netP;
     torch::load(netP, modelFile.c_str());
@@ -1009,58 +1285,101 @@ eval(const std::string& modelFile, const std::string& fen) {
     NetData& qNet = *qNetP;
     net.quantize(qNet);
     qNet.prepareMatMul();
-    std::shared_ptr<NNEvaluator> qEval = NNEvaluator::create(qNet);
+
+    struct ThreadData {
+        std::shared_ptr<NNEvaluator> qEval;
+        Position pos;
+        ThreadData(const NetData& net) {
+            qEval = NNEvaluator::create(net);
+        }
+    };
+    std::vector<std::unique_ptr<ThreadData>> tdVec(nWorkers);
+    for (int i = 0; i < nWorkers; i++)
+        tdVec[i] = std::make_unique<ThreadData>(qNet);
+    ThreadPool<int> pool(nWorkers);
 
     bool fromStdIn = fen == "-";
     std::istream& is = std::cin;
 
     c10::InferenceMode guard;
-    while (true) {
-        Position pos;
+    const int maxBatchSize = 4096;
+    const double t0 = currentTime();
+    S64 nPos = 0;
+    std::vector<Position> positions;
+    std::vector<int> qVals;
+    bool done = false;
+    while (!done) {
+        positions.clear();
         if (fromStdIn) {
             std::string line;
-            std::getline(is, line);
-            if (!is || is.eof())
-                break;
-            pos = TextIO::readFEN(line);
+            while ((int)positions.size() < maxBatchSize) {
+                std::getline(is, line);
+                if (!is || is.eof()) {
+                    done = true;
+                    break;
+                }
+                positions.push_back(TextIO::readFEN(line));
+            }
         } else {
-            pos = TextIO::readFEN(fen);
+            positions.push_back(TextIO::readFEN(fen));
+            done = true;
         }
+        const int batchSize = positions.size();
+        if (batchSize == 0)
+            break;
 
-        Record r;
-        NNUtil::posToRecord(pos, 0, r);
-
+        torch::Tensor inW = torch::empty({batchSize, maxActive}, torch::kI32);
+        torch::Tensor inB = torch::empty({batchSize, maxActive}, torch::kI32);
+        torch::Tensor headIdx = torch::empty({batchSize}, torch::kI64);
+        auto inWAcc = inW.accessor<int,2>();
+        auto inBAcc = inB.accessor<int,2>();
+        auto headIdxAcc = headIdx.accessor<S64,1>();
         std::vector<int> idxVecW, idxVecB;
-        toSparse(r, idxVecW, idxVecB);
-        const int nnz = idxVecW.size();
-
-        torch::Tensor inW, inB;
-        torch::Tensor headIdx = torch::empty({1}, torch::kI64);
-
-        for (int c = 0; c < 2; c++) {
-            torch::Tensor indices = torch::empty({2, nnz}, torch::kI64);
-            auto acc = indices.accessor<S64,2>();
-            for (int i = 0; i < nnz; i++) {
-                acc[0][i] = 0;
-                acc[1][i] = c == 0 ? idxVecW[i] : idxVecB[i];
-            }
-            torch::Tensor values = torch::ones({nnz}, torch::kF32);
-            (c == 0 ? inW : inB) = sparse_coo_tensor(indices, values, {1, inFeatures});
+        for (int b = 0; b < batchSize; b++) {
+            Record r;
+            NNUtil::posToRecord(positions[b], 0, r);
+            idxVecW.clear();
+            idxVecB.clear();
+            toSparse(r, idxVecW, idxVecB);
+            toIndexRow(idxVecW, b, inWAcc);
+            toIndexRow(idxVecB, b, inBAcc);
+            headIdxAcc[b] = b * NetData::nHeads + NetData::getHeadNo(positions[b].nPieces());
         }
-        headIdx.index_put_({0}, NetData::getHeadNo(pos.nPieces()));
 
         torch::Tensor out = net.forward(inW, inB, headIdx);
-        double val = out.item<double>();
-
-        qEval->connectPosition(&pos);
-        int qVal = qEval->eval();
-
-        std::cout << "val: " << (val*100.0f) << " prob: " << toProb(val)
-                  << " qVal: " << qVal << " qProb: " << toProb(qVal * 0.01)
-                  << std::endl;
+        auto outAcc = out.accessor<float,2>();
+
+        qVals.resize(batchSize);
+        const int chunkSize = std::max(1, batchSize / (nWorkers * 4));
+        for (int c = 0; c < batchSize; c += chunkSize) {
+            int beginIdx = c;
+            int endIdx = std::min(c + chunkSize, batchSize);
+            pool.addTask([&positions,&qVals,&tdVec,beginIdx,endIdx](int workerNo) {
+                ThreadData& td = *tdVec[workerNo];
+                for (int i = beginIdx; i < endIdx; i++) {
+                    td.pos = positions[i];
+                    td.qEval->connectPosition(&td.pos);
+                    qVals[i] = td.qEval->eval();
+                }
+                return 0;
+            });
+        }
+        pool.getAllResults([](int){});
 
-        if (!fromStdIn)
-            break;
+        for (int b = 0; b < batchSize; b++) {
+            double val = outAcc[b][0];
+            int qVal = qVals[b];
+            std::cout << "val: " << (val*100.0f) << " prob: " << toProb(val)
+                      << " qVal: " << qVal << " qProb: " << toProb(qVal * 0.01)
+                      << '\n';
+        }
+        std::cout << std::flush;
+        nPos += batchSize;
+    }
+    if (fromStdIn) {
+        const double t = currentTime() - t0;
+        std::cerr << "Positions: " << nPos << " pos/s: "
+                  << (S64)(nPos / std::max(t, 1e-6)) << std::endl;
     }
 }
 
@@ -1069,19 +1388,41 @@ eval(const std::string& modelFile, const std::string& fen) {
 /** Given training data in "inFile", for each input feature, calculate how many
  *  data points activates it. Print result to standard output. */
 static void
-featureStats(const std::string& inFile) {
-    FileDataSet allData(inFile);
+featureStats(const std::string& inFile, int nWorkers) {
+    const double t0 = currentTime();
+    MappedDataSet allData(inFile);
+    const S64 nPos = allData.getSize();
     std::vector<S64> stats(inFeatures);
-    std::vector<int> idxVecW, idxVecB;
-    allData.forEach([&stats,&idxVecW,&idxVecB](Record& r) {
-        idxVecW.clear();
-        idxVecB.clear();
-        toSparse(r, idxVecW, idxVecB);
-        for (int idx : idxVecW)
-            stats[idx]++;
-        for (int idx : idxVecB)
-            stats[idx]++;
+    const S64 batchSize = 1024*1024;
+    ThreadPool<std::vector<S64>> pool(nWorkers);
+    for (S64 i = 0; i < nPos; i += batchSize) {
+        S64 beginIdx = i;
+        S64 endIdx = std::min(i + batchSize, nPos);
+        auto func = [&allData,beginIdx,endIdx](int workerNo) {
+            std::vector<S64> stats(inFeatures);
+            std::vector<int> idxVecW, idxVecB;
+            Record r;
+            for (S64 i = beginIdx; i < endIdx; i++) {
+                allData.getItem(i, r);
+                idxVecW.clear();
+                idxVecB.clear();
+                toSparse(r, idxVecW, idxVecB);
+                for (int idx : idxVecW)
+                    stats[idx]++;
+                for (int idx : idxVecB)
+                    stats[idx]++;
+            }
+            return stats;
+        };
+        pool.addTask(func);
+    }
+    pool.getAllResults([&stats](const std::vector<S64>& batchStats) {
+        for (int i = 0; i < inFeatures; i++)
+            stats[i] += batchStats[i];
     });
+    const double t = currentTime() - t0;
+    std::cerr << "Positions: " << nPos << " pos/s: "
+              << (S64)(nPos / std::max(t, 1e-6)) << std::endl;
 
     for (int i = 0; i < inFeatures; i++) {
         std::stringstream ss;
@@ -1118,14 +1459,54 @@ featureStats(const std::string& inFile) {
 
 // ------------------------------------------------------------------------------
 
+/** Measure the time needed to compute a feature permutation for synthetic
+ *  activation data with nPos positions. Features belong to one of 16 clusters
+ *  and features in the same cluster tend to be active at the same time. */
+static void
+permutationBench(int nPos, bool useLocalSearch, U64 rndSeed, int nWorkers) {
+    using BitSet = FeaturePerm::BitSet;
+    const int nClusters = 16;
+    const int nFeats = NetData::n1;
+    std::vector<BitSet> featureActivations(nFeats);
+    nPos = std::min(nPos, BitSet::numBits/2);
+
+    Random rnd(1);
+    std::vector<int> cluster(nFeats);
+    for (int f = 0; f < nFeats; f++)
+        cluster[f] = rnd.nextInt(nClusters);
+    for (int i = 0; i < nPos * 2; i++) {
+        int c = rnd.nextInt(nClusters);
+        for (int f = 0; f < nFeats; f++) {
+            int pPercent = cluster[f] == c ? 60 : 5;
+            if (rnd.nextInt(100) < pPercent)
+                featureActivations[f].setBit(i);
+        }
+    }
+
+    std::shared_ptr<NetData> netP = NetData::create();
+    FeaturePerm fp(*netP, nWorkers);
+    std::vector<int> permutation;
+    double t0 = currentTime();
+    double prob = fp.computePermutation(featureActivations, nPos, useLocalSearch,
+                                        rndSeed, permutation);
+    double t1 = currentTime();
+    std::cout << "nPos: " << nPos << " workers: " << nWorkers
+              << " time: " << (t1 - t0) << " prob: " << prob << std::endl;
+}
+
+// ------------------------------------------------------------------------------
+
 /** Print usage information to standard error and exit program. */
 static void
 usage() {
     std::cerr << "Usage: torchutil [-j n] cmd params\n";
     std::cerr << " -j n : Use n worker threads\n";
     std::cerr << "cmd is one of:\n";
-    std::cerr << " train [-i modelfile] [-lr rate] [-epochs n] [-qat] infile\n";
+    std::cerr << " train [-i modelfile] [-lr rate] [-epochs n] [-qat] [-mmap] [-cpu [-coo]] infile\n";
     std::cerr << "   Train network from data in infile\n";
+    std::cerr << "   -mmap : Read training data from memory mapped file in block shuffled order\n";
+    std::cerr << "   -cpu  : Train on the CPU using n worker threads, instead of on the GPU\n";
+    std::cerr << "   -coo  : Use sparse COO tensors instead of the native sparse first layer\n";
     std::cerr << " quant [-c] [-p|-pl] [-ql] infile outfile [validationFile]\n";
     std::cerr << "   Quantize infile, write result to outfile\n";
     std::cerr << "   -c       : Also create compressed network\n";
@@ -1142,6 +1523,10 @@ usage() {
     std::cerr << "   Extract validation data in binary format\n";
     std::cerr << " featstat infile\n";
     std::cerr << "   Print feature activation stats from training data\n";
+    std::cerr << " dsbench infile\n";
+    std::cerr << "   Compare time to read one epoch of training data, chunked vs memory mapped\n";
+    std::cerr << " permbench [-pl seed] nPos\n";
+    std::cerr << "   Measure feature permutation time using synthetic activation data\n";
 
     std::cerr << std::flush;
     ::exit(2);
@@ -1160,6 +1545,9 @@ doTrain(int argc, char* argv[], int nWorkers) {
     double initialLR = 1e-3;
     std::string modelFile;
     bool useQAT = false; // Quantization aware training
+    bool useMmap = false;
+    bool useCPU = false;
+    bool useCOO = false;
     argc -= 2;
     argv += 2;
     while (argc > 0) {
@@ -1182,6 +1570,18 @@ doTrain(int argc, char* argv[], int nWorkers) {
             useQAT = true;
             argc--;
             argv++;
+        } else if (arg == "-mmap") {
+            useMmap = true;
+            argc--;
+            argv++;
+        } else if (arg == "-cpu") {
+            useCPU = true;
+            argc--;
+            argv++;
+        } else if (arg == "-coo") {
+            useCOO = true;
+            argc--;
+            argv++;
         } else
             break;
     }
@@ -1193,7 +1593,8 @@ doTrain(int argc, char* argv[], int nWorkers) {
     if (!modelFile.empty())
         checkFileExists(modelFile);
     U64 seed = (U64)(currentTime() * 1000);
-    train(inFile, nEpochs, useQAT, initialLR, seed, modelFile, nWorkers);
+    train(inFile, nEpochs, useQAT, initialLR, seed, modelFile, useMmap, useCPU, useCOO,
+          nWorkers);
 }
 
 static void
@@ -1271,7 +1672,7 @@ main(int argc, char* argv[]) {
             std::string modelFile = argv[2];
             std::string fen = argv[3];
             checkFileExists(modelFile);
-            eval(modelFile, fen);
+            eval(modelFile, fen, nWorkers);
         } else if (cmd == "subset") {
             if (argc != 5)
                 usage();
@@ -1300,7 +1701,27 @@ main(int argc, char* argv[]) {
                 usage();
             std::string inFile = argv[2];
             checkFileExists(inFile);
-            featureStats(inFile);
+            featureStats(inFile, nWorkers);
+        } else if (cmd == "dsbench") {
+            if (argc != 3)
+                usage();
+            std::string inFile = argv[2];
+            checkFileExists(inFile);
+            dataSetBench(inFile);
+        } else if (cmd == "permbench") {
+            bool useLocalSearch = false;
+            U64 rndSeed = 0;
+            int arg = 2;
+            if ((argc >= 4) && (argv[2] == "-pl"s)) {
+                if (!str2Num(argv[3], rndSeed))
+                    usage();
+                useLocalSearch = true;
+                arg = 4;
+            }
+            int nPos;
+            if ((argc != arg + 1) || !str2Num(argv[arg], nPos) || nPos <= 0)
+                usage();
+            permutationBench(nPos, useLocalSearch, rndSeed, nWorkers);
         } else {
             usage();
         }
@@ -59,6 +59,9 @@ public:
 
     void timeLimit(int minTimeLimit, int maxTimeLimit) override;
 
+    /** Set maximum number of nodes to search for each move. -1 means no limit. */
+    void nodeLimit(int maxNodes);
+
     void clearTT() override;
 
     /** Search a position and return the best move and score. Used for test suite processing. */
@@ -107,6 +110,11 @@ ComputerPlayer::useBook(bool bookOn) {
     bookEnabled = bookOn;
 }
 
+inline void
+ComputerPlayer::nodeLimit(int maxNodes0) {
+    maxNodes = maxNodes0;
+}
+
 inline void
 ComputerPlayer::clearTT() {
     tt.clear();
@@ -0,0 +1,81 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * searchProfile.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "searchProfile.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+
+const char*
+SearchProfile::name(Phase p) {
+    switch (p) {
+    case SEARCH:      return "search";
+    case MOVE_GEN:    return "moveGen";
+    case MAKE_MOVE:   return "makeMove";
+    case UNMAKE_MOVE: return "unMakeMove";
+    case NN_ACCUM:    return "nnAccum";
+    case NN_LAYERS:   return "nnLayers";
+    case TT_PROBE:    return "ttProbe";
+    case TT_STORE:    return "ttStore";
+    case SEE:         return "see";
+    case TB_PROBE:    return "tbProbe";
+    case N_PHASES:    break;
+    }
+    return "";
+}
+
+void
+SearchProfile::print(std::ostream& os, const Totals& totals) {
+    const double searchCycles = totals[2 * SEARCH];
+    for (int p = 0; p < N_PHASES; p++) {
+        S64 nCycles = totals[2 * p];
+        S64 nCalls = totals[2 * p + 1];
+        std::stringstream ss;
+        ss << "info string profile " << std::left << std::setw(10) << name((Phase)p)
+           << std::right << std::fixed
+           << " cycles " << std::setw(14) << nCycles
+           << " calls " << std::setw(11) << nCalls
+           << " cycles/call " << std::setw(9) << std::setprecision(1)
+           << (nCalls > 0 ? nCycles / (double)nCalls : 0.0)
+           << " share " << std::setw(5) << std::setprecision(1)
+           << (searchCycles > 0 ? nCycles / searchCycles * 100 : 0.0) << "%";
+        os << ss.str() << std::endl;
+    }
+}
+
+std::string
+SearchProfile::toJson(const Totals& totals) {
+    std::stringstream ss;
+    ss << "{\"enabled\":" << (enabled() ? "true" : "false") << ",\"phases\":{";
+    for (int p = 0; p < N_PHASES; p++) {
+        ss << (p > 0 ? "," : "") << '"' << name((Phase)p) << "\":{\"cycles\":"
+           << totals[2 * p] << ",\"calls\":" << totals[2 * p + 1] << '}';
+    }
+    ss << "}}";
+    return ss.str();
+}
@@ -0,0 +1,160 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * searchProfile.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef SEARCHPROFILE_HPP_
+#define SEARCHPROFILE_HPP_
+
+#include "threadCounters.hpp"
+
+#include <string>
+#include <iosfwd>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+/** Measures the number of CPU cycles spent in different parts of the search.
+ *  Cycles and number of calls are accumulated for each thread. Cycles spent
+ *  in a phase that is called from another phase are also counted for the
+ *  calling phase. The measurements are only done if texel is compiled with
+ *  SEARCH_PROFILE defined, otherwise the SEARCH_PROFILE_SCOPE macro expands
+ *  to nothing. */
+class SearchProfile {
+public:
+    enum Phase {
+        SEARCH,         // Search::iterativeDeepening() and helper thread searches
+        MOVE_GEN,       // MoveGen move list generation
+        MAKE_MOVE,      // Position::makeMove()
+        UNMAKE_MOVE,    // Position::unMakeMove()
+        NN_ACCUM,       // Neural network first layer update
+        NN_LAYERS,      // Neural network remaining layers
+        TT_PROBE,       // Transposition table probe
+        TT_STORE,       // Transposition table insert
+        SEE,            // Static exchange evaluation
+        TB_PROBE,       // Endgame tablebase probe
+        N_PHASES
+    };
+
+    /** Counter 2*p is number of cycles for phase p, 2*p+1 is number of calls. */
+    using Counters = ThreadCounters<SearchProfile, 2 * N_PHASES>;
+    using Totals = Counters::Totals;
+
+    /** Return true if the search is profiled. */
+    static constexpr bool enabled();
+
+    /** Read the CPU cycle counter. */
+    static U64 cycles();
+
+    /** Add one call taking "nCycles" cycles to phase "p" for the calling thread. */
+    static void add(Phase p, U64 nCycles);
+
+    /** Get the sum over all threads since the last clear() call. */
+    static void getTotals(Totals& totals);
+
+    /** Make getTotals() count from zero again. */
+    static void clear();
+
+    /** Get the name of a phase. */
+    static const char* name(Phase p);
+
+    /** Print one "info string" line for each phase. */
+    static void print(std::ostream& os, const Totals& totals);
+
+    /** Format the profile as a JSON object. */
+    static std::string toJson(const Totals& totals);
+
+    /** Adds the cycles spent while this object is in scope to a phase. */
+    class Scope {
+    public:
+        explicit Scope(Phase p);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        const Phase phase;
+        const U64 t0;
+    };
+};
+
+#ifdef SEARCH_PROFILE
+#define SEARCH_PROFILE_SCOPE(p) SearchProfile::Scope searchProfileScope(SearchProfile::p)
+#else
+#define SEARCH_PROFILE_SCOPE(p) do { } while (false)
+#endif
+
+
+constexpr bool
+SearchProfile::enabled() {
+#ifdef SEARCH_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline U64
+SearchProfile::cycles() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    U64 val;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(val));
+    return val;
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+inline void
+SearchProfile::add(Phase p, U64 nCycles) {
+    Counters::add(2 * p, nCycles);
+    Counters::add(2 * p + 1, 1);
+}
+
+inline void
+SearchProfile::getTotals(Totals& totals) {
+    Counters::getTotals(totals);
+}
+
+inline void
+SearchProfile::clear() {
+    Counters::clear();
+}
+
+inline
+SearchProfile::Scope::Scope(Phase p)
+    : phase(p), t0(cycles()) {
+}
+
+inline
+SearchProfile::Scope::~Scope() {
+    add(phase, cycles() - t0);
+}
+
+#endif /* SEARCHPROFILE_HPP_ */
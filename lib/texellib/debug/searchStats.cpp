@@ -0,0 +1,101 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * searchStats.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "searchStats.hpp"
+
+#include <sstream>
+
+
+const SearchStats::Rate SearchStats::rates[] = {
+    { "qsShare",           QSEARCH_NODES,    SEARCH_NODES,  QSEARCH_NODES },
+    { "ttHitRate",         TT_HIT,           TT_PROBE,      N_COUNTERS },
+    { "ttCutoffRate",      TT_CUTOFF,        TT_PROBE,      N_COUNTERS },
+    { "nullCutoffRate",    NULL_MOVE_CUTOFF, NULL_MOVE,     N_COUNTERS },
+    { "lmrResearchRate",   LMR_RESEARCH,     LMR,           N_COUNTERS },
+    { "singularExtRate",   SINGULAR_EXT,     SINGULAR_TEST, N_COUNTERS },
+    { "evalCacheHitRate",  EVAL_CACHE_HIT,   EVAL,          N_COUNTERS },
+    { "nnRefreshPerEval",  NN_REFRESH,       EVAL,          N_COUNTERS },
+};
+
+
+const char*
+SearchStats::name(Counter c) {
+    switch (c) {
+    case SEARCH_NODES:     return "searchNodes";
+    case QSEARCH_NODES:    return "qsearchNodes";
+    case TT_PROBE:         return "ttProbe";
+    case TT_HIT:           return "ttHit";
+    case TT_CUTOFF:        return "ttCutoff";
+    case NULL_MOVE:        return "nullMove";
+    case NULL_MOVE_CUTOFF: return "nullMoveCutoff";
+    case LMR:              return "lmr";
+    case LMR_RESEARCH:     return "lmrResearch";
+    case SINGULAR_TEST:    return "singularTest";
+    case SINGULAR_EXT:     return "singularExt";
+    case UPCOMING_REP:     return "upcomingRep";
+    case EVAL:             return "eval";
+    case EVAL_CACHE_HIT:   return "evalCacheHit";
+    case NN_REFRESH:       return "nnRefresh";
+    case SEE:              return "see";
+    case N_COUNTERS:       break;
+    }
+    return "";
+}
+
+double
+SearchStats::getRate(const Rate& r, const Totals& totals) {
+    S64 den = totals[r.den1];
+    if (r.den2 != N_COUNTERS)
+        den += totals[r.den2];
+    return den > 0 ? totals[r.num] / (double)den : 0.0;
+}
+
+std::string
+SearchStats::toString(const Totals& totals) {
+    std::stringstream ss;
+    ss.precision(4);
+    for (int i = 0; i < N_COUNTERS; i++)
+        ss << (i > 0 ? " " : "") << name((Counter)i) << ' ' << totals[i];
+    for (const Rate& r : rates)
+        ss << ' ' << r.name << ' ' << getRate(r, totals);
+    return ss.str();
+}
+
+std::string
+SearchStats::toJson(const Totals& totals) {
+    std::stringstream ss;
+    ss.precision(4);
+    ss << "{\"enabled\":" << (enabled() ? "true" : "false") << ",\"counters\":{";
+    for (int i = 0; i < N_COUNTERS; i++)
+        ss << (i > 0 ? "," : "") << '"' << name((Counter)i) << "\":" << totals[i];
+    ss << "},\"rates\":{";
+    bool first = true;
+    for (const Rate& r : rates) {
+        ss << (first ? "" : ",") << '"' << r.name << "\":" << getRate(r, totals);
+        first = false;
+    }
+    ss << "}}";
+    return ss.str();
+}
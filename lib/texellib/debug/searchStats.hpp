@@ -0,0 +1,126 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * searchStats.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef SEARCHSTATS_HPP_
+#define SEARCHSTATS_HPP_
+
+#include "threadCounters.hpp"
+
+#include <string>
+
+/** Per-thread counters describing what the search spends its time on.
+ *  The counters are only updated by the search if texel is compiled
+ *  with SEARCH_STATS defined, otherwise the SEARCH_STAT macro expands
+ *  to nothing. */
+class SearchStats {
+public:
+    enum Counter {
+        SEARCH_NODES,       // Calls to Search::search()
+        QSEARCH_NODES,      // Calls to Search::quiesce()
+        TT_PROBE,           // Transposition table probes in Search::search()
+        TT_HIT,             // Probes that found an entry
+        TT_CUTOFF,          // Probes that caused a cutoff
+        NULL_MOVE,          // Null move searches
+        NULL_MOVE_CUTOFF,   // Null move searches that caused a cutoff
+        LMR,                // Searches with late move reduction
+        LMR_RESEARCH,       // Reduced searches that had to be re-searched
+        SINGULAR_TEST,      // Singular extension test searches
+        SINGULAR_EXT,       // Singular extensions
+        UPCOMING_REP,       // Nodes where a reversible move can repeat a position
+        EVAL,               // Calls to Evaluate::evalPos()
+        EVAL_CACHE_HIT,     // Evaluations found in the eval hash table
+        NN_REFRESH,         // Full first layer computations in the neural network
+        SEE,                // Static exchange evaluations
+        N_COUNTERS
+    };
+
+    using Counters = ThreadCounters<SearchStats, N_COUNTERS>;
+    using Totals = Counters::Totals;
+
+    /** Return true if the search updates the counters. */
+    static constexpr bool enabled();
+
+    /** Increment a counter for the calling thread. */
+    static void inc(Counter c);
+
+    /** Get the sum of all counters over all threads, since the last clear() call. */
+    static void getTotals(Totals& totals);
+
+    /** Make getTotals() count from zero again. */
+    static void clear();
+
+    /** Get the name of a counter. */
+    static const char* name(Counter c);
+
+    /** Format counters and derived rates as "name value" pairs on one line. */
+    static std::string toString(const Totals& totals);
+
+    /** Format counters and derived rates as a JSON object. */
+    static std::string toJson(const Totals& totals);
+
+private:
+    struct Rate {
+        const char* name;
+        Counter num;
+        Counter den1;
+        Counter den2;
+    };
+    static const Rate rates[];
+
+    static double getRate(const Rate& r, const Totals& totals);
+};
+
+#ifdef SEARCH_STATS
+#define SEARCH_STAT(c) SearchStats::inc(SearchStats::c)
+#else
+#define SEARCH_STAT(c) do { } while (false)
+#endif
+
+
+constexpr bool
+SearchStats::enabled() {
+#ifdef SEARCH_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline void
+SearchStats::inc(Counter c) {
+    Counters::add(c, 1);
+}
+
+inline void
+SearchStats::getTotals(Totals& totals) {
+    Counters::getTotals(totals);
+}
+
+inline void
+SearchStats::clear() {
+    Counters::clear();
+}
+
+#endif /* SEARCHSTATS_HPP_ */
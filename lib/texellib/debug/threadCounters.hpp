@@ -0,0 +1,141 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * threadCounters.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef THREADCOUNTERS_HPP_
+#define THREADCOUNTERS_HPP_
+
+#include "util.hpp"
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+/** A set of N counters for each thread. A thread only updates its own
+ *  counters, using relaxed atomic load and store, so no locked instructions
+ *  are needed. Any thread can compute the sum over all threads.
+ *  Tag is used to create independent sets of counters. */
+template <typename Tag, int N>
+class ThreadCounters {
+public:
+    using Totals = std::array<S64, N>;
+
+    /** Add "val" to counter "c" for the calling thread. */
+    static void add(int c, S64 val);
+
+    /** Get the sum of all counters over all threads, since the last clear() call. */
+    static void getTotals(Totals& totals);
+
+    /** Make getTotals() count from zero again. */
+    static void clear();
+
+private:
+    struct ThreadData {
+        ThreadData();
+        ~ThreadData();
+        std::atomic<S64> cnt[N];
+    };
+    static thread_local ThreadData threadData;
+
+    /** Data shared by all threads. */
+    struct Registry {
+        std::mutex mutex;
+        std::vector<const std::atomic<S64>*> threads; // Counters for all live threads
+        Totals retired{};                              // Counters from terminated threads
+        Totals base{};                                 // Totals at last clear() call
+    };
+    static Registry& getRegistry();
+
+    /** Compute sum over all threads. Caller must hold the registry mutex. */
+    static void sumAll(Registry& reg, Totals& totals);
+};
+
+
+template <typename Tag, int N>
+thread_local typename ThreadCounters<Tag, N>::ThreadData ThreadCounters<Tag, N>::threadData;
+
+template <typename Tag, int N>
+inline void
+ThreadCounters<Tag, N>::add(int c, S64 val) {
+    std::atomic<S64>& a = threadData.cnt[c];
+    a.store(a.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+}
+
+template <typename Tag, int N>
+void
+ThreadCounters<Tag, N>::getTotals(Totals& totals) {
+    Registry& reg = getRegistry();
+    std::lock_guard<std::mutex> L(reg.mutex);
+    sumAll(reg, totals);
+    for (int i = 0; i < N; i++)
+        totals[i] -= reg.base[i];
+}
+
+template <typename Tag, int N>
+void
+ThreadCounters<Tag, N>::clear() {
+    Registry& reg = getRegistry();
+    std::lock_guard<std::mutex> L(reg.mutex);
+    sumAll(reg, reg.base);
+}
+
+template <typename Tag, int N>
+ThreadCounters<Tag, N>::ThreadData::ThreadData() {
+    for (auto& c : cnt)
+        c.store(0, std::memory_order_relaxed);
+    Registry& reg = getRegistry();
+    std::lock_guard<std::mutex> L(reg.mutex);
+    reg.threads.push_back(cnt);
+}
+
+template <typename Tag, int N>
+ThreadCounters<Tag, N>::ThreadData::~ThreadData() {
+    Registry& reg = getRegistry();
+    std::lock_guard<std::mutex> L(reg.mutex);
+    for (int i = 0; i < N; i++)
+        reg.retired[i] += cnt[i].load(std::memory_order_relaxed);
+    reg.threads.erase(std::remove(reg.threads.begin(), reg.threads.end(), cnt),
+                      reg.threads.end());
+}
+
+template <typename Tag, int N>
+typename ThreadCounters<Tag, N>::Registry&
+ThreadCounters<Tag, N>::getRegistry() {
+    static Registry reg;
+    return reg;
+}
+
+template <typename Tag, int N>
+void
+ThreadCounters<Tag, N>::sumAll(Registry& reg, Totals& totals) {
+    totals = reg.retired;
+    for (const std::atomic<S64>* cnt : reg.threads)
+        for (int i = 0; i < N; i++)
+            totals[i] += cnt[i].load(std::memory_order_relaxed);
+}
+
+#endif /* THREADCOUNTERS_HPP_ */
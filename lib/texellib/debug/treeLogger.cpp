@@ -28,6 +28,7 @@
 #include "textio.hpp"
 #include "position.hpp"
 #include "constants.hpp"
+#include "parameters.hpp"
 
 #include <limits>
 #include <iostream>
@@ -36,19 +37,30 @@
 
 void
 TreeLoggerWriter::open(const std::string& filename, int threadNo0) {
+    close();
+    if (filename.empty())
+        return;
     auto fn = filename + "." + num2Str(threadNo0);
     os.open(fn.c_str(), std::ios_base::out |
                         std::ios_base::binary |
                         std::ios_base::trunc);
     opened = true;
     threadNo = threadNo0;
+    nextIndex = 0;
+    nInWriteCache = 0;
+    writeCache.resize(Entry::bufSize * writeCacheSize);
+
+    maxPly = UciParams::treeLogMaxPly->getIntPar();
+    maxRootMoves = UciParams::treeLogRootMoves->getIntPar();
+    sampleBits = UciParams::treeLogSampleBits->getIntPar();
+    samplePly = UciParams::treeLogSamplePly->getIntPar();
 }
 
 void
 TreeLoggerWriter::close() {
     if (opened) {
         if (nInWriteCache > 0) {
-            os.write((const char*)writeCache, Entry::bufSize * nInWriteCache);
+            os.write((const char*)writeCache.data(), Entry::bufSize * nInWriteCache);
             nInWriteCache = 0;
         }
         opened = false;
@@ -86,7 +98,7 @@ TreeLoggerWriter::appendEntry(const Entry& entry) {
     memcpy(&writeCache[Entry::bufSize * nInWriteCache], entryBuffer, Entry::bufSize);
     nInWriteCache++;
     if (nInWriteCache == writeCacheSize) {
-        os.write((const char*)writeCache, Entry::bufSize * nInWriteCache);
+        os.write((const char*)writeCache.data(), Entry::bufSize * nInWriteCache);
         nInWriteCache = 0;
     }
 }
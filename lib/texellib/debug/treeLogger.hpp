@@ -28,6 +28,7 @@
 
 #include "util.hpp"
 #include "move.hpp"
+#include "random.hpp"
 
 #include <vector>
 #include <type_traits>
@@ -37,10 +38,9 @@
 
 
 class TreeLoggerWriter;
-class TreeLoggerWriterDummy;
 
-/** Change to TreeLoggerWriter to enable tree logging. */
-using TreeLogger = TreeLoggerWriterDummy;
+/** Tree logging is enabled at runtime using the TreeLogFile UCI option. */
+using TreeLogger = TreeLoggerWriter;
 
 
 class Position;
@@ -249,7 +249,11 @@ protected:
     U8 entryBuffer[Entry::bufSize];
 };
 
-/** Writer class for logging search trees to file. */
+/** Writer class for logging search trees to file.
+ *  To bound the overhead, only a subset of the search tree can be logged,
+ *  controlled by the TreeLogMaxPly, TreeLogRootMoves, TreeLogSampleBits and
+ *  TreeLogSamplePly UCI options. When a node is not logged, none of its
+ *  descendants are logged either. */
 class TreeLoggerWriter : public TreeLoggerBase {
 public:
     /** Constructor. */
@@ -258,7 +262,12 @@ public:
     /** Destructor. */
     ~TreeLoggerWriter();
 
-    /** Open log file for writing. */
+    /** Node index returned for nodes that are not logged. */
+    static const U64 noNode = ~0ULL;
+
+    /** Open log file "filename.threadNo" for writing. Does nothing if
+     *  filename is empty. The sampling parameters are read from the UCI
+     *  options. */
     void open(const std::string& filename, int threadNo);
 
     /** Flush write cache and close log file. */
@@ -268,26 +277,31 @@ public:
     bool isOpened() const;
 
     /** Log information for new position to search.
-     * Return index of position entry. */
+     * Return index of position entry, or noNode if the log file is not opened. */
     U64 logPosition(const Position& pos);
 
-    /** Return node index that will be returned if logNodeStart() is called. */
-    U64 peekNextNodeIdx() const;
+    /** Return node index that will be returned if logNodeStart() is called
+     *  with the same parentIndex, ply, moveNo and hashKey. */
+    U64 peekNextNodeIdx(U64 parentIndex, int ply, int moveNo, U64 hashKey) const;
 
     /**
      * Log information when entering a search node.
      * @param parentId     Index of parent node.
      * @param m            Move made to go from parent node to this node
+     * @param moveNo       Index of m in the parent move list, or -1 if unknown
      * @param alpha        Search parameter
      * @param beta         Search parameter
      * @param ply          Search parameter
      * @param depth        Search parameter
-     * @return node index
+     * @param hashKey      Hash key for the position, used for subtree sampling
+     * @return node index, or noNode if the node is not logged
      */
-    U64 logNodeStart(U64 parentIndex, const Move& m, int alpha, int beta, int ply, int depth);
+    U64 logNodeStart(U64 parentIndex, const Move& m, int moveNo, int alpha, int beta,
+                     int ply, int depth, U64 hashKey);
 
     /**
-     * Log information when leaving a search node.
+     * Log information when leaving a search node. Does nothing if startIndex
+     * is noNode.
      * @param startIndex Pointer to corresponding start node entry.
      * @param score      Computed score for this node.
      * @param scoreType  See TranspositionTable, T_EXACT, T_GE, T_LE.
@@ -297,6 +311,9 @@ public:
     U64 logNodeEnd(U64 startIndex, int score, int scoreType, int evalScore, U64 hashKey);
 
 private:
+    /** Return true if a node should be logged. */
+    bool sampleNode(U64 parentIndex, int ply, int moveNo, U64 hashKey) const;
+
     /** Write position entries to end of file. */
     void writePosition(const Position& pos);
 
@@ -310,22 +327,15 @@ private:
 
     int threadNo;
 
-    static const int writeCacheSize = 1024;
-    U8 writeCache[Entry::bufSize * writeCacheSize];
-    int nInWriteCache;
-};
+    // Sampling parameters
+    int maxPly = 0;         // Only log nodes with ply < maxPly. 0 means no limit
+    int maxRootMoves = 0;   // Only log the first maxRootMoves root moves. 0 means all
+    int sampleBits = 0;     // Only log 1/2^sampleBits of the subtrees at samplePly
+    int samplePly = 0;
 
-/** Dummy version of TreeLoggerWriter. */
-class TreeLoggerWriterDummy {
-public:
-    TreeLoggerWriterDummy() { }
-    void open(const std::string& filename, int threadNo) { }
-    void close() { }
-    bool isOpened() const { return false; }
-    U64 logPosition(const Position& pos) { return 0; }
-    U64 peekNextNodeIdx() const { return 0; }
-    U64 logNodeStart(U64 parentIndex, const Move& m, int alpha, int beta, int ply, int depth) { return 0; }
-    U64 logNodeEnd(U64 startIndex, int score, int scoreType, int evalScore, U64 hashKey) { return 0; }
+    static const int writeCacheSize = 64 * 1024;
+    std::vector<U8> writeCache; // Allocated when the log file is opened
+    int nInWriteCache;
 };
 
 /**
@@ -427,20 +437,38 @@ TreeLoggerWriter::isOpened() const {
 
 inline U64
 TreeLoggerWriter::logPosition(const Position& pos) {
+    if (!opened)
+        return noNode;
     U64 ret = nextIndex;
     writePosition(pos);
     return ret;
 }
 
+inline bool
+TreeLoggerWriter::sampleNode(U64 parentIndex, int ply, int moveNo, U64 hashKey) const {
+    if (parentIndex == noNode)
+        return false;
+    if (maxPly > 0 && ply >= maxPly)
+        return false;
+    if (maxRootMoves > 0 && ply == 1 && moveNo >= maxRootMoves)
+        return false;
+    if (sampleBits > 0 && ply == samplePly && (hashU64(hashKey) >> (64 - sampleBits)) != 0)
+        return false;
+    return true;
+}
+
 inline U64
-TreeLoggerWriter::peekNextNodeIdx() const {
+TreeLoggerWriter::peekNextNodeIdx(U64 parentIndex, int ply, int moveNo, U64 hashKey) const {
+    if (!opened || !sampleNode(parentIndex, ply, moveNo, hashKey))
+        return noNode;
     return nextIndex;
 }
 
 inline U64
-TreeLoggerWriter::logNodeStart(U64 parentIndex, const Move& m, int alpha, int beta, int ply, int depth) {
-    if (!opened)
-        return 0;
+TreeLoggerWriter::logNodeStart(U64 parentIndex, const Move& m, int moveNo, int alpha, int beta,
+                               int ply, int depth, U64 hashKey) {
+    if (!opened || !sampleNode(parentIndex, ply, moveNo, hashKey))
+        return noNode;
     entry.type = EntryType::NODE_START;
     entry.se.endIndex = -1;
     entry.se.parentIndex = (U32)parentIndex;
@@ -455,8 +483,8 @@ TreeLoggerWriter::logNodeStart(U64 parentIndex, const Move& m, int alpha, int be
 
 inline U64
 TreeLoggerWriter::logNodeEnd(U64 startIndex, int score, int scoreType, int evalScore, U64 hashKey) {
-    if (!opened)
-        return 0;
+    if (!opened || startIndex == noNode)
+        return noNode;
     entry.type = EntryType::NODE_END;
     entry.ee.startIndex = (U32)startIndex;
     entry.ee.score = score;
@@ -28,6 +28,7 @@
 #include "constants.hpp"
 #include "parameters.hpp"
 #include "chessError.hpp"
+#include "searchStats.hpp"
 #include "incbin.h"
 #include <vector>
 
@@ -76,9 +77,12 @@ Evaluate::evalPos() {
     EvalHashData* ehd = nullptr;
     U64 key = posP->historyHash();
     if (useHashTable) {
+        SEARCH_STAT(EVAL);
         ehd = &getEvalHashEntry(key);
-        if ((ehd->data ^ key) < (1 << 16))
+        if ((ehd->data ^ key) < (1 << 16)) {
+            SEARCH_STAT(EVAL_CACHE_HIT);
             return (ehd->data & 0xffff) - (1 << 15);
+        }
     }
 
     int score = nnEval.eval();
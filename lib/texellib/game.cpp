@@ -118,7 +118,7 @@ Game::getGameState() {
         else
             return pos.isWhiteMove() ? WHITE_STALEMATE : BLACK_STALEMATE;
     }
-    if (insufficientMaterial())
+    if (insufficientMaterial(pos))
         return DRAW_NO_MATE;
     if (resignState != ALIVE)
         return resignState;
@@ -443,7 +443,7 @@ Game::handleBookCmd(const std::string& bookCmd) {
 }
 
 bool
-Game::insufficientMaterial() {
+Game::insufficientMaterial(const Position& pos) {
     if (pos.pieceTypeBB(Piece::WQUEEN) != 0) return false;
     if (pos.pieceTypeBB(Piece::WROOK)  != 0) return false;
     if (pos.pieceTypeBB(Piece::WPAWN)  != 0) return false;
@@ -92,6 +92,9 @@ public:
     /** Return a list of previous positions in this game, back to the last "zeroing" move. */
     void getHistory(std::vector<Position>& posList);
 
+    /** Return true if neither side can win in position "pos". */
+    static bool insufficientMaterial(const Position& pos);
+
 protected:
     /**
      * Handle a special command.
@@ -119,8 +122,6 @@ private:
 
     bool handleBookCmd(const std::string& bookCmd);
 
-    bool insufficientMaterial();
-
     /** Compute PerfT value. */
     static U64 perfT(Position& pos, int depth);
 
@@ -27,8 +27,20 @@
 #include "clustertt.hpp"
 #include "numa.hpp"
 #include "logger.hpp"
+#include "timeUtil.hpp"
 #include <thread>
 #include <iostream>
+#include <cmath>
+#ifdef CLUSTER
+#ifndef CLUSTER_MPI
+#include <csignal>
+#include <unistd.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#endif
+#endif
 
 
 Cluster&
@@ -52,6 +64,7 @@ Cluster::createLocalTTReceiver(TranspositionTable& tt) {
 Cluster::Cluster() {
 }
 
+#ifdef CLUSTER_MPI
 void
 Cluster::init(int* argc, char*** argv) {
     int provided;
@@ -70,10 +83,70 @@ void
 Cluster::finalize() {
     MPI_Finalize();
 }
+#else
+void
+Cluster::init(int* argc, char*** argv) {
+    int nProcs = 1;
+    for (int i = 1; i + 1 < *argc; i++) {
+        if ((*argv)[i] == std::string("-procs")) {
+            str2Num((*argv)[i+1], nProcs);
+            nProcs = clamp(nProcs, 1, 1024);
+            for (int j = i + 2; j <= *argc; j++)
+                (*argv)[j-2] = (*argv)[j];
+            *argc -= 2;
+            break;
+        }
+    }
+
+    if (nProcs > 1) {
+        const int nRings = 2 * (nProcs - 1);
+        const size_t ringMemSize = ShmRing::memSize(shmRingCapacity);
+        shm = std::make_unique<SharedMemory>(nRings * ringMemSize);
+        for (int i = 0; i < nRings; i++)
+            ShmRing(shm->data() + i * ringMemSize, shmRingCapacity, true);
+
+        const pid_t masterPid = getpid();
+        for (int r = 1; r < nProcs; r++) {
+            pid_t pid = fork();
+            if (pid == -1) {
+                std::cerr << "Failed to create process" << std::endl;
+                exit(1);
+            }
+            if (pid == 0) {
+                rank = r;
+                childPids.clear();
+#ifdef __linux__
+                prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+                if (getppid() != masterPid)
+                    exit(1);
+                break;
+            }
+            childPids.push_back(pid);
+        }
+        size = nProcs;
+    }
+
+    computeNeighbors();
+    computeConcurrency();
+}
+
+void
+Cluster::finalize() {
+    for (int pid : childPids)
+        waitpid(pid, nullptr, 0);
+    childPids.clear();
+}
+
+U8*
+Cluster::getRingMem(int node, bool up) const {
+    size_t idx = 2 * (node - 1) + (up ? 1 : 0);
+    return shm->data() + idx * ShmRing::memSize(shmRingCapacity);
+}
+#endif
 
 void
 Cluster::computeNeighbors() {
-    const int maxChildren = 4;
     int n = getNodeNumber();
     parent = n > 0 ? (n - 1) / maxChildren : -1;
 
@@ -88,6 +161,7 @@ void
 Cluster::computeConcurrency() {
     computeThisConcurrency(thisConcurrency);
 
+#ifdef CLUSTER_MPI
     const int nChild = children.size();
     int nChildLevels = 0;
     for (int c = 0; c < nChild; c++) {
@@ -122,6 +196,14 @@ Cluster::computeConcurrency() {
         }
         MPI_Send(&buf[0], count, MPI_INT, parent, 0, MPI_COMM_WORLD);
     }
+#else
+    for (int c : children) {
+        std::vector<Concurrency> childConcur;
+        computeSubTreeConcurrency(c, childConcur);
+        childConcurrency.push_back(std::move(childConcur));
+    }
+#endif
+    childSpeed.assign(childConcurrency.size(), 0);
     if (getNodeNumber() == 0) {
         int nc = thisConcurrency.cores;
         int nt = thisConcurrency.threads;
@@ -139,13 +221,56 @@ void
 Cluster::computeThisConcurrency(Concurrency& concurrency) const {
     int nodes;
     Numa::instance().getConcurrency(nodes, concurrency.cores, concurrency.threads);
+#ifndef CLUSTER_MPI
+    splitConcurrency(getNodeNumber(), concurrency);
+#endif
 }
 
+#ifndef CLUSTER_MPI
+void
+Cluster::computeSubTreeConcurrency(int node, std::vector<Concurrency>& concur) const {
+    Concurrency c;
+    int nodes;
+    Numa::instance().getConcurrency(nodes, c.cores, c.threads);
+    splitConcurrency(node, c);
+    concur.assign(1, c);
+
+    for (int i = 0; i < maxChildren; i++) {
+        int child = node * maxChildren + i + 1;
+        if (child >= getNumberOfNodes())
+            break;
+        std::vector<Concurrency> childConcur;
+        computeSubTreeConcurrency(child, childConcur);
+        for (size_t lev = 0; lev < childConcur.size(); lev++) {
+            if (lev + 1 >= concur.size())
+                concur.emplace_back(0, 0);
+            concur[lev+1].cores += childConcur[lev].cores;
+            concur[lev+1].threads += childConcur[lev].threads;
+        }
+    }
+}
+
+void
+Cluster::splitConcurrency(int node, Concurrency& concurrency) const {
+    auto split = [this,node](int n) {
+        return std::max(1, n / size + (node < n % size ? 1 : 0));
+    };
+    concurrency.cores = split(concurrency.cores);
+    concurrency.threads = split(concurrency.threads);
+}
+#endif
+
 Communicator*
 Cluster::createParentCommunicator(TranspositionTable& tt) {
     if (getParentNode() == -1)
         return nullptr;
+#ifdef CLUSTER_MPI
     clusterParent = std::make_unique<MPICommunicator>(nullptr, tt, getNodeNumber(), getParentNode(), -1);
+#else
+    clusterParent = std::make_unique<ShmCommunicator>(nullptr, tt, getRingMem(getNodeNumber(), true),
+                                                      getRingMem(getNodeNumber(), false),
+                                                      shmRingCapacity, -1);
+#endif
     return clusterParent.get();
 }
 
@@ -155,7 +280,12 @@ Cluster::createChildCommunicators(Communicator* mainThreadComm, TranspositionTab
     int n = childRanks.size();
     for (int i = 0; i < n; i++) {
         int peerRank = childRanks[i];
+#ifdef CLUSTER_MPI
         auto comm = std::make_unique<MPICommunicator>(mainThreadComm, tt, getNodeNumber(), peerRank, i);
+#else
+        auto comm = std::make_unique<ShmCommunicator>(mainThreadComm, tt, getRingMem(peerRank, false),
+                                                      getRingMem(peerRank, true), shmRingCapacity, i);
+#endif
         clusterChildren.push_back(std::move(comm));
     }
 }
@@ -199,6 +329,8 @@ Cluster::connectClusterReceivers(Communicator* comm) {
 
 void
 Cluster::assignThreads(int numThreads, int& threadsThisNode, std::vector<int>& threadsChildren) {
+    updateSpeeds();
+
     int nTotalCores = thisConcurrency.cores;
     int nTotalThreads = thisConcurrency.threads;
     const int nChild = childConcurrency.size();
@@ -219,43 +351,88 @@ Cluster::assignThreads(int numThreads, int& threadsThisNode, std::vector<int>& t
         numChildLevels = std::max(numChildLevels, nLev);
     }
 
+    // Nodes with unknown speed are assumed to be as fast as the fastest
+    // known node, so that they get used and measured
+    double maxSpeed = thisSpeed;
+    for (int c = 0; c < nChild; c++)
+        maxSpeed = std::max(maxSpeed, childSpeed[c]);
+    if (maxSpeed <= 0)
+        maxSpeed = 1;
+    auto speed = [this,maxSpeed](int child) -> double {
+        double s = child < 0 ? thisSpeed : childSpeed[child];
+        return s > 0 ? s : maxSpeed;
+    };
+
     const int nOverCommit = numThreads / nTotalThreads;
     numThreads %= nTotalThreads;
 
-    // Assign threads to cores using breadth first
-    if (numThreads > 0) {
-        int t = std::min(thisConcurrency.cores, numThreads);
-        threadsThisNode += t;
+    // Assign threads to cores using breadth first. Cores on faster nodes are
+    // used first. The speed is quantized so that measurement noise does not
+    // change the assignment between searches.
+    struct CoreGroup {
+        int child;  // -1 for this node
+        int cores;
+        int speedClass;
+    };
+    std::vector<CoreGroup> groups;
+    auto speedClass = [&speed](int child) -> int {
+        return (int)std::floor(std::log(speed(child)) / std::log(1.15));
+    };
+    groups.push_back(CoreGroup{-1, thisConcurrency.cores, speedClass(-1)});
+    for (int lev = 0; lev < numChildLevels; lev++)
+        for (int c = 0; c < nChild; c++)
+            if (lev < (int)childConcurrency[c].size())
+                groups.push_back(CoreGroup{c, childConcurrency[c][lev].cores, speedClass(c)});
+    std::stable_sort(groups.begin(), groups.end(), [](const CoreGroup& a, const CoreGroup& b) {
+        return a.speedClass > b.speedClass;
+    });
+    for (const CoreGroup& g : groups) {
+        if (numThreads <= 0)
+            break;
+        int t = std::min(g.cores, numThreads);
+        if (g.child < 0)
+            threadsThisNode += t;
+        else
+            threadsChildren[g.child] += t;
         numThreads -= t;
     }
-    for (int lev = 0; lev < numChildLevels && numThreads > 0; lev++) {
-        for (int c = 0; c < nChild && numThreads > 0; c++) {
-            if (lev < (int)childConcurrency[c].size()) {
-                int t = std::min(childConcurrency[c][lev].cores, numThreads);
-                threadsChildren[c] += t;
-                numThreads -= t;
-            }
-        }
-    }
 
-    // Assign threads to hardware threads proportionally
+    // Assign threads to hardware threads proportionally to number of
+    // hardware threads times speed
     int htThisNode = thisConcurrency.threads - thisConcurrency.cores;
-    int htRemain = htThisNode;
+    double htRemain = htThisNode * speed(-1);
     for (int c = 0; c < nChild; c++)
-        htRemain += htChildren[c];
-
-    if (numThreads > 0) {
-        int t = (numThreads * htThisNode + htRemain - 1) / htRemain;
-        threadsThisNode += t;
+        htRemain += htChildren[c] * speed(c);
+
+    int htUsedThisNode = 0;
+    std::vector<int> htUsedChildren(nChild, 0);
+    if (numThreads > 0 && htRemain > 0) {
+        double w = htThisNode * speed(-1);
+        int t = std::min((int)std::ceil(numThreads * w / htRemain), htThisNode);
+        htUsedThisNode += t;
+        numThreads -= t;
+        htRemain -= w;
+    }
+    for (int c = 0; c < nChild && numThreads > 0 && htRemain > 0; c++) {
+        double w = htChildren[c] * speed(c);
+        int t = std::min((int)std::ceil(numThreads * w / htRemain), htChildren[c]);
+        htUsedChildren[c] += t;
         numThreads -= t;
-        htRemain -= htThisNode;
+        htRemain -= w;
     }
-    for (int c = 0; c < nChild && numThreads > 0; c++) {
-        int t = (numThreads * htChildren[c] + htRemain - 1) / htRemain;
-        threadsChildren[c] += t;
+    if (numThreads > 0) { // Can happen when a node got less than its weighted share
+        int t = std::min(htThisNode - htUsedThisNode, numThreads);
+        htUsedThisNode += t;
         numThreads -= t;
-        htRemain -= htChildren[c];
+        for (int c = 0; c < nChild && numThreads > 0; c++) {
+            int t = std::min(htChildren[c] - htUsedChildren[c], numThreads);
+            htUsedChildren[c] += t;
+            numThreads -= t;
+        }
     }
+    threadsThisNode += htUsedThisNode;
+    for (int c = 0; c < nChild; c++)
+        threadsChildren[c] += htUsedChildren[c];
 
     // Assign over-committed threads
     threadsThisNode += nOverCommit * thisConcurrency.threads;
@@ -265,40 +442,72 @@ Cluster::assignThreads(int numThreads, int& threadsThisNode, std::vector<int>& t
             concur += e.threads;
         threadsChildren[c] += nOverCommit * concur;
     }
+
+    localThreads = threadsThisNode;
+    localNodes = 0;
+    searchStartTime = currentTime();
+    searchStopTime = 0;
+}
+
+void
+Cluster::updateSpeeds() {
+    const double stopTime = searchStopTime;
+    const double t = stopTime - searchStartTime;
+    if (searchStartTime <= 0 || stopTime <= 0 || t < 0.05)
+        return;
+
+    auto update = [t](double& speed, S64 nodes, int nThreads) {
+        if (nodes <= 0 || nThreads <= 0)
+            return;
+        double s = nodes / (nThreads * t);
+        speed = speed > 0 ? (speed + s) * 0.5 : s;
+    };
+    update(thisSpeed, localNodes, localThreads);
+    for (auto& comm : clusterChildren) {
+        int c = comm->clusterChildNo();
+        update(childSpeed[c], comm->getSubTreeNodes(), comm->getAssignedThreads());
+    }
+}
+
+void
+Cluster::searchStopped() {
+    double expected = 0;
+    searchStopTime.compare_exchange_strong(expected, currentTime());
 }
 
 // ----------------------------------------------------------------------------
 
-MPICommunicator::MPICommunicator(Communicator* parent, TranspositionTable& tt,
-                                 int myRank, int peerRank, int childNo)
-    : Communicator(parent, tt), myRank(myRank), peerRank(peerRank), childNo(childNo),
-      ttReceiver(std::make_unique<ClusterTTReceiver>(CommandType::TT_DATA, peerRank, getCTT())) {
+ClusterCommunicator::ClusterCommunicator(Communicator* parent, TranspositionTable& tt, int childNo)
+    : Communicator(parent, tt), childNo(childNo),
+      ttReceiver(std::make_unique<ClusterTTReceiver>(CommandType::TT_DATA, getCTT())) {
 }
 
 TTReceiver*
-MPICommunicator::getTTReceiver() {
+ClusterCommunicator::getTTReceiver() {
     return ttReceiver.get();
 }
 
 void
-MPICommunicator::doSendAssignThreads(int nThreads, int firstThreadNo) {
+ClusterCommunicator::doSendAssignThreads(int nThreads, int firstThreadNo) {
     ttReceiver->setDisabled(nThreads == 0);
+    subTreeNodes = 0;
+    assignedThreads = nThreads;
     cmdQueue.push_back(std::make_unique<AssignThreadsCommand>(nThreads, firstThreadNo));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::doSendInitSearch(const Position& pos,
-                                  const std::vector<U64>& posHashList, int posHashListSize,
-                                  bool clearHistory, int whiteContempt) {
+ClusterCommunicator::doSendInitSearch(const Position& pos,
+                                      const std::vector<U64>& posHashList, int posHashListSize,
+                                      bool clearHistory, int whiteContempt) {
     cmdQueue.push_back(std::make_unique<InitSearchCommand>(pos, posHashList, posHashListSize,
                                                            clearHistory, whiteContempt));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::doSendStartSearch(int jobId, const SearchTreeInfo& sti,
-                                   int alpha, int beta, int depth) {
+ClusterCommunicator::doSendStartSearch(int jobId, const SearchTreeInfo& sti,
+                                       int alpha, int beta, int depth) {
     cmdQueue.erase(std::remove_if(cmdQueue.begin(), cmdQueue.end(),
                                   [](const std::unique_ptr<Command>& cmd) {
                                       return cmd->type == CommandType::START_SEARCH ||
@@ -307,11 +516,11 @@ MPICommunicator::doSendStartSearch(int jobId, const SearchTreeInfo& sti,
                                   }),
                    cmdQueue.end());
     cmdQueue.push_back(std::make_unique<StartSearchCommand>(jobId, sti, alpha, beta, depth));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::doSendStopSearch() {
+ClusterCommunicator::doSendStopSearch() {
     cmdQueue.erase(std::remove_if(cmdQueue.begin(), cmdQueue.end(),
                                   [](const std::unique_ptr<Command>& cmd) {
                                       return cmd->type == CommandType::START_SEARCH ||
@@ -320,32 +529,32 @@ MPICommunicator::doSendStopSearch() {
                                   }),
                    cmdQueue.end());
     cmdQueue.push_back(std::make_unique<Command>(CommandType::STOP_SEARCH));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::doSendSetParam(const std::string& name, const std::string& value) {
+ClusterCommunicator::doSendSetParam(const std::string& name, const std::string& value) {
     int s = name.length() + value.length() + 2 * sizeof(int);
     if (s + sizeof(Communicator::Command) < SearchConst::MAX_CLUSTER_BUF_SIZE) {
         cmdQueue.push_back(std::make_unique<SetParamCommand>(name, value));
-        mpiSend();
+        sendQueued();
     }
 }
 
 void
-MPICommunicator::doSendQuit() {
+ClusterCommunicator::doSendQuit() {
     cmdQueue.push_back(std::make_unique<Command>(CommandType::QUIT));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::doSendReportResult(int jobId, int score) {
+ClusterCommunicator::doSendReportResult(int jobId, int score) {
     cmdQueue.push_back(std::make_unique<Command>(CommandType::REPORT_RESULT, jobId, score));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::doSendReportStats(S64 nodesSearched, S64 tbHits) {
+ClusterCommunicator::doSendReportStats(S64 nodesSearched, S64 tbHits) {
     bool done = false;
     for (std::unique_ptr<Command>& c : cmdQueue) {
         if (c->type == CommandType::REPORT_STATS) {
@@ -358,28 +567,101 @@ MPICommunicator::doSendReportStats(S64 nodesSearched, S64 tbHits) {
     }
     if (!done)
         cmdQueue.push_back(std::make_unique<ReportStatsCommand>(nodesSearched, tbHits));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::retrieveStats(S64& nodesSearched, S64& tbHits) {
+ClusterCommunicator::retrieveStats(S64& nodesSearched, S64& tbHits) {
     assert(false); // Not used
 }
 
 void
-MPICommunicator::doSendStopAck() {
+ClusterCommunicator::doSendStopAck() {
     cmdQueue.push_back(std::make_unique<Command>(CommandType::STOP_ACK));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::doSendQuitAck() {
+ClusterCommunicator::doSendQuitAck() {
     cmdQueue.push_back(std::make_unique<Command>(CommandType::QUIT_ACK));
-    mpiSend();
+    sendQueued();
 }
 
 void
-MPICommunicator::mpiSend() {
+ClusterCommunicator::handleReceived(const U8* buf, int len, int& nTTReceives) {
+    std::unique_ptr<Command> cmd = Command::createFromByteBuf(buf);
+    switch (cmd->type) {
+    case CommandType::ASSIGN_THREADS: {
+        const AssignThreadsCommand* aCmd = static_cast<const AssignThreadsCommand*>(cmd.get());
+        forwardAssignThreads(aCmd->nThreads, aCmd->firstThreadNo);
+        break;
+    }
+    case CommandType::INIT_SEARCH: {
+        const InitSearchCommand* iCmd = static_cast<const InitSearchCommand*>(cmd.get());
+        Position pos;
+        pos.deSerialize(iCmd->posData);
+        sendInitSearch(pos, iCmd->posHashList, iCmd->posHashListSize, iCmd->clearHistory,
+                       iCmd->whiteContempt);
+        break;
+    }
+    case CommandType::START_SEARCH: {
+        const StartSearchCommand* sCmd = static_cast<const StartSearchCommand*>(cmd.get());
+        sendStartSearch(sCmd->jobId, sCmd->sti, sCmd->alpha, sCmd->beta, sCmd->depth);
+        break;
+    }
+    case CommandType::STOP_SEARCH:
+        Cluster::instance().searchStopped();
+        sendStopSearch();
+        break;
+    case CommandType::SET_PARAM: {
+        const SetParamCommand* spCmd = static_cast<const SetParamCommand*>(cmd.get());
+        sendSetParam(spCmd->name, spCmd->value, true);
+        break;
+    }
+    case CommandType::QUIT:
+        sendQuit();
+        quitFlag = true;
+        break;
+    case CommandType::REPORT_RESULT:
+        sendReportResult(cmd->jobId, cmd->resultScore);
+        break;
+    case CommandType::STOP_ACK:
+        forwardStopAck();
+        break;
+    case CommandType::QUIT_ACK:
+        forwardQuitAck();
+        quitFlag = true;
+        break;
+    case CommandType::REPORT_STATS: {
+        const ReportStatsCommand* rCmd = static_cast<const ReportStatsCommand*>(cmd.get());
+        subTreeNodes += rCmd->nodesSearched;
+        getParent()->sendReportStats(rCmd->nodesSearched, rCmd->tbHits, false);
+        break;
+    }
+    case CommandType::TT_DATA:
+        ttReceiver->receiveBuffer(buf, len);
+        nTTReceives++;
+        break;
+    case CommandType::TT_ACK:
+        ttReceiver->ttAck(cmd->resultScore);
+        break;
+    }
+}
+
+void
+ClusterCommunicator::notifyThread() {
+}
+
+// ----------------------------------------------------------------------------
+
+#ifdef CLUSTER_MPI
+MPICommunicator::MPICommunicator(Communicator* parent, TranspositionTable& tt,
+                                 int myRank, int peerRank, int childNo)
+    : ClusterCommunicator(parent, tt, childNo), myRank(myRank), peerRank(peerRank) {
+}
+
+void
+MPICommunicator::sendQueued() {
     for (int loop = 0; loop < 100; loop++) {
         if (sendBusy) {
             int flag;
@@ -399,8 +681,12 @@ MPICommunicator::mpiSend() {
     }
 
     if (!sendBusy) {
-        if (ttReceiver->sendBuffer(sendReq))
+        const U8* data;
+        int count;
+        if (ttReceiver->getSendBuffer(data, count)) {
+            MPI_Isend(data, count, MPI_BYTE, peerRank, 0, MPI_COMM_WORLD, &sendReq);
             sendBusy = true;
+        }
     }
 }
 
@@ -409,7 +695,7 @@ MPICommunicator::doPoll(int pass) {
     if (pass == 0)
         mpiRecv();
     if (pass == 1)
-        mpiSend();
+        sendQueued();
 }
 
 void
@@ -421,64 +707,9 @@ MPICommunicator::mpiRecv() {
             MPI_Status status;
             MPI_Test(&recvReq, &flag, &status);
             if (flag) {
-                std::unique_ptr<Command> cmd = Command::createFromByteBuf(&recvBuf[0]);
-                switch (cmd->type) {
-                case CommandType::ASSIGN_THREADS: {
-                    const AssignThreadsCommand* aCmd = static_cast<const AssignThreadsCommand*>(cmd.get());
-                    forwardAssignThreads(aCmd->nThreads, aCmd->firstThreadNo);
-                    break;
-                }
-                case CommandType::INIT_SEARCH: {
-                    const InitSearchCommand* iCmd = static_cast<const InitSearchCommand*>(cmd.get());
-                    Position pos;
-                    pos.deSerialize(iCmd->posData);
-                    sendInitSearch(pos, iCmd->posHashList, iCmd->posHashListSize, iCmd->clearHistory,
-                                   iCmd->whiteContempt);
-                    break;
-                }
-                case CommandType::START_SEARCH: {
-                    const StartSearchCommand* sCmd = static_cast<const StartSearchCommand*>(cmd.get());
-                    sendStartSearch(sCmd->jobId, sCmd->sti, sCmd->alpha, sCmd->beta, sCmd->depth);
-                    break;
-                }
-                case CommandType::STOP_SEARCH:
-                    sendStopSearch();
-                    break;
-                case CommandType::SET_PARAM: {
-                    const SetParamCommand* spCmd = static_cast<const SetParamCommand*>(cmd.get());
-                    sendSetParam(spCmd->name, spCmd->value, true);
-                    break;
-                }
-                case CommandType::QUIT:
-                    sendQuit();
-                    quitFlag = true;
-                    break;
-                case CommandType::REPORT_RESULT:
-                    sendReportResult(cmd->jobId, cmd->resultScore);
-                    break;
-                case CommandType::STOP_ACK:
-                    forwardStopAck();
-                    break;
-                case CommandType::QUIT_ACK:
-                    forwardQuitAck();
-                    quitFlag = true;
-                    break;
-                case CommandType::REPORT_STATS: {
-                    const ReportStatsCommand* rCmd = static_cast<const ReportStatsCommand*>(cmd.get());
-                    getParent()->sendReportStats(rCmd->nodesSearched, rCmd->tbHits, false);
-                    break;
-                }
-                case CommandType::TT_DATA: {
-                    int count;
-                    MPI_Get_count(&status, MPI_BYTE, &count);
-                    ttReceiver->receiveBuffer(&recvBuf[0], count);
-                    nTTReceives++;
-                    break;
-                }
-                case CommandType::TT_ACK:
-                    ttReceiver->ttAck(cmd->resultScore);
-                    break;
-                }
+                int count;
+                MPI_Get_count(&status, MPI_BYTE, &count);
+                handleReceived(&recvBuf[0], count, nTTReceives);
                 recvBusy = false;
             }
         }
@@ -494,8 +725,64 @@ MPICommunicator::mpiRecv() {
         cmdQueue.push_back(std::make_unique<Command>(CommandType::TT_ACK, -1, nTTReceives));
 }
 
+#else
+
+ShmCommunicator::ShmCommunicator(Communicator* parent, TranspositionTable& tt,
+                                 U8* sendMem, U8* recvMem, size_t ringCapacity, int childNo)
+    : ClusterCommunicator(parent, tt, childNo),
+      sendRing(sendMem, ringCapacity, false), recvRing(recvMem, ringCapacity, false) {
+}
+
 void
-MPICommunicator::notifyThread() {
+ShmCommunicator::sendQueued() {
+    for (int loop = 0; loop < 100; loop++) {
+        if (pendingLen > 0) {
+            if (!sendRing.put(pendingData, pendingLen))
+                return;
+            pendingLen = 0;
+        }
+        if (cmdQueue.empty())
+            break;
+        std::unique_ptr<Command> cmd = std::move(cmdQueue.front());
+        cmdQueue.pop_front();
+        U8* buf = cmd->toByteBuf(&sendBuf[0]);
+        pendingData = &sendBuf[0];
+        pendingLen = (int)(buf - &sendBuf[0]);
+    }
+
+    if (pendingLen == 0) {
+        const U8* data;
+        int count;
+        if (ttReceiver->getSendBuffer(data, count)) {
+            if (!sendRing.put(data, count)) {
+                pendingData = data;
+                pendingLen = count;
+            }
+        }
+    }
 }
 
+void
+ShmCommunicator::doPoll(int pass) {
+    if (pass == 0)
+        shmRecv();
+    if (pass == 1)
+        sendQueued();
+}
+
+void
+ShmCommunicator::shmRecv() {
+    int nTTReceives = 0;
+    for (int loop = 0; loop < 100 && !quitFlag; loop++) {
+        int len = recvRing.get(&recvBuf[0], recvBuf.size());
+        if (len < 0)
+            break;
+        handleReceived(&recvBuf[0], len, nTTReceives);
+    }
+    if (nTTReceives > 0)
+        cmdQueue.push_back(std::make_unique<Command>(CommandType::TT_ACK, -1, nTTReceives));
+}
+
+#endif // CLUSTER_MPI
+
 #endif // CLUSTER
@@ -27,24 +27,29 @@
 #define CLUSTER_HPP_
 
 #include "parallel.hpp"
-#ifdef CLUSTER
+#include "shmRing.hpp"
+#ifdef CLUSTER_MPI
 #include <mpi.h>
 #endif
 
 #include <vector>
+#include <atomic>
 
 
 #ifdef CLUSTER
 
 class TTReceiver;
 class ClusterTTReceiver;
+class ClusterCommunicator;
 
 class Cluster {
 public:
     /** Get the singleton instance. */
     static Cluster& instance();
 
-    /** Initialize cluster processes. */
+    /** Initialize cluster processes. If MPI is not used, "-procs N" in the
+     *  command line arguments causes N-1 additional processes to be created,
+     *  connected to this process using shared memory. */
     void init(int* argc, char*** argv);
 
     /** Terminate cluster processes. */
@@ -69,9 +74,17 @@ public:
     void connectClusterReceivers(Communicator* comm);
 
     /** Assign numThreads threads to this node and child nodes so that
-     *  available cores and hardware threads are utilized in a good way. */
+     *  available cores and hardware threads are utilized in a good way.
+     *  Cores on nodes that were measured to be faster in previous searches
+     *  are used first. Called at the start of each search. */
     void assignThreads(int numThreads, int& threadsThisNode, std::vector<int>& threadsChildren);
 
+    /** Add to number of nodes searched by threads in this process. */
+    void addLocalNodes(S64 nodes);
+
+    /** Called when a search is stopped. */
+    void searchStopped();
+
     /** Get/set the offset between node local thread number and global thread number.
      *  globalThreadNo = globalThreadOffset + localThreadNo */
     int getGlobalThreadOffset() const;
@@ -107,6 +120,28 @@ private:
     /** Compute hardware concurrency for this node. */
     void computeThisConcurrency(Concurrency& concurrency) const;
 
+    /** Update measured speed of this node and child nodes,
+     *  using statistics from the previous search. */
+    void updateSpeeds();
+
+#ifndef CLUSTER_MPI
+    /** Compute concurrency for each level of the subtree rooted at "node". */
+    void computeSubTreeConcurrency(int node, std::vector<Concurrency>& concur) const;
+
+    /** Reduce host concurrency to the part used by "node". All processes run
+     *  on the same computer, so the hardware is split evenly between them. */
+    void splitConcurrency(int node, Concurrency& concurrency) const;
+
+    /** Get shared memory used by the ring buffer that sends data from the
+     *  parent of "node" to "node" (up = false) or from "node" to its parent (up = true). */
+    U8* getRingMem(int node, bool up) const;
+
+    static const size_t shmRingCapacity = 1024 * 1024;
+    std::unique_ptr<SharedMemory> shm;
+    std::vector<int> childPids;
+#endif
+
+    static const int maxChildren = 4;
 
     int rank = 0;
     int size = 1;
@@ -115,17 +150,27 @@ private:
     int parent = -1;
     std::vector<int> children;
 
-    std::unique_ptr<Communicator> clusterParent;
-    std::vector<std::unique_ptr<Communicator>> clusterChildren;
+    std::unique_ptr<ClusterCommunicator> clusterParent;
+    std::vector<std::unique_ptr<ClusterCommunicator>> clusterChildren;
 
     Concurrency thisConcurrency;
     std::vector<std::vector<Concurrency>> childConcurrency;  // [childNo][level]
+
+    // Measured search speed in nodes per second per thread, 0 if unknown.
+    double thisSpeed = 0;
+    std::vector<double> childSpeed;                          // [childNo]
+
+    int localThreads = 0;         // Number of threads used by this node in current search
+    std::atomic<S64> localNodes{0};
+    double searchStartTime = 0;
+    std::atomic<double> searchStopTime{0};
 };
 
-class MPICommunicator : public Communicator {
+/** Base class for communicators that send serialized commands and transposition
+ *  table data to a Communicator in a different process. */
+class ClusterCommunicator : public Communicator {
 public:
-    MPICommunicator(Communicator* parent, TranspositionTable& tt,
-                    int myRank, int peerRank, int childNo);
+    ClusterCommunicator(Communicator* parent, TranspositionTable& tt, int childNo);
 
     TTReceiver* getTTReceiver() override;
 
@@ -147,18 +192,48 @@ public:
     void doSendStopAck() override;
     void doSendQuitAck() override;
 
-    void mpiSend();
+    void notifyThread() override;
+
+    /** Number of nodes searched by the peer and its children since the
+     *  last doSendAssignThreads() call. */
+    S64 getSubTreeNodes() const;
+
+    /** Number of threads assigned to the peer and its children. */
+    int getAssignedThreads() const;
+
+protected:
+    /** Send as many queued commands and as much TT data as possible to the peer. */
+    virtual void sendQueued() = 0;
+
+    /** Handle a command of length "len" received from the peer.
+     *  nTTReceives is incremented if the command contained TT data. */
+    void handleReceived(const U8* buf, int len, int& nTTReceives);
+
+    const int childNo;
+    std::unique_ptr<ClusterTTReceiver> ttReceiver;
+    bool quitFlag = false;
+
+    std::atomic<S64> subTreeNodes{0};
+    int assignedThreads = 0;
+};
+
+#ifdef CLUSTER_MPI
+/** Handles communication with a search process using MPI. */
+class MPICommunicator : public ClusterCommunicator {
+public:
+    MPICommunicator(Communicator* parent, TranspositionTable& tt,
+                    int myRank, int peerRank, int childNo);
 
     void doPoll(int pass) override;
 
-    void notifyThread() override;
+protected:
+    void sendQueued() override;
 
 private:
     void mpiRecv();
 
     const int myRank;
     const int peerRank;
-    const int childNo;
 
     bool sendBusy = false;
     MPI_Request sendReq;
@@ -166,13 +241,35 @@ private:
     bool recvBusy = false;
     MPI_Request recvReq;
 
-    std::unique_ptr<ClusterTTReceiver> ttReceiver;
+    std::array<U8,SearchConst::MAX_CLUSTER_BUF_SIZE> sendBuf;
+    std::array<U8,SearchConst::MAX_CLUSTER_BUF_SIZE> recvBuf;
+};
+#else
+/** Handles communication with a search process on the same computer,
+ *  using one shared memory ring buffer for each direction. */
+class ShmCommunicator : public ClusterCommunicator {
+public:
+    ShmCommunicator(Communicator* parent, TranspositionTable& tt,
+                    U8* sendMem, U8* recvMem, size_t ringCapacity, int childNo);
 
-    bool quitFlag = false;
+    void doPoll(int pass) override;
+
+protected:
+    void sendQueued() override;
+
+private:
+    void shmRecv();
+
+    ShmRing sendRing;
+    ShmRing recvRing;
+
+    const U8* pendingData = nullptr; // Data not yet written to sendRing because it was full
+    int pendingLen = 0;
 
     std::array<U8,SearchConst::MAX_CLUSTER_BUF_SIZE> sendBuf;
     std::array<U8,SearchConst::MAX_CLUSTER_BUF_SIZE> recvBuf;
 };
+#endif
 
 inline bool
 Cluster::isMasterNode() const {
@@ -214,11 +311,26 @@ Cluster::getChildNodes() const {
     return children;
 }
 
+inline void
+Cluster::addLocalNodes(S64 nodes) {
+    localNodes += nodes;
+}
+
 inline int
-MPICommunicator::clusterChildNo() const {
+ClusterCommunicator::clusterChildNo() const {
     return childNo;
 }
 
+inline S64
+ClusterCommunicator::getSubTreeNodes() const {
+    return subTreeNodes;
+}
+
+inline int
+ClusterCommunicator::getAssignedThreads() const {
+    return assignedThreads;
+}
+
 #else
 class Cluster {
 public:
@@ -236,6 +348,8 @@ public:
         threadsThisNode = numThreads;
         threadsChildren.clear();
     }
+    void addLocalNodes(S64 nodes) {}
+    void searchStopped() {}
     int getGlobalThreadOffset() const { return 0; }
     void setGlobalThreadOffset(int offs) {}
 };
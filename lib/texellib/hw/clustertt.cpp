@@ -27,9 +27,179 @@
 #include "cluster.hpp"
 #include "logger.hpp"
 #include "treeLogger.hpp"
+#include "bitBoard.hpp"
+#include "timeUtil.hpp"
 
+#include <algorithm>
 #include <limits.h>
 
+namespace {
+
+/** Writes a sequence of bit fields to a byte buffer. */
+class BitWriter {
+public:
+    explicit BitWriter(U8* buf) : buf(buf) {}
+
+    /** Write the "n" low bits of "val". n <= 56. */
+    void write(U64 val, int n) {
+        acc |= (val & ((1ULL << n) - 1)) << nAcc;
+        nAcc += n;
+        while (nAcc >= 8) {
+            *buf++ = (U8)acc;
+            acc >>= 8;
+            nAcc -= 8;
+        }
+    }
+
+    /** Write a non-negative value using an exponential Golomb code of order k. */
+    void writeExpGolomb(U32 val, int k) {
+        U64 v = (U64)val + (1ULL << k);
+        int nb = BitUtil::lastBit(v) + 1;
+        write(0, nb - k - 1);
+        write(1, 1);
+        write(v, nb - 1);
+    }
+
+    /** Flush partial byte and return pointer to first byte after the written data. */
+    U8* finish() {
+        if (nAcc > 0)
+            *buf++ = (U8)acc;
+        acc = 0;
+        nAcc = 0;
+        return buf;
+    }
+
+private:
+    U8* buf;
+    U64 acc = 0;
+    int nAcc = 0;
+};
+
+/** Reads a sequence of bit fields written by BitWriter. */
+class BitReader {
+public:
+    BitReader(const U8* buf, int len) : buf(buf), end(buf + len) {}
+
+    /** Read an n bit value. n <= 56. */
+    U64 read(int n) {
+        while (nAcc < n) {
+            U64 b = buf < end ? *buf++ : 0;
+            acc |= b << nAcc;
+            nAcc += 8;
+        }
+        U64 ret = acc & ((1ULL << n) - 1);
+        acc >>= n;
+        nAcc -= n;
+        return ret;
+    }
+
+    U32 readExpGolomb(int k) {
+        int nZero = 0;
+        while (read(1) == 0 && nZero < 32)
+            nZero++;
+        int nb = nZero + k + 1;
+        U64 v = (1ULL << (nb - 1)) | read(nb - 1);
+        return (U32)(v - (1ULL << k));
+    }
+
+private:
+    const U8* buf;
+    const U8* end;
+    U64 acc = 0;
+    int nAcc = 0;
+};
+
+inline U32 zigZag(int v) { return ((U32)v << 1) ^ (U32)(v >> 31); }
+inline int unZigZag(U32 v) { return (int)(v >> 1) ^ -(int)(v & 1); }
+
+inline int expGolombBits(U32 val, int k) {
+    int nb = BitUtil::lastBit((U64)val + (1ULL << k)) + 1;
+    return 2 * nb - k - 1;
+}
+
+const int keyLowBits = 56;
+const int depthK = 3;
+const int scoreK = 6;
+
+}
+
+int
+TTBatchCodec::entryBits(const TranspositionTable::TTEntry& ent) {
+    Move m;
+    ent.getMove(m);
+    int promote = m.getCompressedMove() >> 12;
+    return 1 + keyLowBits +                        // Key
+           12 + 1 + (promote ? 4 : 0) +            // Move
+           2 + 1 +                                 // Type, busy
+           expGolombBits(ent.getDepth(), depthK) +
+           expGolombBits(zigZag(ent.getScore(0)), scoreK) +
+           expGolombBits(zigZag(ent.getEvalScore()), scoreK);
+}
+
+U8*
+TTBatchCodec::encode(std::vector<TranspositionTable::TTEntry>& ents, U8* buf) {
+    std::sort(ents.begin(), ents.end(),
+              [](const TranspositionTable::TTEntry& a, const TranspositionTable::TTEntry& b) {
+                  return a.getKey() < b.getKey();
+              });
+    BitWriter bw(buf);
+    bw.write(ents.size(), 16);
+    int prevHigh = 0;
+    for (const TranspositionTable::TTEntry& ent : ents) {
+        U64 key = ent.getKey();
+        int high = (int)(key >> keyLowBits);
+        for ( ; prevHigh < high; prevHigh++)
+            bw.write(0, 1);
+        bw.write(1, 1);
+        bw.write(key, keyLowBits);
+
+        Move m;
+        ent.getMove(m);
+        int move = m.getCompressedMove();
+        bw.write(move, 12);
+        int promote = move >> 12;
+        bw.write(promote ? 1 : 0, 1);
+        if (promote)
+            bw.write(promote, 4);
+        bw.write(ent.getType(), 2);
+        bw.write(ent.getBusy() ? 1 : 0, 1);
+        bw.writeExpGolomb(ent.getDepth(), depthK);
+        bw.writeExpGolomb(zigZag(ent.getScore(0)), scoreK);
+        bw.writeExpGolomb(zigZag(ent.getEvalScore()), scoreK);
+    }
+    return bw.finish();
+}
+
+void
+TTBatchCodec::decode(const U8* buf, int len, std::vector<TranspositionTable::TTEntry>& ents) {
+    BitReader br(buf, len);
+    int n = (int)br.read(16);
+    ents.resize(n);
+    U64 high = 0;
+    for (int i = 0; i < n; i++) {
+        while (br.read(1) == 0 && high < 255)
+            high++;
+        U64 key = (high << keyLowBits) | br.read(keyLowBits);
+
+        TranspositionTable::TTEntry& ent = ents[i];
+        ent = TranspositionTable::TTEntry();
+        ent.setKey(key);
+        int move = (int)br.read(12);
+        if (br.read(1))
+            move |= (int)br.read(4) << 12;
+        Move m;
+        m.setFromCompressed(move);
+        ent.setMove(m);
+        ent.setType((int)br.read(2));
+        ent.setBusy(br.read(1) != 0);
+        ent.setDepth(br.readExpGolomb(depthK));
+        ent.setScore(unZigZag(br.readExpGolomb(scoreK)), 0);
+        ent.setEvalScore(unZigZag(br.readExpGolomb(scoreK)));
+    }
+}
+
+// ----------------------------------------------------------------------------
+
 #ifdef CLUSTER
 
 ClusterTT::ClusterTT(TranspositionTable& tt)
@@ -128,8 +298,8 @@ LocalTTReceiver::applyChunk(const ChangeBatch& changes) {
 
 // ----------------------------------------------------------------------------
 
-ClusterTTReceiver::ClusterTTReceiver(int cmdType, int peerRank, ClusterTT& ctt)
-    : cmdType(cmdType), peerRank(peerRank), ctt(ctt), currBuf(&buffer[0]) {
+ClusterTTReceiver::ClusterTTReceiver(int cmdType, ClusterTT& ctt)
+    : cmdType(cmdType), ctt(ctt), sentFilter(4096), currBuf(&buffer[0]) {
     initBuf();
 }
 
@@ -138,15 +308,18 @@ ClusterTTReceiver::applyChunk(const ChangeBatch& changes) {
     if (disabled)
         return INT_MAX;
     std::lock_guard<std::mutex> L(mutex);
+    const int maxBits = (SearchConst::MAX_CLUSTER_BUF_SIZE - sizeof(int)) * 8;
     int n = changes.nEnts;
     for (int i = 0; i < n; i++) {
         const TranspositionTable::TTEntry& ent = changes.ent[i];
         if (ent.getDepth() < minDepth)
             continue;
-        if (currBuf->size + 16 <= SearchConst::MAX_CLUSTER_BUF_SIZE) {
-            U8* buf = &currBuf->data[currBuf->size];
-            Serializer::serialize<64>(buf, ent.getKey(), ent.getData());
-            currBuf->size += 16;
+        int nBits = TTBatchCodec::entryBits(ent);
+        if (currBuf->nBits + nBits <= maxBits) {
+            if (recentlySent(ent))
+                continue;
+            currBuf->ents.push_back(ent);
+            currBuf->nBits += nBits;
         } else {
             if (!full) {
                 full = true;
@@ -157,33 +330,55 @@ ClusterTTReceiver::applyChunk(const ChangeBatch& changes) {
     return minDepth;
 }
 
+bool
+ClusterTTReceiver::recentlySent(const TranspositionTable::TTEntry& ent) {
+    const U64 genMask = 0xfULL << 42;
+    const U64 key = ent.getKey();
+    const U64 data = ent.getData() & ~genMask;
+    SentEntry& se = sentFilter[key & (sentFilter.size() - 1)];
+    if (se.key == key) {
+        TranspositionTable::TTEntry old(se.key, se.data);
+        if (data == se.data || ent.getDepth() < old.getDepth())
+            return true;
+    }
+    se.key = key;
+    se.data = data;
+    return false;
+}
+
 void
 ClusterTTReceiver::initBuf() {
-    currBuf->size = sizeof(int);
+    currBuf->ents.clear();
+    currBuf->nBits = TTBatchCodec::headerBits;
     full = false;
-    Serializer::serialize<64>(&currBuf->data[0], cmdType);
 }
 
 bool
-ClusterTTReceiver::sendBuffer(MPI_Request& sendReq) {
-    if (nSendSlots <= 0)
+ClusterTTReceiver::getSendBuffer(const U8*& data, int& count) {
+    if (nInFlight >= sendWindow) {
+        windowLimited = true;
         return false;
+    }
 
     std::lock_guard<std::mutex> L(mutex);
     Buffer* sendBuf = currBuf;
     currBuf = currBuf == &buffer[0] ? &buffer[1] : &buffer[0];
     initBuf();
 
-    int count = sendBuf->size;
-    if (count < SearchConst::MAX_CLUSTER_BUF_SIZE / 2) {
+    const int maxBits = (SearchConst::MAX_CLUSTER_BUF_SIZE - sizeof(int)) * 8;
+    if (sendBuf->nBits < maxBits / 2) {
         if (minDepth > 0)
             minDepth--;
     }
-    if (count == sizeof(int))
+    if (sendBuf->ents.empty())
         return false;
 
-    MPI_Isend(&sendBuf->data[0], count, MPI_BYTE, peerRank, 0, MPI_COMM_WORLD, &sendReq);
-    nSendSlots--;
+    U8* buf = Serializer::serialize<64>(&sendBuf->data[0], cmdType);
+    buf = TTBatchCodec::encode(sendBuf->ents, buf);
+    data = &sendBuf->data[0];
+    count = (int)(buf - data);
+    nInFlight++;
+    sendTimes.push_back(currentTime());
     return true;
 }
 
@@ -191,18 +386,39 @@ void
 ClusterTTReceiver::receiveBuffer(const U8* buf, int len) {
     int type;
     buf = Serializer::deSerialize<64>(buf, type);
-    len  = (len - sizeof(int)) / 16;
-    for (int i = 0; i < len; i++) {
-        U64 key, data;
-        buf = Serializer::deSerialize<64>(buf, key, data);
-        ctt.insert(TranspositionTable::TTEntry(key, data));
-    }
+    TTBatchCodec::decode(buf, len - sizeof(int), recvEnts);
+    for (const TranspositionTable::TTEntry& ent : recvEnts)
+        ctt.insert(ent);
     ctt.flush();
 }
 
 void
 ClusterTTReceiver::ttAck(int nAcks) {
-    nSendSlots += nAcks;
+    double now = currentTime();
+    for (int i = 0; i < nAcks && !sendTimes.empty(); i++) {
+        double rtt = now - sendTimes.front();
+        sendTimes.pop_front();
+        avgRtt = minRtt == 1e9 ? rtt : avgRtt * 0.875 + rtt * 0.125;
+        minRtt = std::min(minRtt, rtt);
+    }
+    nInFlight = std::max(nInFlight - nAcks, 0);
+
+    // Slowly forget old minimum so the window can adapt to changed conditions
+    nAcksSinceReset += nAcks;
+    if (nAcksSinceReset >= 1000) {
+        minRtt = avgRtt;
+        nAcksSinceReset = 0;
+    }
+
+    // Grow window while the acknowledgement time does not increase much.
+    // Shrink window when packets start to queue up at the receiver.
+    const double slack = 0.002; // Allow for the receiver's polling interval
+    if (avgRtt > 2 * minRtt + slack) {
+        sendWindow = std::max(sendWindow - 1, minSendWindow);
+    } else if (windowLimited) {
+        sendWindow = std::min(sendWindow + 1, maxSendWindow);
+        windowLimited = false;
+    }
 }
 
 #endif
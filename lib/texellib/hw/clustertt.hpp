@@ -29,8 +29,34 @@
 #include "transpositionTable.hpp"
 
 #include <mutex>
+#include <deque>
+#include <vector>
+
+
+/** Compact encoding of a batch of transposition table entries, used to
+ *  reduce the amount of data sent between cluster nodes.
+ *  The entries are sorted by key. The top 8 bits of each key are delta coded
+ *  in unary and the remaining key bits are stored verbatim. The data fields
+ *  are stored using variable length codes. The generation field is not stored. */
+class TTBatchCodec {
+public:
+    /** Number of bits needed for the batch header. */
+    static const int headerBits = 16 + 255;
+
+    /** Upper bound on the number of bits needed to encode "ent". The encoded
+     *  size of a batch is at most headerBits plus the sum of entryBits(). */
+    static int entryBits(const TranspositionTable::TTEntry& ent);
+
+    /** Encode entries to "buf". The entries are sorted as a side effect.
+     *  @return Pointer to the first byte after the encoded data. */
+    static U8* encode(std::vector<TranspositionTable::TTEntry>& ents, U8* buf);
+
+    /** Decode entries encoded by encode(). */
+    static void decode(const U8* buf, int len, std::vector<TranspositionTable::TTEntry>& ents);
+};
+
+
 #ifdef CLUSTER
-#include <mpi.h>
 
 /** A receiver of transposition table changes. */
 class TTReceiver {
@@ -64,7 +90,8 @@ public:
     void extractPVMoves(const Position& rootPos, const Move& mFirst, std::vector<Move>& pv);
     std::string extractPV(const Position& posIn);
     int getHashFull() const;
-    bool updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis);
+    bool updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis,
+                  std::string& cacheInfo);
 
     const TranspositionTable& getTT() const;
     void insert(const TranspositionTable::TTEntry& ent);
@@ -99,7 +126,7 @@ private:
 /** Forwards transposition table changes to neighboring cluster node. */
 class ClusterTTReceiver : public TTReceiver {
 public:
-    ClusterTTReceiver(int cmdType, int peerRank, ClusterTT& ctt);
+    ClusterTTReceiver(int cmdType, ClusterTT& ctt);
 
     /** Set/clear disabled status. */
     void setDisabled(bool d);
@@ -107,9 +134,10 @@ public:
     /** Add a chunk of changes to the internal buffer. */
     int applyChunk(const ChangeBatch& changes) override;
 
-    /** Initiate a send request if there is any data to send.
-     *  @return True if a send request was initiated, false otherwise. */
-    bool sendBuffer(MPI_Request& sendReq);
+    /** Get a buffer containing data to send, if there is any data to send.
+     *  The buffer remains valid until the next call to this function.
+     *  @return True if data and count were set, false otherwise. */
+    bool getSendBuffer(const U8*& data, int& count);
 
     /** Process received data. */
     void receiveBuffer(const U8* buf, int len);
@@ -120,21 +148,45 @@ public:
 private:
     void initBuf();
 
+    /** Return true if an equivalent or deeper entry for the same position was
+     *  recently sent. Otherwise remember "ent" as sent and return false. */
+    bool recentlySent(const TranspositionTable::TTEntry& ent);
+
     const int cmdType;
-    const int peerRank;
     ClusterTT& ctt;
 
     std::mutex mutex;
     int minDepth = 0;
     bool full = false;
     bool disabled = false;
-    int nSendSlots = 16; // Number of TT data packets allowed to be "in flight"
+
+    struct SentEntry {
+        U64 key = 0;
+        U64 data = 0;
+    };
+    std::vector<SentEntry> sentFilter;
+
+    // Flow control. Adjust the number of TT data packets allowed to be "in flight"
+    // depending on the time it takes for the peer to acknowledge them.
+    static const int minSendWindow = 4;
+    static const int maxSendWindow = 64;
+    int sendWindow = 16;
+    int nInFlight = 0;
+    bool windowLimited = false; // True if a send was delayed because the window was full
+    std::deque<double> sendTimes;
+    double minRtt = 1e9;        // Smallest observed round trip time
+    double avgRtt = 0;          // Moving average of round trip times
+    int nAcksSinceReset = 0;
+
     struct Buffer {
-        int size = 0;
+        int nBits = 0;          // Upper bound on encoded size of ents
+        std::vector<TranspositionTable::TTEntry> ents;
         std::array<U8, SearchConst::MAX_CLUSTER_BUF_SIZE> data;
     };
     Buffer* currBuf;
     Buffer buffer[2];
+
+    std::vector<TranspositionTable::TTEntry> recvEnts;
 };
 
 
@@ -188,8 +240,9 @@ ClusterTT::getHashFull() const {
 }
 
 inline bool
-ClusterTT::updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis) {
-    return tt.updateTB(pos, maxTimeMillis);
+ClusterTT::updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis,
+                    std::string& cacheInfo) {
+    return tt.updateTB(pos, maxTimeMillis, cacheInfo);
 }
 
 inline const TranspositionTable&
@@ -234,8 +287,9 @@ public:
     int getHashFull() const {
         return tt.getHashFull();
     }
-    bool updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis) {
-        return tt.updateTB(pos, maxTimeMillis);
+    bool updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis,
+                  std::string& cacheInfo) {
+        return tt.updateTB(pos, maxTimeMillis, cacheInfo);
     }
     const TranspositionTable& getTT() const {
         return tt;
@@ -34,6 +34,7 @@
 #include "textio.hpp"
 #include "treeLogger.hpp"
 #include "logger.hpp"
+#include "searchProfile.hpp"
 
 #include <cmath>
 #include <cassert>
@@ -555,8 +556,9 @@ ThreadCommunicator::notifyThread() {
 // ----------------------------------------------------------------------------
 
 WorkerThread::WorkerThread(int threadNo, Communicator* parentComm,
-                           int numWorkers, TranspositionTable& tt)
-    : threadNo(threadNo), numWorkers(numWorkers), terminate(false), tt(tt) {
+                           int numThreads, TranspositionTable& tt)
+    : threadNo(threadNo), numThreads(numThreads), newNumThreads(-1),
+      terminate(false), tt(tt) {
     if (parentComm) {
         auto f = [this,parentComm]() {
             mainLoop(parentComm, false);
@@ -574,31 +576,29 @@ WorkerThread::~WorkerThread() {
 }
 
 void
-WorkerThread::createWorkers(int firstThreadNo, Communicator* parentComm,
-                            int numWorkers, TranspositionTable& tt,
+WorkerThread::createWorkers(int parentThreadNo, Communicator* parentComm,
+                            int numThreads, TranspositionTable& tt,
                             std::vector<std::shared_ptr<WorkerThread>>& children) {
-    if (numWorkers <= 0) {
-        children.clear();
-        return;
-    }
-
     const int maxChildren = 4;
-    int numChildren = std::min(numWorkers, maxChildren);
-    std::vector<int> newChildren;
-    children.resize(numChildren);
-    for (int i = 0; i < numChildren; i++) {
-        int n = (numWorkers + numChildren - i - 1) / (numChildren - i);
-        if (!children[i] || children[i]->getThreadNo() != firstThreadNo ||
-                children[i]->getNumWorkers() != n) {
-            children[i] = std::make_shared<WorkerThread>(firstThreadNo, parentComm, n, tt);
-            newChildren.push_back(i);
-        }
-        firstThreadNo += n;
-        numWorkers -= n;
+    const int firstChild = parentThreadNo * maxChildren + 1;
+    int numChildren = clamp(numThreads - firstChild, 0, maxChildren);
+    if ((int)children.size() < numChildren)
+        children.resize(numChildren);
+    for (int i = 0; i < (int)children.size(); i++) {
+        if (!children[i])
+            children[i] = std::make_shared<WorkerThread>(firstChild + i, parentComm, numThreads, tt);
+        else
+            children[i]->setNumThreads(numThreads);
     }
 
-    for (int i : newChildren)
-        children[i]->waitInitialized();
+    for (auto& child : children)
+        child->waitInitialized();
+}
+
+void
+WorkerThread::setNumThreads(int numThreads) {
+    newNumThreads = numThreads;
+    threadNotifier.notify();
 }
 
 void
@@ -615,10 +615,18 @@ WorkerThread::mainLoopCluster(std::unique_ptr<ThreadCommunicator>&& comm) {
 void
 WorkerThread::mainLoop(Communicator* parentComm, bool cluster) {
     Numa::instance().bindThread(threadNo);
+
+    // Allocate search tables in this thread, so the memory is first touched
+    // on the NUMA node this thread is bound to.
+    et = Evaluate::getEvalHashTables();
+    kt = std::make_unique<KillerTable>();
+    ht = std::make_unique<History>();
+
     if (!cluster) {
         comm = std::make_unique<ThreadCommunicator>(parentComm, tt, threadNotifier, threadNo == 0);
         Cluster::instance().connectClusterReceivers(comm.get());
-        createWorkers(threadNo + 1, comm.get(), numWorkers - 1, tt, children);
+        disabled = threadNo >= numThreads;
+        createWorkers(threadNo, comm.get(), numThreads, tt, children);
     } else
         comm->setNotifier(threadNotifier);
 
@@ -631,6 +639,13 @@ WorkerThread::mainLoop(Communicator* parentComm, bool cluster) {
         threadNotifier.wait(handleClusterComm ? 1 : -1);
         if (terminate)
             break;
+        int n = newNumThreads.exchange(-1);
+        if (n >= 0) {
+            numThreads = n;
+            disabled = threadNo >= numThreads;
+            createWorkers(threadNo, comm.get(), numThreads, tt, children);
+            initialized.notify();
+        }
         comm->poll(handler);
         if (comm->hasQuitAck())
             break;
@@ -648,7 +663,7 @@ WorkerThread::CommHandler::assignThreads(int nThreads, int firstThreadNo) {
     Cluster::instance().assignThreads(nThreads, nThreadsThisNode, nThreadsChildren);
     wt.comm->sendAssignThreads(nThreadsThisNode, nThreadsChildren);
     wt.disabled = nThreadsThisNode < 1;
-    WorkerThread::createWorkers(1, wt.comm.get(), nThreadsThisNode - 1, wt.tt, wt.children);
+    WorkerThread::createWorkers(0, wt.comm.get(), nThreadsThisNode, wt.tt, wt.children);
 }
 
 void
@@ -663,7 +678,7 @@ WorkerThread::CommHandler::initSearch(const Position& pos,
     wt.jobId = -1;
 
     wt.logFile = std::make_unique<TreeLogger>();
-    wt.logFile->open("/home/petero/treelog.dmp", wt.threadNo);
+    wt.logFile->open(UciParams::treeLogFile->getStringPar(), wt.threadNo);
     wt.rootNodeIdx = wt.logFile->logPosition(pos);
     if (wt.kt)
         wt.kt->clear();
@@ -731,6 +746,7 @@ WorkerThread::sendReportResult(int jobId, int score) {
 
 void
 WorkerThread::sendReportStats(S64 nodesSearched, S64 tbHits) {
+    Cluster::instance().addLocalNodes(nodesSearched);
     comm->sendReportStats(nodesSearched, tbHits, true);
 }
 
@@ -800,13 +816,6 @@ ThreadStopHandler::reportNodes() {
 
 void
 WorkerThread::doSearch(CommHandler& commHandler) {
-    if (!et)
-        et = Evaluate::getEvalHashTables();
-    if (!kt)
-        kt = std::make_unique<KillerTable>();
-    if (!ht)
-        ht = std::make_unique<History>();
-
     using namespace SearchConst;
     int initExtraDepth = 0;
     for (int extraDepth = initExtraDepth; ; extraDepth++) {
@@ -831,8 +840,10 @@ WorkerThread::doSearch(CommHandler& commHandler) {
         int ply = 1;
         sc.setSearchTreeInfo(ply-1, sti, rootNodeIdx);
         bool inCheck = MoveGen::inCheck(pos);
-        U64 nodeIdx = logFile->peekNextNodeIdx();
+        U64 nodeIdx = logFile->peekNextNodeIdx(rootNodeIdx, ply, sti.currentMoveNo,
+                                               pos.zobristHash());
         try {
+            SEARCH_PROFILE_SCOPE(SEARCH);
             int searchDepth = std::min(depth + extraDepth, MAX_SEARCH_DEPTH);
             int score = sc.search(true, alpha, beta, ply, searchDepth, inCheck);
             sendReportResult(jobId, score);
@@ -332,8 +332,9 @@ private:
 /** Handles communication between search threads. */
 class WorkerThread {
 public:
-    /** Constructor. */
-    WorkerThread(int threadNo, Communicator* parentComm, int numWorkers,
+    /** Constructor. numThreads is the total number of threads in the tree
+     *  this worker belongs to. */
+    WorkerThread(int threadNo, Communicator* parentComm, int numThreads,
                  TranspositionTable& tt);
 
     /** Destructor. Waits for thread to terminate. */
@@ -342,12 +343,15 @@ public:
     WorkerThread(const WorkerThread&) = delete;
     WorkerThread& operator=(const WorkerThread&) = delete;
 
-    /** Create numWorkers WorkerThread objects, arranged in a tree structure.
+    /** Create or update the WorkerThread objects in a tree structure containing
+     *  numThreads threads, where thread t has threads 4t+1 to 4t+4 as children.
      *  parentComm is the Communicator corresponding to the already existing
-     *  root node in that tree structure. The children to the root node are
-     *  returned in the "children" variable. */
-    static void createWorkers(int firstThreadNo, Communicator* parentComm,
-                              int numWorkers, TranspositionTable& tt,
+     *  thread parentThreadNo in that tree structure. The children to that
+     *  thread are returned in the "children" variable. Already existing threads
+     *  are kept, so their search tables and NUMA placement are preserved.
+     *  Threads not needed for numThreads are kept too, but do not search. */
+    static void createWorkers(int parentThreadNo, Communicator* parentComm,
+                              int numThreads, TranspositionTable& tt,
                               std::vector<std::shared_ptr<WorkerThread>>& children);
 
     /** Wait until all child workers have been initialized. */
@@ -362,9 +366,6 @@ public:
     /** Return thread number. The first worker thread is number 1. */
     int getThreadNo() const;
 
-    /** Get number of worker threads in the tree rooted at this worker. */
-    int getNumWorkers() const;
-
     /** Return true if the worker thread should not be searching. */
     bool shouldStop(int jobId) const;
 
@@ -378,6 +379,10 @@ private:
     /** Thread main loop. */
     void mainLoop(Communicator* parentComm, bool cluster);
 
+    /** Tell the thread to update its child threads for a new total number of
+     *  threads. waitInitialized() returns when the update is finished. */
+    void setNumThreads(int numThreads);
+
     class CommHandler : public Communicator::CommandHandler {
     public:
         explicit CommHandler(WorkerThread& wt);
@@ -402,12 +407,13 @@ private:
 
 
     int threadNo;
-    bool disabled = false; // True for not used cluster node
+    bool disabled = false; // True for not used cluster node or thread
     std::unique_ptr<ThreadCommunicator> comm;
     std::unique_ptr<std::thread> thread;
     Notifier threadNotifier;
     std::vector<std::shared_ptr<WorkerThread>> children;
-    const int numWorkers; // Number of worker threads including all child threads
+    int numThreads;       // Total number of threads in the tree
+    std::atomic<int> newNumThreads; // New value for numThreads, or -1 if not changed
 
     Notifier initialized;
     std::atomic<bool> terminate;
@@ -463,10 +469,6 @@ WorkerThread::getThreadNo() const {
     return threadNo;
 }
 
-inline int
-WorkerThread::getNumWorkers() const {
-    return numWorkers;
-}
 
 inline bool
 WorkerThread::shouldStop(int jobId) const {
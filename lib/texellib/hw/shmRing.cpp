@@ -0,0 +1,126 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * shmRing.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "shmRing.hpp"
+
+#ifndef _WIN32
+#include "chessError.hpp"
+
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+SharedMemory::SharedMemory(size_t size)
+    : size(size) {
+    static std::atomic<int> shmNo(0);
+    std::string name = "/texel-" + num2Str(getpid()) + "-" + num2Str(shmNo++);
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+        throw ChessError("Failed to create shared memory");
+    // Unlink immediately so nothing is left in /dev/shm if the program crashes.
+    // The mapping stays valid in this process and in processes forked later.
+    shm_unlink(name.c_str());
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        throw ChessError("Failed to set shared memory size");
+    }
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        throw ChessError("Failed to map shared memory");
+    mem = (U8*)p;
+}
+
+SharedMemory::~SharedMemory() {
+    munmap(mem, size);
+}
+
+// ----------------------------------------------------------------------------
+
+ShmRing::ShmRing(U8* mem, size_t capacity, bool init)
+    : hdr((Header*)mem), buf(mem + sizeof(Header)), mask(capacity - 1) {
+    assert((capacity & mask) == 0);
+    assert(((size_t)mem & 63) == 0);
+    if (init) {
+        new (hdr) Header;
+        hdr->head.store(0, std::memory_order_relaxed);
+        hdr->tail.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool
+ShmRing::put(const U8* data, int len) {
+    const U64 head = hdr->head.load(std::memory_order_relaxed);
+    const size_t need = msgSize(len);
+    const size_t capacity = mask + 1;
+    if (need > capacity - (head - cachedTail)) {
+        cachedTail = hdr->tail.load(std::memory_order_acquire);
+        if (need > capacity - (head - cachedTail))
+            return false;
+    }
+    size_t pos = head & mask;
+    U32 l = len;
+    memcpy(&buf[pos], &l, sizeof(U32));
+    copyIn((pos + sizeof(U32)) & mask, data, len);
+    hdr->head.store(head + need, std::memory_order_release);
+    return true;
+}
+
+int
+ShmRing::get(U8* dst, int maxLen) {
+    const U64 tail = hdr->tail.load(std::memory_order_relaxed);
+    if (tail == cachedHead) {
+        cachedHead = hdr->head.load(std::memory_order_acquire);
+        if (tail == cachedHead)
+            return -1;
+    }
+    size_t pos = tail & mask;
+    U32 len;
+    memcpy(&len, &buf[pos], sizeof(U32));
+    copyOut((pos + sizeof(U32)) & mask, dst, std::min((int)len, maxLen));
+    hdr->tail.store(tail + msgSize(len), std::memory_order_release);
+    return len;
+}
+
+void
+ShmRing::copyIn(size_t pos, const U8* src, size_t len) {
+    size_t n1 = std::min(len, mask + 1 - pos);
+    memcpy(&buf[pos], src, n1);
+    memcpy(&buf[0], src + n1, len - n1);
+}
+
+void
+ShmRing::copyOut(size_t pos, U8* dst, size_t len) const {
+    size_t n1 = std::min(len, mask + 1 - pos);
+    memcpy(dst, &buf[pos], n1);
+    memcpy(dst + n1, &buf[0], len - n1);
+}
+
+#endif
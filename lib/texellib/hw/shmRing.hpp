@@ -0,0 +1,113 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * shmRing.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef SHMRING_HPP_
+#define SHMRING_HPP_
+
+#include "util.hpp"
+
+#include <atomic>
+
+
+/** A block of POSIX shared memory. The memory is inherited by child
+ *  processes created by fork() after the block has been created. */
+class SharedMemory {
+public:
+    /** Create and map a shared memory block of the given size.
+     *  Throws ChessError if the operating system does not allow this. */
+    explicit SharedMemory(size_t size);
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    /** Get pointer to the start of the memory block. */
+    U8* data() const;
+
+private:
+    U8* mem = nullptr;
+    size_t size;
+};
+
+
+/** A single producer, single consumer queue of variable length messages,
+ *  stored in memory that can be shared between processes. */
+class ShmRing {
+public:
+    /** Number of bytes of shared memory needed for a ring that can hold
+     *  "capacity" bytes of message data. capacity must be a power of two. */
+    static size_t memSize(size_t capacity);
+
+    /** Create a ring using memSize(capacity) bytes at "mem", which must be 64 byte
+     *  aligned. The ring is reset to the empty state if "init" is true. */
+    ShmRing(U8* mem, size_t capacity, bool init);
+
+    /** Append a message to the ring. Only called by the producer.
+     *  @return False if there is not enough free space, true otherwise. */
+    bool put(const U8* data, int len);
+
+    /** Remove the oldest message from the ring and store it in "buf".
+     *  Only called by the consumer. Messages longer than maxLen are truncated.
+     *  @return The message length, or -1 if the ring is empty. */
+    int get(U8* buf, int maxLen);
+
+private:
+    /** Number of ring bytes used by a message of length len. */
+    static size_t msgSize(int len);
+
+    void copyIn(size_t pos, const U8* src, size_t len);
+    void copyOut(size_t pos, U8* dst, size_t len) const;
+
+    struct Header {
+        alignas(64) std::atomic<U64> head; // Written by producer
+        alignas(64) std::atomic<U64> tail; // Written by consumer
+    };
+    static_assert(std::atomic<U64>::is_always_lock_free, "Lock free atomics required");
+
+    Header* hdr;
+    U8* buf;
+    const size_t mask;
+    U64 cachedTail = 0; // Producer's copy of hdr->tail
+    U64 cachedHead = 0; // Consumer's copy of hdr->head
+};
+
+
+inline U8*
+SharedMemory::data() const {
+    return mem;
+}
+
+inline size_t
+ShmRing::memSize(size_t capacity) {
+    return sizeof(Header) + capacity;
+}
+
+inline size_t
+ShmRing::msgSize(int len) {
+    return (sizeof(U32) + len + 7) & ~(size_t)7;
+}
+
+#endif /* SHMRING_HPP_ */
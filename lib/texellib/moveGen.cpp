@@ -24,6 +24,7 @@
  */
 
 #include "moveGen.hpp"
+#include "searchProfile.hpp"
 
 //#define MOVELIST_DEBUG
 
@@ -48,6 +49,7 @@ template void MoveGen::pseudoLegalMoves<false>(const Position& pos, MoveList& mo
 template <bool wtm>
 void
 MoveGen::pseudoLegalMoves(const Position& pos, MoveList& moveList) {
+    SEARCH_PROFILE_SCOPE(MOVE_GEN);
     using MyColor = ColorTraits<wtm>;
     const U64 occupied = pos.occupiedBB();
 
@@ -146,6 +148,7 @@ template void MoveGen::checkEvasions<false>(const Position& pos, MoveList& moveL
 template <bool wtm>
 void
 MoveGen::checkEvasions(const Position& pos, MoveList& moveList) {
+    SEARCH_PROFILE_SCOPE(MOVE_GEN);
     using MyColor = ColorTraits<wtm>;
     using OtherColor = ColorTraits<!wtm>;
     const U64 occupied = pos.occupiedBB();
@@ -255,6 +258,7 @@ template void MoveGen::pseudoLegalCapturesAndChecks<false>(const Position& pos,
 template <bool wtm>
 void
 MoveGen::pseudoLegalCapturesAndChecks(const Position& pos, MoveList& moveList) {
+    SEARCH_PROFILE_SCOPE(MOVE_GEN);
     using MyColor = ColorTraits<wtm>;
     const U64 occupied = pos.occupiedBB();
 
@@ -389,6 +393,7 @@ template void MoveGen::pseudoLegalCaptures<false>(const Position& pos, MoveList&
 template <bool wtm>
 void
 MoveGen::pseudoLegalCaptures(const Position& pos, MoveList& moveList) {
+    SEARCH_PROFILE_SCOPE(MOVE_GEN);
     using MyColor = ColorTraits<wtm>;
     const U64 occupied = pos.occupiedBB();
 
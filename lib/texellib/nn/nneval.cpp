@@ -26,6 +26,8 @@
 #include "nneval.hpp"
 #include "vectorop.hpp"
 #include "position.hpp"
+#include "searchStats.hpp"
+#include "searchProfile.hpp"
 #include <cassert>
 
 int NNEvaluator::ptValue[Piece::nPieceTypes];
@@ -202,6 +204,7 @@ NNEvaluator::computeL1WB() {
 
     for (int c = 0; c < 2; c++) {
         if (doFull[c]) {
+            SEARCH_STAT(NN_REFRESH);
             FirstLayerState& s = getLinState(c);
             copyVec(s.l1Out, netData.bias1);
             s.kingSqComputed = posP->getKingSq(c == 0);
@@ -241,9 +244,13 @@ NNEvaluator::computeL1Out() {
 
 int
 NNEvaluator::eval() {
-    computeL1WB();
-    computeL1Out();
+    {
+        SEARCH_PROFILE_SCOPE(NN_ACCUM);
+        computeL1WB();
+        computeL1Out();
+    }
 
+    SEARCH_PROFILE_SCOPE(NN_LAYERS);
     const int nPieces = posP->nPieces();
     int hi = NetData::getHeadNo(nPieces);
 
@@ -71,6 +71,14 @@ namespace UciParams {
     std::shared_ptr<SpinParam> minProbeDepth7dtz(std::make_shared<SpinParam>("MinProbeDepth7dtz", 0, 100, 12));
     std::shared_ptr<SpinParam> max6dtzThreads(std::make_shared<SpinParam>("Max6dtzThreads", 0, maxThreads, maxThreads));
     std::shared_ptr<SpinParam> max7dtzThreads(std::make_shared<SpinParam>("Max7dtzThreads", 0, maxThreads, maxThreads));
+    std::shared_ptr<StringParam> tbGenCachePath(std::make_shared<StringParam>("GeneratedTbPath", ""));
+    std::shared_ptr<SpinParam> tbGenCacheSize(std::make_shared<SpinParam>("GeneratedTbCacheSize", 0, 1024*1024, 256));
+
+    std::shared_ptr<StringParam> treeLogFile(std::make_shared<StringParam>("TreeLogFile", ""));
+    std::shared_ptr<SpinParam> treeLogMaxPly(std::make_shared<SpinParam>("TreeLogMaxPly", 0, 127, 0));
+    std::shared_ptr<SpinParam> treeLogRootMoves(std::make_shared<SpinParam>("TreeLogRootMoves", 0, 256, 0));
+    std::shared_ptr<SpinParam> treeLogSampleBits(std::make_shared<SpinParam>("TreeLogSampleBits", 0, 32, 0));
+    std::shared_ptr<SpinParam> treeLogSamplePly(std::make_shared<SpinParam>("TreeLogSamplePly", 1, 127, 2));
 }
 
 int pieceValue[Piece::nPieceTypes];
@@ -165,6 +173,14 @@ Parameters::Parameters() {
     addPar(UciParams::minProbeDepth7dtz);
     addPar(UciParams::max6dtzThreads);
     addPar(UciParams::max7dtzThreads);
+    addPar(UciParams::tbGenCachePath);
+    addPar(UciParams::tbGenCacheSize);
+
+    addPar(UciParams::treeLogFile);
+    addPar(UciParams::treeLogMaxPly);
+    addPar(UciParams::treeLogRootMoves);
+    addPar(UciParams::treeLogSampleBits);
+    addPar(UciParams::treeLogSamplePly);
 
     // Evaluation parameters
     REGISTER_PARAM(pV, "PawnValue");
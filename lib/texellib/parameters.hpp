@@ -379,6 +379,14 @@ namespace UciParams {
     extern std::shared_ptr<Parameters::SpinParam> minProbeDepth7dtz; // Min probe depth for 7-men DTZ
     extern std::shared_ptr<Parameters::SpinParam> max6dtzThreads;    // No of threads that can probe 6-men DTZ
     extern std::shared_ptr<Parameters::SpinParam> max7dtzThreads;    // No of threads that can probe 7-men DTZ
+    extern std::shared_ptr<Parameters::StringParam> tbGenCachePath;  // Directory for generated TBs
+    extern std::shared_ptr<Parameters::SpinParam> tbGenCacheSize;    // Max size in MB of generated TB directory
+
+    extern std::shared_ptr<Parameters::StringParam> treeLogFile;     // Search tree log file, empty to disable
+    extern std::shared_ptr<Parameters::SpinParam> treeLogMaxPly;     // Only log plies < this value, 0 for all
+    extern std::shared_ptr<Parameters::SpinParam> treeLogRootMoves;  // Only log first N root moves, 0 for all
+    extern std::shared_ptr<Parameters::SpinParam> treeLogSampleBits; // Log 1/2^k of subtrees at treeLogSamplePly
+    extern std::shared_ptr<Parameters::SpinParam> treeLogSamplePly;
 }
 
 // ----------------------------------------------------------------------------
@@ -28,6 +28,7 @@
 #include "textio.hpp"
 #include "parameters.hpp"
 #include "nneval.hpp"
+#include "searchProfile.hpp"
 
 #include <iostream>
 #include <cassert>
@@ -35,8 +36,8 @@
 const U64 hashEmpty = 0x5fd230cc43568439ULL;
 
 SqTbl<U8> Position::castleSqMask;
-
-static StaticInitializer<Position> posInit;
+U64 Position::cuckooKeys[cuckooSize];
+Move Position::cuckooMoves[cuckooSize];
 
 void
 Position::staticInitialize() {
@@ -49,6 +50,50 @@ Position::staticInitialize() {
     castleSqMask[A8] &= ~(1 << A8_CASTLE);
     castleSqMask[E8] &= ~((1 << A8_CASTLE) | (1 << H8_CASTLE));
     castleSqMask[H8] &= ~(1 << H8_CASTLE);
+
+    // Cuckoo tables for all non-pawn moves on an empty board. Move geometry is
+    // computed directly, since the BitBoard tables may not be initialized yet.
+    for (int i = 0; i < cuckooSize; i++) {
+        cuckooKeys[i] = 0;
+        cuckooMoves[i] = Move();
+    }
+    auto canMove = [](int pType, Square from, Square to) -> bool {
+        int dx = std::abs(from.getX() - to.getX());
+        int dy = std::abs(from.getY() - to.getY());
+        switch (pType) {
+        case Piece::WKING:   return std::max(dx, dy) == 1;
+        case Piece::WQUEEN:  return dx == 0 || dy == 0 || dx == dy;
+        case Piece::WROOK:   return dx == 0 || dy == 0;
+        case Piece::WBISHOP: return dx == dy;
+        case Piece::WKNIGHT: return dx * dy == 2;
+        default:             return false;
+        }
+    };
+    int nMoves = 0;
+    for (int p = Piece::WKING; p <= Piece::BKNIGHT; p++) {
+        if (p == Piece::WPAWN || p == Piece::BPAWN)
+            continue;
+        int wType = Piece::makeWhite(p);
+        for (int s1 = 0; s1 < 64; s1++) {
+            for (int s2 = s1 + 1; s2 < 64; s2++) {
+                Square from(s1), to(s2);
+                if (!canMove(wType, from, to))
+                    continue;
+                Move m(from, to, Piece::EMPTY);
+                U64 key = psHashKeys[p][from] ^ psHashKeys[p][to] ^ whiteHashKey;
+                int idx = cuckooHash1(key);
+                while (true) {
+                    std::swap(cuckooKeys[idx], key);
+                    std::swap(cuckooMoves[idx], m);
+                    if (key == 0)
+                        break;
+                    idx = (idx == cuckooHash1(key)) ? cuckooHash2(key) : cuckooHash1(key);
+                }
+                nMoves++;
+            }
+        }
+    }
+    assert(nMoves == 3668);
 }
 
 Position::Position() {
@@ -229,6 +274,7 @@ Position::hashAfterMove(const Move& move) const {
 
 void
 Position::makeMove(const Move& move, UndoInfo& ui) {
+    SEARCH_PROFILE_SCOPE(MAKE_MOVE);
     ui.capturedPiece = getPiece(move.to());
     ui.castleMask = castleMask;
     ui.epSquare = epSquare;
@@ -299,6 +345,7 @@ Position::makeMove(const Move& move, UndoInfo& ui) {
 
 void
 Position::unMakeMove(const Move& move, const UndoInfo& ui) {
+    SEARCH_PROFILE_SCOPE(UNMAKE_MOVE);
     NNEvaluator* origNnEval = nnEval;
     nnEval = nullptr;
 
@@ -792,3 +839,6 @@ const U64 Position::moveCntKeys[101] = {
     0xce22f3b15bbca65dULL, 0xff839edc88ee6833ULL, 0x9b944c8fbaffbe94ULL, 0x4dcf12e95dbf59d8ULL,
     0xd4e8006c8265fa6dULL
 };
+
+// Must come after the hash key tables, which are used by staticInitialize().
+static StaticInitializer<Position> posInit;
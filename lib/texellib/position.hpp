@@ -235,6 +235,11 @@ public:
     /** Get hash key for a piece at a square. */
     static U64 getHashKey(int piece, Square square);
 
+    /** If "moveKey" is the Zobrist hash difference between two positions that
+     *  differ by one non-pawn move between two squares, store the move in "m"
+     *  and return true. The direction of the move is not known. */
+    static bool getCuckooMove(U64 moveKey, Move& m);
+
 
     /** Serialization. Used by tree logging code. */
     struct SerializeData {
@@ -262,6 +267,14 @@ private:
     const static U64 castleHashKeys[16];   // [castleMask]
     const static U64 epHashKeys[9];        // [epFile + 1] (epFile==-1 for no ep)
     const static U64 moveCntKeys[101];     // [min(halfMoveClock, 100)]
+
+    /** Cuckoo hash tables of all reversible non-pawn moves, indexed by the
+     *  Zobrist hash difference the move causes. */
+    static const int cuckooSize = 8192;
+    static U64 cuckooKeys[cuckooSize];
+    static Move cuckooMoves[cuckooSize];
+    static int cuckooHash1(U64 key) { return key & (cuckooSize - 1); }
+    static int cuckooHash2(U64 key) { return (key >> 16) & (cuckooSize - 1); }
 };
 
 /** For debugging. */
@@ -625,4 +638,16 @@ inline U64 Position::getHashKey(int piece, Square square) {
     return psHashKeys[piece][square];
 }
 
+inline bool
+Position::getCuckooMove(U64 moveKey, Move& m) {
+    int idx = cuckooHash1(moveKey);
+    if (cuckooKeys[idx] != moveKey) {
+        idx = cuckooHash2(moveKey);
+        if (cuckooKeys[idx] != moveKey)
+            return false;
+    }
+    m = cuckooMoves[idx];
+    return true;
+}
+
 #endif /* POSITION_HPP_ */
@@ -32,6 +32,8 @@
 #include "tbprobe.hpp"
 #include "treeLogger.hpp"
 #include "searchTreeSampler.hpp"
+#include "searchStats.hpp"
+#include "searchProfile.hpp"
 #include "textio.hpp"
 #include "logger.hpp"
 #include "random.hpp"
@@ -111,6 +113,7 @@ Search::iterativeDeepening(const MoveList& scMovesIn,
                            int maxDepth, S64 initialMaxNodes,
                            int maxPV, bool onlyExact,
                            int minProbeDepth, bool clearHistory) {
+    SEARCH_PROFILE_SCOPE(SEARCH);
     if (tStart == -1)
         tStart = currentTimeMillis();
     totalNodes = 0;
@@ -119,17 +122,22 @@ Search::iterativeDeepening(const MoveList& scMovesIn,
     if (scMovesIn.size <= 0)
         return Move(); // No moves to search
 
-    logFile.open("/home/petero/treelog.dmp", threadNo);
+    logFile.open(UciParams::treeLogFile->getStringPar(), threadNo);
     const U64 rootNodeIdx = logFile.logPosition(pos);
 
     kt.clear();
     maxNodes = initialMaxNodes;
     this->minProbeDepth = TBProbe::tbEnabled() ? minProbeDepth : MAX_SEARCH_DEPTH;
-    if ((maxDepth < 0) && (maxNodes < 0) && !TBProbe::tbEnabled())
-        if (tt.updateTB(pos, maxTimeMillis))
+    if ((maxDepth < 0) && (maxNodes < 0) && !TBProbe::tbEnabled()) {
+        std::string tbCacheInfo;
+        if (tt.updateTB(pos, maxTimeMillis, tbCacheInfo))
             this->minProbeDepth = 1; // In-memory on-demand tables can be probed aggressively
+        if (listener && !tbCacheInfo.empty())
+            listener->notifyInfoString(tbCacheInfo);
+    }
     std::vector<MoveInfo> rootMoves;
     getRootMoves(scMovesIn, rootMoves, maxDepth);
+    const int prevPly = usePrevSearch(rootMoves);
 
     Position origPos(pos);
     bool firstIteration = true;
@@ -295,7 +303,7 @@ Search::iterativeDeepening(const MoveList& scMovesIn,
         }
         if (enoughDepth)
             break;
-        if (firstIteration) {
+        if (firstIteration && (prevPly != 0)) {
             std::stable_sort(rootMoves.begin()+maxPV, rootMoves.end(), MoveInfo::SortByScore());
         } else {
             // Moves that were hard to search should be searched early in the next iteration
@@ -305,6 +313,7 @@ Search::iterativeDeepening(const MoveList& scMovesIn,
     } catch (const StopSearch&) {
         pos = origPos;
     }
+    storePrevSearch(rootMoves);
     notifyStats();
 
     logFile.close();
@@ -325,7 +334,7 @@ Search::searchRoot(bool tb, int alpha, int beta, int ply, int depth,
     SearchTreeInfo sti = searchTreeInfo[ply-1];
     jobId++;
     comm.sendStartSearch(jobId, sti, alpha, beta, depth);
-    U64 nodeIdx = logFile.peekNextNodeIdx();
+    U64 nodeIdx = logFile.peekNextNodeIdx(sti.nodeIdx, ply, sti.currentMoveNo, pos.zobristHash());
     Position pos0(pos);
     int posHashListSize0 = posHashListSize;
     try {
@@ -474,6 +483,8 @@ Search::shouldStop() {
 template <bool tb>
 int
 Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
+    SEARCH_STAT(SEARCH_NODES);
+
     // Mate distance pruning
     beta = std::min(beta, MATE0-ply-1);
     if (alpha >= beta)
@@ -481,7 +492,8 @@ Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
 
     if (logFile.isOpened()) {
         const SearchTreeInfo& sti = searchTreeInfo[ply-1];
-        U64 idx = logFile.logNodeStart(sti.nodeIdx, sti.currentMove, alpha, beta, ply, depth);
+        U64 idx = logFile.logNodeStart(sti.nodeIdx, sti.currentMove, sti.currentMoveNo,
+                                       alpha, beta, ply, depth, pos.zobristHash());
         searchTreeInfo[ply].nodeIdx = idx;
     }
     if (nodesToGo <= 0) {
@@ -532,18 +544,29 @@ Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
         // discovered the first time the position came up.
         return logAndReturn(0, TType::T_EXACT);
     }
+    if ((alpha < 0) && canReachDrawRep(pos, posHashList, posHashListSize, posHashFirstNew)) {
+        SEARCH_STAT(UPCOMING_REP);
+        alpha = 0;
+        if (alpha >= beta)
+            return logAndReturn(alpha, TType::T_GE);
+    }
 
     // Check transposition table
     TranspositionTable::TTEntry ent;
     const bool singularSearch = !sti.singularMove.isEmpty();
     const bool useTT = !singularSearch;
-    if (useTT) tt.probe(hKey, ent);
+    if (useTT) {
+        tt.probe(hKey, ent);
+        SEARCH_STAT(TT_PROBE);
+    }
     Move hashMove;
     if (ent.getType() != TType::T_EMPTY) {
+        SEARCH_STAT(TT_HIT);
         int score = ent.getScore(ply);
         evalScore = ent.getEvalScore();
         ent.getMove(hashMove);
         if (((beta == alpha + 1) || (depth*2 <= ply)) && ent.isCutOff(alpha, beta, ply, depth)) {
+            SEARCH_STAT(TT_CUTOFF);
             if (score >= beta && !hashMove.isEmpty())
                 if (pos.getPiece(hashMove.to()) == Piece::EMPTY)
                     kt.addKiller(ply, hashMove);
@@ -701,6 +724,7 @@ Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
                 nullOk = false;
         }
         if (nullOk) {
+            SEARCH_STAT(NULL_MOVE);
             int score;
             {
                 pos.setWhiteMove(!pos.isWhiteMove());
@@ -737,6 +761,7 @@ Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
                 sti3.bestMove.setMove(A1,A1,0,0);
             }
             if (score >= beta) {
+                SEARCH_STAT(NULL_MOVE_CUTOFF);
                 if (isWinScore(score))
                     score = beta;
                 return logAndReturn(score, TType::T_GE);
@@ -815,6 +840,7 @@ Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
         sti2.nodeIdx = sti.nodeIdx;
         const S64 savedNodeIdx = sti.nodeIdx;
         sti.singularMove = hashMove;
+        SEARCH_STAT(SINGULAR_TEST);
         int newDepth = depth / 2;
         int newBeta = ent.getScore(ply) - depth;
         int singScore = search(tb, newBeta-1, newBeta, ply, newDepth, inCheck);
@@ -823,8 +849,10 @@ Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
         sti2.currentMove = savedMove;
         sti2.currentMoveNo = savedMoveNo;
         sti2.nodeIdx = savedNodeIdx2;
-        if (singScore <= newBeta-1)
+        if (singScore <= newBeta-1) {
             singularExtend = true;
+            SEARCH_STAT(SINGULAR_EXT);
+        }
         else if (newBeta >= beta)
             return logAndReturn(newBeta, TType::T_GE);
     }
@@ -951,6 +979,8 @@ Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
                 sti.currentMoveNo = mi;
 
                 searchTreeInfo[ply+1].abdadaExclusive = pass == 0 && haveLegalMoves;
+                if (lmr > 0)
+                    SEARCH_STAT(LMR);
                 score = -search(tb, -b, -alpha, ply + 1, newDepth, givesCheck);
                 searchTreeInfo[ply+1].abdadaExclusive = false;
 
@@ -963,6 +993,8 @@ Search::search(int alpha, int beta, int ply, int depth, const bool inCheck) {
                 }
                 if (((lmr > 0) && (score > alpha)) ||
                         ((score > alpha) && (score < beta) && (b != beta))) {
+                    if (lmr > 0)
+                        SEARCH_STAT(LMR_RESEARCH);
                     newDepth += lmr;
                     score = -search(tb, -beta, -alpha, ply + 1, newDepth, givesCheck);
                 }
@@ -1091,6 +1123,58 @@ Search::getRootMoves(const MoveList& rootMovesIn,
     }
 }
 
+int
+Search::usePrevSearch(std::vector<MoveInfo>& rootMoves) {
+    if (!prevSearch)
+        return -1;
+    const std::vector<Move>& pv = prevSearch->pv;
+    const U64 key = pos.zobristHash();
+    for (int ply = 0; ply < (int)pv.size(); ply += 2) {
+        if (prevSearch->pvHashes[ply] != key)
+            continue;
+        if (ply == 0) {
+            int dst = 0;
+            for (const Move& m : prevSearch->rootMoves) {
+                for (int mi = dst; mi < (int)rootMoves.size(); mi++) {
+                    if (rootMoves[mi].move == m) {
+                        std::rotate(rootMoves.begin() + dst, rootMoves.begin() + mi,
+                                    rootMoves.begin() + mi + 1);
+                        dst++;
+                        break;
+                    }
+                }
+            }
+        }
+        for (int mi = 0; mi < (int)rootMoves.size(); mi++) {
+            if (rootMoves[mi].move == pv[ply]) {
+                std::rotate(rootMoves.begin(), rootMoves.begin() + mi,
+                            rootMoves.begin() + mi + 1);
+                return ply;
+            }
+        }
+        return -1;
+    }
+    return -1;
+}
+
+void
+Search::storePrevSearch(const std::vector<MoveInfo>& rootMoves) {
+    if (!prevSearch)
+        return;
+    prevSearch->clear();
+    if (rootMoves[0].depth <= 0)
+        return;
+    prevSearch->pv = rootMoves[0].pv;
+    Position tmpPos(pos);
+    UndoInfo ui;
+    for (const Move& m : prevSearch->pv) {
+        prevSearch->pvHashes.push_back(tmpPos.zobristHash());
+        tmpPos.makeMove(m, ui);
+    }
+    for (const MoveInfo& mi : rootMoves)
+        prevSearch->rootMoves.push_back(mi.move);
+}
+
 bool
 Search::weakPlaySkipMove(const Position& pos, const Move& m, int ply) const {
     U64 rndL = pos.zobristHash() ^ hashU64(m.getCompressedMove()) ^ randomSeed;
@@ -1164,6 +1248,7 @@ Search::defenseMove(const Position& pos, const Move& m) {
 
 int
 Search::quiesce(int alpha, int beta, int ply, int depth, const bool inCheck) {
+    SEARCH_STAT(QSEARCH_NODES);
     int score;
     if (inCheck) {
         score = -(MATE0 - (ply+1));
@@ -1402,6 +1487,8 @@ Search::quiescePos(int alpha, int beta, int ply, int depth, const bool inCheck)
 
 int
 Search::SEE(Position& pos, const Move& m, int alpha, int beta) {
+    SEARCH_STAT(SEE);
+    SEARCH_PROFILE_SCOPE(SEE);
     int captures[64];   // Value of captured pieces
     const int kV = ::kV;
 
@@ -1512,6 +1599,98 @@ Search::SEE(Position& pos, const Move& m, int alpha, int beta) {
     return captures[0] - score;
 }
 
+bool
+Search::seeGE(const Position& pos, const Move& m, int threshold) {
+    SEARCH_STAT(SEE);
+    SEARCH_PROFILE_SCOPE(SEE);
+    const Square square = m.to();
+    const int p = pos.getPiece(m.from());
+    U64 occupied = pos.occupiedBB() & ~(1ULL << m.from().asInt());
+
+    int captured;
+    if (square == pos.getEpSquare()) {
+        captured = ::pV;
+        if (p == Piece::WPAWN)
+            occupied &= ~(1ULL << (square - 8).asInt());
+        else if (p == Piece::BPAWN)
+            occupied &= ~(1ULL << (square + 8).asInt());
+    } else {
+        captured = ::pieceValue[pos.getPiece(square)];
+    }
+
+    // "swap" is the gain relative to the threshold for the side to capture next,
+    // if it captures and the exchange then ends.
+    int swap = captured - threshold;
+    if (swap < 0)
+        return false;
+    swap = ::pieceValue[p] - swap;
+    if (swap <= 0)
+        return true;
+
+    const U64 bishopsQueens = pos.pieceTypeBB(Piece::WBISHOP, Piece::BBISHOP,
+                                              Piece::WQUEEN, Piece::BQUEEN);
+    const U64 rooksQueens = pos.pieceTypeBB(Piece::WROOK, Piece::BROOK,
+                                            Piece::WQUEEN, Piece::BQUEEN);
+    U64 attackers = (BitBoard::bPawnAttacks(square) & pos.pieceTypeBB(Piece::WPAWN)) |
+                    (BitBoard::wPawnAttacks(square) & pos.pieceTypeBB(Piece::BPAWN)) |
+                    (BitBoard::knightAttacks(square) & pos.pieceTypeBB(Piece::WKNIGHT, Piece::BKNIGHT)) |
+                    (BitBoard::kingAttacks(square) & pos.pieceTypeBB(Piece::WKING, Piece::BKING)) |
+                    (BitBoard::bishopAttacks(square, occupied) & bishopsQueens) |
+                    (BitBoard::rookAttacks(square, occupied) & rooksQueens);
+    bool white = pos.isWhiteMove();
+    if (p == (white ? Piece::WKING : Piece::BKING)) {
+        // Capturing the king ends the exchange
+        bool lost = (attackers & occupied & pos.colorBB(!white)) != 0;
+        return captured - (lost ? (int)::kV : 0) >= threshold;
+    }
+    int res = 1; // 1 if the side making move m wins the exchange
+    while (true) {
+        white = !white;
+        attackers &= occupied;
+        U64 stmAttackers = attackers & pos.colorBB(white);
+        if (stmAttackers == 0)
+            break;
+        res ^= 1;
+
+        // Capture with the least valuable attacker. Removing it from "occupied"
+        // may uncover x-ray attackers behind it.
+        U64 atk;
+        if ((atk = stmAttackers & pos.pieceTypeBB(Piece::WPAWN, Piece::BPAWN)) != 0) {
+            if ((swap = ::pV - swap) < res)
+                break;
+            occupied &= ~(atk & -atk);
+            attackers |= BitBoard::bishopAttacks(square, occupied) & bishopsQueens;
+        } else if ((atk = stmAttackers & pos.pieceTypeBB(Piece::WKNIGHT, Piece::BKNIGHT)) != 0) {
+            if ((swap = ::nV - swap) < res)
+                break;
+            occupied &= ~(atk & -atk);
+        } else if ((atk = stmAttackers & pos.pieceTypeBB(Piece::WBISHOP, Piece::BBISHOP)) != 0) {
+            if ((swap = ::bV - swap) < res)
+                break;
+            occupied &= ~(atk & -atk);
+            attackers |= BitBoard::bishopAttacks(square, occupied) & bishopsQueens;
+        } else if ((atk = stmAttackers & pos.pieceTypeBB(Piece::WROOK, Piece::BROOK)) != 0) {
+            if ((swap = ::rV - swap) < res)
+                break;
+            occupied &= ~(atk & -atk);
+            attackers |= BitBoard::rookAttacks(square, occupied) & rooksQueens;
+        } else if ((atk = stmAttackers & pos.pieceTypeBB(Piece::WQUEEN, Piece::BQUEEN)) != 0) {
+            if ((swap = ::qV - swap) < res)
+                break;
+            occupied &= ~(atk & -atk);
+            attackers |= (BitBoard::bishopAttacks(square, occupied) & bishopsQueens) |
+                         (BitBoard::rookAttacks(square, occupied) & rooksQueens);
+        } else {
+            // King capture is only possible if the opponent has no attackers left
+            occupied &= ~stmAttackers;
+            attackers |= (BitBoard::bishopAttacks(square, occupied) & bishopsQueens) |
+                         (BitBoard::rookAttacks(square, occupied) & rooksQueens);
+            return (attackers & occupied & pos.colorBB(!white)) ? res ^ 1 : res;
+        }
+    }
+    return res;
+}
+
 void
 Search::scoreMoveList(MoveList& moves, int ply, int startIdx) {
     Move cm;
@@ -87,6 +87,7 @@ public:
                               const std::vector<Move>& pv, int multiPVIndex,
                               S64 tbHits) = 0;
         virtual void notifyStats(S64 nodes, S64 nps, int hashFull, S64 tbHits, S64 time) = 0;
+        virtual void notifyInfoString(const std::string& str) = 0;
     };
 
     void setListener(Listener& listener);
@@ -114,6 +115,19 @@ public:
     /** Set minimum depth for TB probes. */
     void setMinProbeDepth(int depth);
 
+    /** Information about a finished search, used to initialize the next search
+     *  if it starts in a position on the predicted line. */
+    struct PrevSearchInfo {
+        std::vector<Move> pv;        // Principal variation of the best move
+        std::vector<U64> pvHashes;   // pvHashes[i] is the position hash before pv[i]
+        std::vector<Move> rootMoves; // Root moves in the order of the last iteration
+
+        void clear();
+    };
+
+    /** Set object used to pass information from one search to the next. */
+    void setPrevSearchInfo(PrevSearchInfo* psi);
+
     Move iterativeDeepening(const MoveList& scMovesIn,
                             int maxDepth, S64 initialMaxNodes,
                             int maxPV = 1, bool onlyExact = false,
@@ -133,6 +147,11 @@ public:
     static bool canClaimDrawRep(const Position& pos, const std::vector<U64>& posHashList,
                                 int posHashListSize, int posHashFirstNew);
 
+    /** Return true if the side to move can make a reversible move that repeats
+     *  a position occurring earlier in the search tree. */
+    static bool canReachDrawRep(const Position& pos, const std::vector<U64>& posHashList,
+                                int posHashListSize, int posHashFirstNew);
+
     /**
      * Compute scores for each move in a move list, using SEE, killer and history information.
      * @param moves  List of moves to score.
@@ -154,6 +173,13 @@ public:
      */
     static int SEE(Position& pos, const Move& m, int alpha, int beta);
 
+    /**
+     * Static exchange evaluation threshold test.
+     * @return True if SEE(pos, m, -inf, inf) >= threshold. "pos" is not modified
+     *         and no swap list is constructed.
+     */
+    static bool seeGE(const Position& pos, const Move& m, int threshold);
+
     /** Return the quiescence search score and corresponding position. */
     std::pair<int,Position::SerializeData>
     quiescePos(int alpha, int beta, int ply, int depth, const bool inCheck);
@@ -212,6 +238,16 @@ private:
                       std::vector<MoveInfo>& rootMovesOut,
                       int maxDepth);
 
+    /** If the root position is on the PV of the previous search, move the
+     *  predicted best move first. If the root position is the same as in the
+     *  previous search, also use the previous root move order.
+     *  @return Number of PV moves played since the previous search, or -1 if
+     *          the previous search could not be used. */
+    int usePrevSearch(std::vector<MoveInfo>& rootMoves);
+
+    /** Store information about this search for use by the next search. */
+    void storePrevSearch(const std::vector<MoveInfo>& rootMoves);
+
     /** Return true if move should be skipped in order to make engine play weaker. */
     bool weakPlaySkipMove(const Position& pos, const Move& m, int ply) const;
 
@@ -232,6 +268,9 @@ private:
      */
     int SEE(const Move& m, int alpha, int beta);
 
+    /** Return true if SEE(m) >= threshold. */
+    bool seeGE(const Move& m, int threshold) const;
+
     /** Return >0, 0, <0, depending on the sign of SEE(m). */
     int signSEE(const Move& m);
 
@@ -274,6 +313,7 @@ private:
 
     Listener* listener = nullptr;
     std::unique_ptr<StopHandler> stopHandler;
+    PrevSearchInfo* prevSearch = nullptr;
     Move emptyMove;
 
     SearchTreeInfo searchTreeInfo[SearchConst::MAX_SEARCH_DEPTH * 2];
@@ -320,6 +360,18 @@ Search::setStopHandler(std::unique_ptr<StopHandler> stopHandler) {
     this->stopHandler = std::move(stopHandler);
 }
 
+inline void
+Search::setPrevSearchInfo(PrevSearchInfo* psi) {
+    prevSearch = psi;
+}
+
+inline void
+Search::PrevSearchInfo::clear() {
+    pv.clear();
+    pvHashes.clear();
+    rootMoves.clear();
+}
+
 inline bool
 Search::canClaimDrawRep(const Position& pos, const std::vector<U64>& posHashList,
                        int posHashListSize, int posHashFirstNew) {
@@ -335,6 +387,26 @@ Search::canClaimDrawRep(const Position& pos, const std::vector<U64>& posHashList
     return false;
 }
 
+inline bool
+Search::canReachDrawRep(const Position& pos, const std::vector<U64>& posHashList,
+                        int posHashListSize, int posHashFirstNew) {
+    const int end = std::min(pos.getHalfMoveClock(), posHashListSize - posHashFirstNew);
+    const U64 key = pos.zobristHash();
+    for (int i = 3; i <= end; i += 2) {
+        Move m;
+        if (!Position::getCuckooMove(key ^ posHashList[posHashListSize - i], m))
+            continue;
+        if (BitBoard::squaresBetween(m.from(), m.to()) & pos.occupiedBB())
+            continue;
+        int p = pos.getPiece(m.from());
+        if (p == Piece::EMPTY)
+            p = pos.getPiece(m.to());
+        if (Piece::isWhite(p) == pos.isWhiteMove())
+            return true;
+    }
+    return false;
+}
+
 inline bool
 Search::passedPawnPush(const Position& pos, const Move& m) {
     int p = pos.getPiece(m.from());
@@ -368,13 +440,20 @@ Search::SEE(const Move& m, int alpha, int beta) {
     return SEE(pos, m, alpha, beta);
 }
 
+inline bool
+Search::seeGE(const Move& m, int threshold) const {
+    return seeGE(pos, m, threshold);
+}
+
 inline int
 Search::signSEE(const Move& m) {
     int p0 = ::pieceValue[pos.getPiece(m.from())];
     int p1 = ::pieceValue[pos.getPiece(m.to())];
     if (p0 < p1)
         return 1;
-    return SEE(m, -1, 1);
+    if (seeGE(m, 1))
+        return 1;
+    return seeGE(m, 0) ? 0 : -1;
 }
 
 inline bool
@@ -383,7 +462,7 @@ Search::negSEE(const Move& m) {
     int p1 = ::pieceValue[pos.getPiece(m.to())];
     if (p1 >= p0)
         return false;
-    return SEE(m, -1, 0) < 0;
+    return !seeGE(m, 0);
 }
 
 inline void
@@ -0,0 +1,155 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * tbcache.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "tbcache.hpp"
+#include "random.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+TBCache::Stats TBCache::stats;
+
+// File layout: 8 byte magic, 4 byte format version, 4 byte table size,
+// followed by one PositionValue byte per TB index.
+static const char tbcMagic[8] = { 't', 'e', 'x', 'e', 'l', 't', 'b', 'c' };
+static const U32 tbcVersion = 1;
+static const int tbcHeaderSize = 16;
+
+
+bool
+MappedStorage::open(const std::string& fileName, U32 size) {
+    MappedFile f;
+    if (!f.open(fileName) || f.size() != (U64)tbcHeaderSize + size)
+        return false;
+    const U8* p = f.data();
+    U32 version, nPos;
+    std::memcpy(&version, p + 8, sizeof(U32));
+    std::memcpy(&nPos, p + 12, sizeof(U32));
+    if (std::memcmp(p, tbcMagic, sizeof(tbcMagic)) != 0 || version != tbcVersion || nPos != size)
+        return false;
+    file = f;
+    table = p + tbcHeaderSize;
+    tableSize = size;
+    return true;
+}
+
+void
+MappedStorage::close() {
+    file.close();
+    table = nullptr;
+    tableSize = 0;
+}
+
+// --------------------------------------------------------------------------------
+
+std::string
+TBCache::fileName(const PieceCount& pc) {
+    auto pieces = [](int nq, int nr, int nb, int nn) {
+        return "K" + std::string(nq, 'Q') + std::string(nr, 'R') +
+               std::string(nb, 'B') + std::string(nn, 'N');
+    };
+    return pieces(pc.nwq, pc.nwr, pc.nwb, pc.nwn) +
+           pieces(pc.nbq, pc.nbr, pc.nbb, pc.nbn) + ".tbc";
+}
+
+bool
+TBCache::load(const std::string& dir, const PieceCount& pc, MappedStorage& storage) {
+    fs::path path = fs::path(dir) / fileName(pc);
+    TBPosition tbPos(pc);
+    if (!storage.open(path.string(), tbPos.nPositions()))
+        return false;
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec); // Mark as recently used
+    return true;
+}
+
+bool
+TBCache::save(const std::string& dir, const PieceCount& pc,
+              const std::vector<U8>& table, U64 maxBytes) {
+    const U64 fileSize = tbcHeaderSize + table.size();
+    if (fileSize > maxBytes)
+        return false;
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+
+    // Remove least recently used files until the new file fits
+    struct CacheFile {
+        fs::path path;
+        fs::file_time_type time;
+        U64 size;
+    };
+    std::vector<CacheFile> files;
+    U64 totSize = 0;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::path& p = it->path();
+        if (p.extension() != ".tbc" || !it->is_regular_file(ec))
+            continue;
+        CacheFile cf { p, it->last_write_time(ec), it->file_size(ec) };
+        if (ec)
+            continue;
+        totSize += cf.size;
+        files.push_back(cf);
+    }
+    std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) {
+        return a.time < b.time;
+    });
+    for (const CacheFile& cf : files) {
+        if (totSize + fileSize <= maxBytes)
+            break;
+        if (fs::remove(cf.path, ec))
+            totSize -= cf.size;
+    }
+    if (totSize + fileSize > maxBytes)
+        return false;
+
+    // Write to a temporary file and rename it, so that other processes never see
+    // a partially written file
+    fs::path path = fs::path(dir) / fileName(pc);
+    fs::path tmpPath = path;
+    tmpPath += "." + num2Hex(Random().nextU64()) + ".tmp";
+    {
+        std::ofstream os(tmpPath.string(), std::ios_base::out | std::ios_base::binary);
+        U32 nPos = table.size();
+        os.write(tbcMagic, sizeof(tbcMagic));
+        os.write((const char*)&tbcVersion, sizeof(U32));
+        os.write((const char*)&nPos, sizeof(U32));
+        os.write((const char*)table.data(), table.size());
+        if (!os) {
+            os.close();
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+    }
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,109 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * tbcache.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef TBCACHE_HPP_
+#define TBCACHE_HPP_
+
+#include "tbgen.hpp"
+#include "mappedFile.hpp"
+
+#include <string>
+#include <vector>
+
+
+/** TB storage type that uses a read-only memory mapped tablebase file. */
+class MappedStorage {
+public:
+    /** Map a cache file into memory. Return false if the file could not be
+     *  mapped or does not contain a table of the expected size. In that case
+     *  the previously mapped file, if any, is kept. */
+    bool open(const std::string& fileName, U32 size);
+    /** Unmap the file. */
+    void close();
+
+    void resize(U32 size) { assert(size == tableSize); }
+    const PositionValue operator[](U32 idx) const { return PositionValue(table[idx]); }
+
+private:
+    MappedFile file;
+    const U8* table = nullptr;
+    U32 tableSize = 0;
+};
+
+
+/** Handles a directory of tablebases created by TBGenerator, so that a generated
+ *  tablebase can be reused by later searches and by other processes. */
+class TBCache {
+public:
+    /** Tablebase generation and loading statistics. */
+    struct Stats {
+        int nGenerated = 0;  // Number of generated tablebases
+        double genTime = 0;  // Total generation time in seconds
+        int nLoaded = 0;     // Number of tablebases loaded from the cache
+        double loadTime = 0; // Total load time in seconds
+    };
+
+    /** Return the cache file name for a piece configuration, e.g. "KQKR.tbc". */
+    static std::string fileName(const PieceCount& pc);
+
+    /** Map the cached tablebase for "pc" into "storage".
+     *  Return false if the tablebase is not available in the cache. */
+    static bool load(const std::string& dir, const PieceCount& pc, MappedStorage& storage);
+
+    /** Store a generated tablebase in the cache directory. The least recently used
+     *  tablebases are removed as needed to keep the total size below maxBytes. */
+    static bool save(const std::string& dir, const PieceCount& pc,
+                     const std::vector<U8>& table, U64 maxBytes);
+
+    /** Update statistics. */
+    static void addGenTime(double t);
+    static void addLoadTime(double t);
+
+    /** Get current statistics. */
+    static Stats getStats();
+
+private:
+    static Stats stats;
+};
+
+
+inline void
+TBCache::addGenTime(double t) {
+    stats.nGenerated++;
+    stats.genTime += t;
+}
+
+inline void
+TBCache::addLoadTime(double t) {
+    stats.nLoaded++;
+    stats.loadTime += t;
+}
+
+inline TBCache::Stats
+TBCache::getStats() {
+    return stats;
+}
+
+#endif /* TBCACHE_HPP_ */
@@ -24,10 +24,12 @@
  */
 
 #include "tbgen.hpp"
+#include "tbcache.hpp"
 #include "timeUtil.hpp"
 #include "textio.hpp"
 #include "constants.hpp"
 #include "transpositionTable.hpp"
+#include "threadpool.hpp"
 
 
 static StaticInitializer<TBIndex> tbIdxInit;
@@ -476,125 +478,195 @@ TBGenerator<TBStorage>::TBGenerator(TBStorage& storage, const PieceCount& pc)
     table.resize(tbPos.nPositions());
 }
 
+namespace {
+/** Statistics gathered when processing a range of TB indices. */
+struct ChunkStats {
+    int handled = 0;
+    int modified = 0;
+};
+}
+
+/** Call func(beginIdx, endIdx) for consecutive index ranges covering [0,nPos).
+ *  The ranges are multiples of 64 positions, so two ranges never share an element
+ *  in the "mated" bit vectors or a 64-bit word in the TB storage.
+ *  If pool is null, all ranges are processed by the calling thread. */
+template <typename Func>
+static ChunkStats
+forEachChunk(ThreadPool<ChunkStats>* pool, U32 nPos, Func func) {
+    const U32 chunkSize = 1 << 16;
+    ChunkStats sum;
+    auto add = [&sum](const ChunkStats& s) {
+        sum.handled += s.handled;
+        sum.modified += s.modified;
+    };
+    for (U32 b = 0; b < nPos; b += chunkSize) {
+        U32 e = std::min(nPos, b + chunkSize);
+        if (pool)
+            pool->addTask([&func,b,e](int workerNo) { return func(b, e); });
+        else
+            add(func(b, e));
+    }
+    if (pool)
+        pool->getAllResults(add);
+    return sum;
+}
+
 template <typename TBStorage>
 bool
-TBGenerator<TBStorage>::generate(RelaxedShared<S64>& maxTimeMillis, bool verbose) {
+TBGenerator<TBStorage>::generate(RelaxedShared<S64>& maxTimeMillis, bool verbose, int nThreads) {
     double t0 = currentTime();
 
-    TBPosition tbPos(pieceCount);
-    const U32 nPos = tbPos.nPositions();
-    std::vector<U8> newMated, oldMated;
+    const U32 nPos = TBPosition(pieceCount).nPositions();
     size_t bitSize = nPos / 64;
-    newMated.resize(bitSize);
-    oldMated.resize(bitSize);
+    std::vector<std::atomic<U8>> newMated(bitSize), oldMated(bitSize);
+
+    std::unique_ptr<ThreadPool<ChunkStats>> pool;
+    if (nThreads > 1)
+        pool = std::make_unique<ThreadPool<ChunkStats>>(nThreads);
+
+    std::atomic<bool> timeOut(false);
+    auto checkTime = [&]() -> bool {
+        if (timeOut.load(std::memory_order_relaxed))
+            return false;
+        if (maxTimeMillis >= 0 && currentTime() - t0 > 0.3e-3 * maxTimeMillis) {
+            timeOut.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    };
 
     // Classify positions into INVALID, MATE_IN_0 and UNKNOWN
-    PositionValue pv;
-    for (U32 idx = 0; idx < nPos; idx++) {
-        if (((idx & 0xffff) == 0) && (maxTimeMillis >= 0)) {
-            double t = currentTime();
-            if (t - t0 > 0.3e-3 * maxTimeMillis)
-                return false;
-        }
-        tbPos.setIndex(idx);
-        if (!tbPos.indexValid()) {
-            pv.setInvalid();
-        } else if (tbPos.canTakeKing()) {
-            pv.setMateInN(0);
-        } else {
-            pv.setUnknown();
+    forEachChunk(pool.get(), nPos, [&](U32 beginIdx, U32 endIdx) {
+        if (!checkTime())
+            return ChunkStats();
+        TBPosition tbPos(pieceCount);
+        PositionValue pv;
+        for (U32 idx = beginIdx; idx < endIdx; idx++) {
+            tbPos.setIndex(idx);
+            if (!tbPos.indexValid()) {
+                pv.setInvalid();
+            } else if (tbPos.canTakeKing()) {
+                pv.setMateInN(0);
+            } else {
+                pv.setUnknown();
+            }
+            table.store(idx, pv);
         }
-        table.store(idx, pv);
-    }
+        return ChunkStats();
+    });
+    if (timeOut)
+        return false;
 
     // Classify positions into MATED_IN_0, DRAW (stalemate), and REMAINING_N
-    for (U32 idx = 0; idx < nPos; idx++) {
-        if (((idx & 0xffff) == 0) && (maxTimeMillis >= 0)) {
-            double t = currentTime();
-            if (t - t0 > 0.3e-3 * maxTimeMillis)
-                return false;
-        }
-        if (!table[idx].isUnknown())
-            continue;
-        tbPos.setIndex(idx);
-        TbMoveList moves;
-        tbPos.getMoves(moves);
-        int nLegal = 0;
-        for (int m = 0; m < moves.getSize(); m++) {
-            if (m > 0 && moves[m] == moves[m-1])
-                continue; // Skip duplicated moves
-            int idx2 = moves[m];
-            if (!table[idx2].isMateInN(0))
-                nLegal++;
-        }
-        if (nLegal > 0) {
-            pv.setRemaining(nLegal);
-        } else {
-            tbPos.swapSide();
-            int idx2 = tbPos.getIndex();
-            if (table[idx2].isMateInN(0)) {
-                pv.setMatedInN(0);
-                newMated[idx>>6] = 1;
+    forEachChunk(pool.get(), nPos, [&](U32 beginIdx, U32 endIdx) {
+        if (!checkTime())
+            return ChunkStats();
+        TBPosition tbPos(pieceCount);
+        PositionValue pv;
+        for (U32 idx = beginIdx; idx < endIdx; idx++) {
+            if (!table[idx].isUnknown())
+                continue;
+            tbPos.setIndex(idx);
+            TbMoveList moves;
+            tbPos.getMoves(moves);
+            int nLegal = 0;
+            for (int m = 0; m < moves.getSize(); m++) {
+                if (m > 0 && moves[m] == moves[m-1])
+                    continue; // Skip duplicated moves
+                int idx2 = moves[m];
+                if (!table[idx2].isMateInN(0))
+                    nLegal++;
+            }
+            if (nLegal > 0) {
+                pv.setRemaining(nLegal);
             } else {
-                pv.setDraw();
+                tbPos.swapSide();
+                int idx2 = tbPos.getIndex();
+                if (table[idx2].isMateInN(0)) {
+                    pv.setMatedInN(0);
+                    newMated[idx>>6].store(1, std::memory_order_relaxed);
+                } else {
+                    pv.setDraw();
+                }
             }
+            table.store(idx, pv);
         }
-        table.store(idx, pv);
-    }
+        return ChunkStats();
+    });
+    if (timeOut)
+        return false;
 
     double t1 = currentTime();
 
-    // Find all MATE_IN_N and MATED_IN_N positions
+    // Find all MATE_IN_N and MATED_IN_N positions. Positions can be reached from
+    // several index ranges, so all table updates use compareExchange().
     for (int n = 1; ; n++) {
         if (maxTimeMillis == 0)
             return false; // Cancelled by UCI stop command
         double t2 = currentTime();
-        int modified = 0;
-        int handled = 0;
         oldMated.swap(newMated);
-        for (size_t i = 0; i < bitSize; i++) newMated[i] = 0;
-        for (U32 idx = 0; idx < nPos; idx++) {
-            if (((idx & 63) == 0) && !oldMated[idx>>6]) {
-                idx += 63;
-                continue;
-            }
-            if (!table[idx].isMatedInN(n-1))
-                continue;
-            tbPos.setIndex(idx);
-            handled++;
-            TbMoveList lst;
-            tbPos.getUnMoves(lst);
-            for (int m1 = 0; m1 < lst.getSize(); m1++) {
-                if (m1 > 0 && lst[m1] == lst[m1-1])
-                    continue; // Skip duplicated moves
-                int idx2 = lst[m1];
-                tbPos.setIndex(idx2);
-                if (!table[idx2].isComputed()) {
-                    modified++;
-                    pv.setMateInN(n); table.store(idx2, pv);
+        for (size_t i = 0; i < bitSize; i++)
+            newMated[i].store(0, std::memory_order_relaxed);
+        ChunkStats stats = forEachChunk(pool.get(), nPos, [&](U32 beginIdx, U32 endIdx) {
+            ChunkStats s;
+            TBPosition tbPos(pieceCount);
+            PositionValue mateN;
+            mateN.setMateInN(n);
+            for (U32 idx = beginIdx; idx < endIdx; idx++) {
+                if (((idx & 63) == 0) && !oldMated[idx>>6].load(std::memory_order_relaxed)) {
+                    idx += 63;
+                    continue;
+                }
+                if (!table[idx].isMatedInN(n-1))
+                    continue;
+                tbPos.setIndex(idx);
+                s.handled++;
+                TbMoveList lst;
+                tbPos.getUnMoves(lst);
+                for (int m1 = 0; m1 < lst.getSize(); m1++) {
+                    if (m1 > 0 && lst[m1] == lst[m1-1])
+                        continue; // Skip duplicated moves
+                    int idx2 = lst[m1];
+                    PositionValue pv = table[idx2];
+                    bool updated = false;
+                    while (!pv.isComputed()) {
+                        if (table.compareExchange(idx2, pv, mateN)) {
+                            updated = true;
+                            break;
+                        }
+                    }
+                    if (!updated)
+                        continue;
+                    s.modified++;
+                    tbPos.setIndex(idx2);
                     TbMoveList lst2;
                     tbPos.getUnMoves(lst2);
                     for (int m2 = 0; m2 < lst2.getSize(); m2++) {
                         if (m2 > 0 && lst2[m2] == lst2[m2-1])
                             continue; // Skip duplicated moves
                         int idx3 = lst2[m2];
-                        pv = table[idx3];
-                        if (pv.isRemainingN()) {
-                            if (pv.decRemaining()) {
-                                pv.setMatedInN(n);
-                                newMated[idx3>>6] = 1;
+                        PositionValue oldPv = table[idx3];
+                        while (oldPv.isRemainingN()) {
+                            PositionValue newPv = oldPv;
+                            bool mated = newPv.decRemaining();
+                            if (mated)
+                                newPv.setMatedInN(n);
+                            if (table.compareExchange(idx3, oldPv, newPv)) {
+                                if (mated)
+                                    newMated[idx3>>6].store(1, std::memory_order_relaxed);
+                                break;
                             }
-                            table.store(idx3, pv);
                         }
                     }
                 }
             }
-        }
+            return s;
+        });
         double t3 = currentTime();
         if (verbose)
-            std::cout << "n: " << std::setw(2) << n << " handled: " << std::setw(8) << handled
-                      << " modified: " << std::setw(8) << modified << " t: " << (t3 - t2) << std::endl;
-        if (modified == 0)
+            std::cout << "n: " << std::setw(2) << n << " handled: " << std::setw(8) << stats.handled
+                      << " modified: " << std::setw(8) << stats.modified << " t: " << (t3 - t2) << std::endl;
+        if (stats.modified == 0)
             break;
     }
     if (verbose) {
@@ -603,11 +675,14 @@ TBGenerator<TBStorage>::generate(RelaxedShared<S64>& maxTimeMillis, bool verbose
     }
 
     // Remaining positions are DRAW
-    for (U32 idx = 0; idx < nPos; idx++) {
-        if (table[idx].isRemainingN()) {
-            pv.setDraw(); table.store(idx, pv);
-        }
-    }
+    forEachChunk(pool.get(), nPos, [&](U32 beginIdx, U32 endIdx) {
+        PositionValue pv;
+        pv.setDraw();
+        for (U32 idx = beginIdx; idx < endIdx; idx++)
+            if (table[idx].isRemainingN())
+                table.store(idx, pv);
+        return ChunkStats();
+    });
 
     return true;
 }
@@ -636,3 +711,6 @@ TBGenerator<TBStorage>::probeDTM(const Position& pos, int ply, int& score) const
 
 template class TBGenerator<VectorStorage>;
 template class TBGenerator<TTStorage>;
+// MappedStorage is read-only, so it only supports probing
+template TBGenerator<MappedStorage>::TBGenerator(MappedStorage&, const PieceCount&);
+template bool TBGenerator<MappedStorage>::probeDTM(const Position&, int, int&) const;
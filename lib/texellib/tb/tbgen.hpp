@@ -30,6 +30,7 @@
 #include "square.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 
 
@@ -256,11 +257,14 @@ private:
 /** TB storage type that stores data in a private vector. */
 class VectorStorage {
 public:
-    void resize(U32 size) { table.resize(size); }
-    const PositionValue operator[](U32 idx) const { return table[idx]; }
-    void store(U32 idx, PositionValue pv) { table[idx] = pv; }
+    void resize(U32 size) { table = std::vector<std::atomic<U8>>(size); }
+    const PositionValue operator[](U32 idx) const;
+    void store(U32 idx, PositionValue pv);
+    /** Atomically replace the value at idx with "desired" if it is equal to "expected".
+     *  If not equal, set "expected" to the current value and return false. */
+    bool compareExchange(U32 idx, PositionValue& expected, PositionValue desired);
 private:
-    std::vector<PositionValue> table;
+    std::vector<std::atomic<U8>> table;
 };
 
 
@@ -273,8 +277,9 @@ public:
      * rooks, bishops and knights. Pawns are not supported. */
     TBGenerator(TBStorage& storage, const PieceCount& pc);
 
-    /** Generate the tablebase. */
-    bool generate(RelaxedShared<S64>& maxTimeMillis, bool verbose);
+    /** Generate the tablebase, using nThreads threads.
+     * Return false if generation was aborted because maxTimeMillis was exceeded. */
+    bool generate(RelaxedShared<S64>& maxTimeMillis, bool verbose, int nThreads = 1);
 
     /** Probe tablebase.
      * @param pos  The position to probe.
@@ -493,6 +498,26 @@ TBPosition::swapSide() {
 }
 
 
+inline const PositionValue
+VectorStorage::operator[](U32 idx) const {
+    return PositionValue(table[idx].load(std::memory_order_relaxed));
+}
+
+inline void
+VectorStorage::store(U32 idx, PositionValue pv) {
+    table[idx].store((U8)pv.getState(), std::memory_order_relaxed);
+}
+
+inline bool
+VectorStorage::compareExchange(U32 idx, PositionValue& expected, PositionValue desired) {
+    U8 e = (U8)expected.getState();
+    bool ret = table[idx].compare_exchange_strong(e, (U8)desired.getState(),
+                                                  std::memory_order_relaxed);
+    expected = PositionValue(e);
+    return ret;
+}
+
+
 template <typename TBStorage>
 inline int
 TBGenerator<TBStorage>::getValue(TBPosition& tbPos) const {
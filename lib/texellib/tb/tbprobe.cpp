@@ -31,6 +31,7 @@
 #include "moveGen.hpp"
 #include "constants.hpp"
 #include "timeUtil.hpp"
+#include "searchProfile.hpp"
 
 #include <limits>
 #include <unordered_map>
@@ -117,6 +118,7 @@ TBProbe::tbProbe(Position& pos, int ply, int alpha, int beta,
                  const TranspositionTable& tt, TranspositionTable::TTEntry& ent,
                  const int nPieces, bool allowDTZ, bool allowExpensiveDTZ,
                  int& nodesToCheckStop) {
+    SEARCH_PROFILE_SCOPE(TB_PROBE);
     double t0 = currentTime();
 
     auto timeAndReturn = [&](bool ret) {
@@ -451,8 +451,172 @@ TextIO::moveToString(const Position& pos, const Move& move, bool longForm) {
     return ::moveToString(tmpPos, move, longForm, moves);
 }
 
+/** Convert a move in standard algebraic notation to a Move object, without
+ *  generating all legal moves. Candidate from squares are found using bitboard
+ *  attacks from the destination square. Return false if the string could not be
+ *  resolved to exactly one legal move. In that case the general algorithm in
+ *  TextIO::stringToMove must be used. */
+static bool
+sanToMove(Position& pos, const std::string& str, Move& move) {
+    int len = str.length();
+    while (len > 0) {
+        char c = str[len - 1];
+        if ((c == '+') || (c == '#') || (c == '!') || (c == '?'))
+            len--;
+        else
+            break;
+    }
+    if (len < 2)
+        return false;
+
+    const bool wtm = pos.isWhiteMove();
+    auto myPiece = [wtm](Piece::Type white) -> Piece::Type {
+        return wtm ? white : (Piece::Type)(white + Piece::BKING - Piece::WKING);
+    };
+    const U64 occupied = pos.occupiedBB();
+    const bool inCheck = MoveGen::inCheck(pos);
+
+    if ((str[0] == 'O') || (str[0] == '0')) {
+        const char o = str[0];
+        bool kingSide;
+        if ((len == 3) && (str[1] == '-') && (str[2] == o))
+            kingSide = true;
+        else if ((len == 5) && (str[1] == '-') && (str[2] == o) && (str[3] == '-') && (str[4] == o))
+            kingSide = false;
+        else
+            return false;
+        const Square k0(wtm ? E1 : E8);
+        const int castle = kingSide ? (wtm ? Position::H1_CASTLE : Position::H8_CASTLE)
+                                    : (wtm ? Position::A1_CASTLE : Position::A8_CASTLE);
+        const U64 emptySquares = kingSide ? (wtm ? BitBoard::sqMask(F1,G1) : BitBoard::sqMask(F8,G8))
+                                          : (wtm ? BitBoard::sqMask(B1,C1,D1) : BitBoard::sqMask(B8,C8,D8));
+        const int d = kingSide ? 1 : -1;
+        if (inCheck || ((pos.getCastleMask() & (1 << castle)) == 0) ||
+            ((occupied & emptySquares) != 0) ||
+            (pos.getPiece(k0) != myPiece(Piece::WKING)) ||
+            (pos.getPiece(k0 + (kingSide ? 3 : -4)) != myPiece(Piece::WROOK)) ||
+            MoveGen::sqAttacked(pos, k0 + d))
+            return false;
+        Move m(k0, k0 + 2 * d, Piece::EMPTY);
+        if (!MoveGen::isLegal(pos, m, inCheck))
+            return false;
+        move = m;
+        return true;
+    }
+
+    int begin = 0;
+    Piece::Type piece;
+    switch (str[0]) {
+    case 'K': piece = myPiece(Piece::WKING);   begin++; break;
+    case 'Q': piece = myPiece(Piece::WQUEEN);  begin++; break;
+    case 'R': piece = myPiece(Piece::WROOK);   begin++; break;
+    case 'B': piece = myPiece(Piece::WBISHOP); begin++; break;
+    case 'N': piece = myPiece(Piece::WKNIGHT); begin++; break;
+    default:
+        if ((str[0] < 'a') || (str[0] > 'h'))
+            return false;
+        piece = myPiece(Piece::WPAWN);
+        break;
+    }
+    const bool pawn = piece == myPiece(Piece::WPAWN);
+
+    int promPiece = Piece::EMPTY;
+    if (pawn) {
+        switch (str[len - 1]) {
+        case 'Q': promPiece = myPiece(Piece::WQUEEN);  break;
+        case 'R': promPiece = myPiece(Piece::WROOK);   break;
+        case 'B': promPiece = myPiece(Piece::WBISHOP); break;
+        case 'N': promPiece = myPiece(Piece::WKNIGHT); break;
+        }
+        if (promPiece != Piece::EMPTY) {
+            len--;
+            if ((len > 0) && (str[len - 1] == '='))
+                len--;
+        }
+    }
+    if (len - begin < 2)
+        return false;
+
+    const int toX = str[len - 2] - 'a';
+    const int toY = str[len - 1] - '1';
+    if ((toX < 0) || (toX >= 8) || (toY < 0) || (toY >= 8))
+        return false;
+    int fromX = -1, fromY = -1;
+    for (int i = begin; i < len - 2; i++) {
+        char c = str[i];
+        if ((c >= 'a') && (c <= 'h') && (fromX < 0))
+            fromX = c - 'a';
+        else if ((c >= '1') && (c <= '8') && (fromY < 0))
+            fromY = c - '1';
+        else if ((c != 'x') && (c != '-'))
+            return false;
+    }
+
+    const Square toSq(toX, toY);
+    const U64 toMask = 1ULL << toSq.asInt();
+    if ((pos.colorBB(wtm) & toMask) != 0)
+        return false;
+
+    U64 fromMask;
+    switch (piece) {
+    case Piece::WKING: case Piece::BKING:
+        fromMask = BitBoard::kingAttacks(toSq);
+        break;
+    case Piece::WQUEEN: case Piece::BQUEEN:
+        fromMask = BitBoard::rookAttacks(toSq, occupied) | BitBoard::bishopAttacks(toSq, occupied);
+        break;
+    case Piece::WROOK: case Piece::BROOK:
+        fromMask = BitBoard::rookAttacks(toSq, occupied);
+        break;
+    case Piece::WBISHOP: case Piece::BBISHOP:
+        fromMask = BitBoard::bishopAttacks(toSq, occupied);
+        break;
+    case Piece::WKNIGHT: case Piece::BKNIGHT:
+        fromMask = BitBoard::knightAttacks(toSq);
+        break;
+    default: {
+        const bool lastRank = toY == (wtm ? 7 : 0);
+        if ((lastRank != (promPiece != Piece::EMPTY)) || (toY == (wtm ? 0 : 7)))
+            return false;
+        fromMask = 0;
+        if ((pos.colorBB(!wtm) & toMask) != 0 || (toSq == pos.getEpSquare()))
+            fromMask |= wtm ? BitBoard::bPawnAttacks(toSq) : BitBoard::wPawnAttacks(toSq);
+        const int d = wtm ? -8 : 8;
+        if ((occupied & toMask) == 0) {
+            U64 m1 = 1ULL << (toSq + d).asInt();
+            fromMask |= m1;
+            if ((toY == (wtm ? 3 : 4)) && ((occupied & m1) == 0))
+                fromMask |= 1ULL << (toSq + 2 * d).asInt();
+        }
+        break;
+    }
+    }
+    fromMask &= pos.pieceTypeBB(piece);
+
+    int nMatches = 0;
+    while (fromMask != 0) {
+        Square fromSq = BitBoard::extractSquare(fromMask);
+        if (((fromX >= 0) && (fromSq.getX() != fromX)) ||
+            ((fromY >= 0) && (fromSq.getY() != fromY)))
+            continue;
+        Move m(fromSq, toSq, promPiece);
+        if (!MoveGen::isLegal(pos, m, inCheck))
+            continue;
+        if (++nMatches > 1)
+            return false;
+        move = m;
+    }
+    return nMatches == 1;
+}
+
 Move
 TextIO::stringToMove(Position& pos, const std::string& strMoveIn) {
+    {
+        Move move;
+        if (sanToMove(pos, strMoveIn, move))
+            return move;
+    }
+
     std::string strMove;
     for (size_t i = 0; i < strMoveIn.length(); i++) {
         switch (strMoveIn[i]) {
@@ -31,6 +31,7 @@
 #include <mutex>
 #include <vector>
 #include <queue>
+#include <map>
 #include <functional>
 #include <exception>
 
@@ -73,6 +74,18 @@ private:
     std::deque<std::exception_ptr> exceptions;
 };
 
+
+/** Run a streaming "producer -> parallel workers -> ordered consumer" pipeline.
+ *  getTask(task) is called in the calling thread to get the next task, where
+ *  "task" is a std::function<Result(int workerNo)>. getTask() returns false
+ *  when there are no more tasks. The tasks are executed by nThreads worker threads.
+ *  consume(result) is called in the calling thread for each task result, in the
+ *  same order as the tasks were created. At most maxPending tasks are queued,
+ *  running or waiting to be consumed at the same time, so memory usage is bounded
+ *  even if the input is much larger than the available memory. */
+template <typename Result, typename GetTask, typename Consume>
+void orderedPipeline(int nThreads, int maxPending, GetTask getTask, Consume consume);
+
 template <typename Result>
 ThreadPool<Result>::ThreadPool(int nThreads) {
     for (int i = 0; i < nThreads; i++)
@@ -159,4 +172,41 @@ void ThreadPool<Result>::getAllResults(Func func) {
         func(res);
 }
 
+template <typename Result, typename GetTask, typename Consume>
+void orderedPipeline(int nThreads, int maxPending, GetTask getTask, Consume consume) {
+    using IdResult = std::pair<long long, Result>;
+    ThreadPool<IdResult> pool(nThreads);
+    std::map<long long, Result> finished; // Results that can not be consumed yet
+    long long nCreated = 0;
+    long long nConsumed = 0;
+    bool moreTasks = true;
+    while (true) {
+        while (moreTasks && nCreated - nConsumed < maxPending) {
+            std::function<Result(int)> task;
+            if (!getTask(task)) {
+                moreTasks = false;
+                break;
+            }
+            long long id = nCreated++;
+            pool.addTask([task,id](int workerNo) {
+                return IdResult(id, task(workerNo));
+            });
+        }
+        if (nConsumed == nCreated)
+            break;
+
+        IdResult r;
+        pool.getResult(r);
+        finished.emplace(r.first, std::move(r.second));
+        while (true) {
+            auto it = finished.find(nConsumed);
+            if (it == finished.end())
+                break;
+            consume(it->second);
+            finished.erase(it);
+            nConsumed++;
+        }
+    }
+}
+
 #endif
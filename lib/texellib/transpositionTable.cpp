@@ -31,10 +31,12 @@
 #include "alignedAlloc.hpp"
 #include "threadpool.hpp"
 #include "numa.hpp"
+#include "timeUtil.hpp"
 
 #include <iostream>
 #include <iomanip>
 #include <cstring>
+#include <thread>
 
 
 TranspositionTable::TranspositionTable(U64 numEntries)
@@ -43,7 +45,7 @@ TranspositionTable::TranspositionTable(U64 numEntries)
 }
 
 void
-TranspositionTable::reSize(U64 numEntries) {
+TranspositionTable::reSize(U64 numEntries, int nThreads) {
     if (numEntries < 4)
         numEntries = 4;
     numEntries &= ~3;
@@ -66,7 +68,7 @@ TranspositionTable::reSize(U64 numEntries) {
     tableSize = numEntries;
 
     generation = 0;
-    clear();
+    clear(nThreads);
 }
 
 void TranspositionTable::setUsedSize(U64 s) {
@@ -82,19 +84,23 @@ void TranspositionTable::setUsedSize(U64 s) {
 }
 
 void
-TranspositionTable::clear() {
-    setUsedSize(tableSize);
-    tbGen.reset();
+TranspositionTable::clear(int nThreads) {
+    releaseTB();
     notUsedCnt = 0;
 
     if (tableSize > 1024*1024 && (tableSize % 1024) == 0) {
-        int nThreads = 4;
-        int nChunks = 4;
+        // Use one clearing thread per search thread, bound to the same NUMA
+        // node as the search thread, so the table is first touched evenly
+        // on all nodes used by the search.
+        int hwThreads = std::max(1, (int)std::thread::hardware_concurrency());
+        nThreads = std::min(std::max(nThreads, 4), hwThreads);
+        int nChunks = nThreads;
         ThreadPool<int> pool(nThreads);
-        U64 chunkSize = tableSize / nChunks;
-        for (U64 i = 0; i < tableSize; i += chunkSize) {
-            auto task = [this,chunkSize,i](int workerNo) {
-                Numa::instance().bindThread(0);
+        U64 chunkSize = (tableSize / nChunks + 1023) & ~(U64)1023;
+        int chunkNo = 0;
+        for (U64 i = 0; i < tableSize; i += chunkSize, chunkNo++) {
+            auto task = [this,chunkSize,i,chunkNo](int workerNo) {
+                Numa::instance().bindThread(chunkNo);
                 U64 len = std::min(chunkSize, tableSize - i);
                 std::memset((void*)&table[i], 0, len * sizeof(TTEntryStorage));
                 return 0;
@@ -120,11 +126,13 @@ TranspositionTable::setWhiteContempt(int contempt) {
 void
 TranspositionTable::insert(U64 key, const Move& sm, int type, int ply, int depth, int evalScore,
                            bool busy) {
+    SEARCH_PROFILE_SCOPE(TT_STORE);
     key ^= contemptHash;
     if (depth < 0) depth = 0;
     size_t idx0 = getIndex(key);
     TTEntry ent, tmp;
     size_t idx = idx0;
+    const U8 gen = generation;
     for (int i = 0; i < 4; i++) {
         size_t idx1 = idx0 + i;
         tmp.load(table[idx1]);
@@ -135,7 +143,7 @@ TranspositionTable::insert(U64 key, const Move& sm, int type, int ply, int depth
         } else if (i == 0) {
             ent = tmp;
             idx = idx1;
-        } else if (ent.betterThan(tmp, generation)) {
+        } else if (ent.betterThan(tmp, gen)) {
             ent = tmp;
             idx = idx1;
         }
@@ -158,7 +166,7 @@ TranspositionTable::insert(U64 key, const Move& sm, int type, int ply, int depth
         ent.setScore(sm.score(), ply);
         ent.setDepth(depth);
         ent.setBusy(busy);
-        ent.setGeneration((S8)generation);
+        ent.setGeneration((S8)gen);
         ent.setType(type);
         ent.setEvalScore(evalScore);
         ent.store(table[idx]);
@@ -308,33 +316,36 @@ TranspositionTable::getHashFull() const {
 
 // --------------------------------------------------------------------------------
 
+void
+TranspositionTable::setTBGenThreads(int nThreads) {
+    tbGenThreads = std::max(nThreads, 1);
+}
+
+void
+TranspositionTable::setTBCache(const std::string& dir, U64 maxBytes) {
+    tbCacheDir = dir;
+    tbCacheMaxBytes = maxBytes;
+}
+
 bool
-TranspositionTable::updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis) {
+TranspositionTable::updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis,
+                             std::string& cacheInfo) {
+    cacheInfo.clear();
     if (BitBoard::bitCount(pos.occupiedBB()) > 4 ||
         pos.pieceTypeBB(Piece::WPAWN, Piece::BPAWN)) { // pos not suitable for TB generation
-        if (tbGen && notUsedCnt++ > 3) {
-            tbGen.reset();
-            setUsedSize(tableSize);
+        if ((tbGen || tbGenMapped) && notUsedCnt++ > 3) {
+            releaseTB();
             notUsedCnt = 0;
         }
-        return tbGen != nullptr;
+        return tbGen || tbGenMapped;
     }
 
     int score;
-    if (tbGen && tbGen->probeDTM(pos, 0, score)) {
+    if (probeDTM(pos, 0, score)) {
         notUsedCnt = 0;
         return true; // pos already in TB
     }
 
-    static S64 requiredTime = 3000;
-    if (maxTimeMillis >= 0 && maxTimeMillis < requiredTime)
-        return false; // Not enough time to generate TB
-
-    U64 ttSize = tableSize * sizeof(TTEntryStorage);
-    const int tbSize = 5 * 1024 * 1024; // Max TB size, 10*64^3*2
-    if (ttSize < tbSize + 2 * 1024 * 1024)
-        return false;
-
     PieceCount pc;
     pc.nwq = BitBoard::bitCount(pos.pieceTypeBB(Piece::WQUEEN));
     pc.nwr = BitBoard::bitCount(pos.pieceTypeBB(Piece::WROOK));
@@ -345,8 +356,47 @@ TranspositionTable::updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMil
     pc.nbb = BitBoard::bitCount(pos.pieceTypeBB(Piece::BBISHOP));
     pc.nbn = BitBoard::bitCount(pos.pieceTypeBB(Piece::BKNIGHT));
 
+    auto setCacheInfo = [&pc,&cacheInfo](const char* action, double t) {
+        TBCache::Stats stats = TBCache::getStats();
+        std::stringstream ss;
+        ss << "tbcache " << TBCache::fileName(pc) << ' ' << action
+           << " t:" << t
+           << " generated:" << stats.nGenerated << " t:" << stats.genTime
+           << " loaded:" << stats.nLoaded << " t:" << stats.loadTime;
+        cacheInfo = ss.str();
+    };
+    if (!tbCacheDir.empty()) {
+        double t0 = currentTime();
+        MappedStorage ms;
+        if (TBCache::load(tbCacheDir, pc, ms)) {
+            releaseTB();
+            mappedStorage = ms;
+            tbGenMapped = std::make_unique<TBGenerator<MappedStorage>>(mappedStorage, pc);
+            double t = currentTime() - t0;
+            TBCache::addLoadTime(t);
+            setCacheInfo("loaded", t);
+            notUsedCnt = 0;
+            return true;
+        }
+    }
+
+    static S64 requiredTime = 3000;
+    if (maxTimeMillis >= 0 && maxTimeMillis < requiredTime)
+        return false; // Not enough time to generate TB
+
+    U64 ttSize = tableSize * sizeof(TTEntryStorage);
+    const int tbSize = 5 * 1024 * 1024; // Max TB size, 10*64^3*2
+    if (ttSize < tbSize + 2 * 1024 * 1024)
+        return false;
+
+    // Search threads are idle during TB generation, so use them to speed it up
+    int nThreads = std::min(tbGenThreads, std::max((int)std::thread::hardware_concurrency(), 1));
+
+    double t0 = currentTime();
+    tbGenMapped.reset();
+    mappedStorage.close();
     tbGen = std::make_unique<TBGenerator<TTStorage>>(ttStorage, pc);
-    if (!tbGen->generate(maxTimeMillis, false)) {
+    if (!tbGen->generate(maxTimeMillis, false, nThreads)) {
         // Increase requiredTime unless computation was aborted
         S64 maxT = maxTimeMillis;
         if (maxT != 0)
@@ -355,10 +405,30 @@ TranspositionTable::updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMil
     }
     setUsedSize(tableSize - tbSize / sizeof(TTEntryStorage));
     notUsedCnt = 0;
+
+    if (!tbCacheDir.empty()) {
+        double t = currentTime() - t0;
+        TBCache::addGenTime(t);
+        std::vector<U8> table(TBPosition(pc).nPositions());
+        for (U32 idx = 0; idx < table.size(); idx++)
+            table[idx] = (U8)ttStorage[idx].getState();
+        TBCache::save(tbCacheDir, pc, table, tbCacheMaxBytes);
+        setCacheInfo("generated", t);
+    }
     return true;
 }
 
 bool
 TranspositionTable::probeDTM(const Position& pos, int ply, int& score) const {
-    return tbGen && tbGen->probeDTM(pos, ply, score);
+    if (tbGen)
+        return tbGen->probeDTM(pos, ply, score);
+    return tbGenMapped && tbGenMapped->probeDTM(pos, ply, score);
+}
+
+void
+TranspositionTable::releaseTB() {
+    tbGen.reset();
+    tbGenMapped.reset();
+    mappedStorage.close();
+    setUsedSize(tableSize);
 }
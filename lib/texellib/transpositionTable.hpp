@@ -30,6 +30,8 @@
 #include "move.hpp"
 #include "constants.hpp"
 #include "tbgen.hpp"
+#include "tbcache.hpp"
+#include "searchProfile.hpp"
 
 #include <memory>
 #include <vector>
@@ -51,6 +53,7 @@ public:
 
     const PositionValue operator[](U32 idx) const;
     void store(U32 idx, PositionValue pv);
+    bool compareExchange(U32 idx, PositionValue& expected, PositionValue desired);
 
 private:
     TranspositionTable& table;
@@ -141,7 +144,8 @@ public:
     TranspositionTable(const TranspositionTable& other) = delete;
     TranspositionTable operator=(const TranspositionTable& other) = delete;
 
-    void reSize(U64 numEntries);
+    /** Change the table size. The new table is cleared, see clear(). */
+    void reSize(U64 numEntries, int nThreads = 1);
 
     void setWhiteContempt(int contempt);
 
@@ -164,8 +168,11 @@ public:
      */
     void nextGeneration();
 
-    /** Clear the transposition table. */
-    void clear();
+    /** Clear the transposition table. nThreads is the number of search threads
+     *  using the table. Large tables are cleared by one thread per search
+     *  thread, bound to the NUMA node of that search thread. At least 4 and at
+     *  most the number of hardware threads are used. */
+    void clear(int nThreads = 1);
 
     /** Extract a list of PV moves, starting from "rootPos" and first move "mFirst". */
     void extractPVMoves(const Position& rootPos, const Move& mFirst, std::vector<Move>& pv);
@@ -183,12 +190,22 @@ public:
 
     // Methods to handle tablebase generation and probing
 
+    /** Set number of threads to use for tablebase generation. */
+    void setTBGenThreads(int nThreads);
+
+    /** Set directory where generated tablebases are cached, and the maximum
+     *  total size of the cached files. An empty directory disables the cache. */
+    void setTBCache(const std::string& dir, U64 maxBytes);
+
     /**
      * Possibly create or remove a tablebase based on the provided root position
      * and available thinking time.
+     * If a tablebase was loaded from or saved to the TB cache, cacheInfo is set
+     * to a description of the cache operation, otherwise it is cleared.
      * Return true if TBs are available.
      */
-    bool updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis);
+    bool updateTB(const Position& pos, RelaxedShared<S64>& maxTimeMillis,
+                  std::string& cacheInfo);
 
     /** Probe tablebase.
      * @param pos  The position to probe.
@@ -201,6 +218,10 @@ public:
     /** Low-level methods to read/write a single byte in the table. Used by TB generator code. */
     U8 getByte(U64 idx);
     void putByte(U64 idx, U8 value);
+    /** Atomically set byte to "desired" if it is equal to "expected". Otherwise set
+     *  "expected" to the current value and return false. Unlike putByte(), this is
+     *  safe when other threads concurrently modify other bytes in the same entry. */
+    bool compareExchangeByte(U64 idx, U8& expected, U8 desired);
     U64 byteSize() const;
 
 private:
@@ -210,6 +231,9 @@ private:
     /** Get position in hash table given zobrist key. */
     size_t getIndex(U64 key) const;
 
+    /** Remove the current on-demand tablebase, if any. */
+    void releaseTB();
+
 
     TTEntryStorage* table; // Points to data in tableP
 
@@ -218,7 +242,7 @@ private:
     int usedSizeShift = 0;
     U64 usedSizeMask = 0;
 
-    U8 generation = 0;
+    RelaxedShared<U8> generation { 0 }; // Can be advanced while other threads are searching
     U64 contemptHash = 0;
     U64 tableSize = 0;     // Number of entries
 
@@ -227,6 +251,11 @@ private:
     // On-demand TB generation
     TTStorage ttStorage;
     std::unique_ptr<TBGenerator<TTStorage>> tbGen;
+    MappedStorage mappedStorage; // Tablebase loaded from the on-demand TB cache
+    int tbGenThreads = 1;        // Number of threads used for TB generation
+    std::string tbCacheDir;      // On-demand TB cache directory, empty if not used
+    U64 tbCacheMaxBytes = 0;     // Max total size of files in tbCacheDir
+    std::unique_ptr<TBGenerator<MappedStorage>> tbGenMapped;
     int notUsedCnt; // Number of times updateTB() has found the tablebase
                     // unsuitable for the current root position
 };
@@ -252,6 +281,14 @@ TTStorage::store(U32 idx, PositionValue pv) {
     table.putByte(idx0 + idx, (U8)pv.getState());
 }
 
+inline bool
+TTStorage::compareExchange(U32 idx, PositionValue& expected, PositionValue desired) {
+    U8 e = (U8)expected.getState();
+    bool ret = table.compareExchangeByte(idx0 + idx, e, (U8)desired.getState());
+    expected = PositionValue(e);
+    return ret;
+}
+
 
 inline
 TranspositionTable::TTEntryStorage::TTEntryStorage() {
@@ -440,14 +477,16 @@ TranspositionTable::getIndex(U64 key) const {
 
 inline void
 TranspositionTable::probe(U64 key, TTEntry& result) {
+    SEARCH_PROFILE_SCOPE(TT_PROBE);
     key ^= contemptHash;
     size_t idx0 = getIndex(key);
     TTEntry ent;
     for (int i = 0; i < 4; i++) {
         ent.load(table[idx0 + i]);
         if (ent.getKey() == key) {
-            if (ent.getGeneration() != generation) {
-                ent.setGeneration(generation);
+            const U8 gen = generation;
+            if (ent.getGeneration() != gen) {
+                ent.setGeneration(gen);
                 ent.store(table[idx0 + i]);
             }
             result = ent;
@@ -503,6 +542,25 @@ TranspositionTable::putByte(U64 idx, U8 value) {
     }
 }
 
+inline bool
+TranspositionTable::compareExchangeByte(U64 idx, U8& expected, U8 desired) {
+    U64 ent = idx / 16;
+    int offs = idx & 0xf;
+    std::atomic<U64>& a = (offs < 8) ? table[ent].key : table[ent].data;
+    const int shift = (offs & 0x07) * 8;
+    U64 data = a.load(std::memory_order_relaxed);
+    while (true) {
+        U8 old = (data >> shift) & 0xff;
+        if (old != expected) {
+            expected = old;
+            return false;
+        }
+        U64 newData = (data & ~(0xffULL << shift)) | (((U64)desired) << shift);
+        if (a.compare_exchange_weak(data, newData, std::memory_order_relaxed))
+            return true;
+    }
+}
+
 inline U64
 TranspositionTable::byteSize() const {
     return tableSize * sizeof(TTEntryStorage);
@@ -0,0 +1,107 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * mappedFile.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "mappedFile.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+bool
+MappedFile::open(const std::string& fileName) {
+#ifdef _WIN32
+    HANDLE fh = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                            NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fh == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fh, &size) || size.QuadPart <= 0) {
+        CloseHandle(fh);
+        return false;
+    }
+    HANDLE mh = CreateFileMapping(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(fh);
+    if (!mh)
+        return false;
+    void* mem = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mh);
+    if (!mem)
+        return false;
+    mapping = std::shared_ptr<const U8>((const U8*)mem, [](const U8* p) {
+        UnmapViewOfFile((void*)p);
+    });
+    fileSize = size.QuadPart;
+#else
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) != 0 || statBuf.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    size_t len = statBuf.st_size;
+    void* mem = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+        return false;
+    mapping = std::shared_ptr<const U8>((const U8*)mem, [len](const U8* p) {
+        munmap((void*)p, len);
+    });
+    fileSize = len;
+#endif
+    return true;
+}
+
+void
+MappedFile::close() {
+    mapping.reset();
+    fileSize = 0;
+}
+
+void
+MappedFile::willNeed(U64 offs, U64 len) const {
+    if (!mapping || offs >= fileSize)
+        return;
+    len = std::min(len, fileSize - offs);
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = (void*)(mapping.get() + offs);
+    range.NumberOfBytes = len;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+    const U64 pageSize = sysconf(_SC_PAGESIZE);
+    U64 beg = offs / pageSize * pageSize; // madvise requires a page aligned address
+    madvise((void*)(mapping.get() + beg), offs + len - beg, MADV_WILLNEED);
+#endif
+}
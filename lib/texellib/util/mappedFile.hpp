@@ -0,0 +1,70 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * mappedFile.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef MAPPEDFILE_HPP_
+#define MAPPEDFILE_HPP_
+
+#include "util.hpp"
+
+#include <memory>
+#include <string>
+
+
+/** A whole file mapped read-only into memory. Copies of a MappedFile object
+ *  share the same mapping, which is removed when the last copy is destroyed. */
+class MappedFile {
+public:
+    /** Map a file into memory. Return false if the file could not be mapped.
+     *  In that case the previously mapped file, if any, is kept. */
+    bool open(const std::string& fileName);
+    /** Unmap the file. */
+    void close();
+
+    /** Return pointer to the file data, or nullptr if no file is mapped. */
+    const U8* data() const;
+    /** Return the file size in bytes. */
+    U64 size() const;
+
+    /** Tell the operating system that bytes [offs,offs+len) will soon be accessed.
+     *  The data is read in the background if supported by the operating system. */
+    void willNeed(U64 offs, U64 len) const;
+
+private:
+    std::shared_ptr<const U8> mapping; // Unmaps file when destroyed
+    U64 fileSize = 0;
+};
+
+
+inline const U8*
+MappedFile::data() const {
+    return mapping.get();
+}
+
+inline U64
+MappedFile::size() const {
+    return fileSize;
+}
+
+#endif /* MAPPEDFILE_HPP_ */
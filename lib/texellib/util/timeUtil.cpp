@@ -33,6 +33,13 @@
 #include <sys/time.h>
 #endif
 
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 S64 currentTimeMillis() {
 #ifdef HAS_RT
     clockid_t c = CLOCK_MONOTONIC;
@@ -61,6 +68,24 @@ double currentTime() {
 #endif
 }
 
+U64 peakMemoryUsage() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0;
+    return pmc.PeakWorkingSetSize;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss;        // Bytes
+#else
+    return usage.ru_maxrss * 1024ULL; // Kilobytes
+#endif
+#endif
+}
+
 SampleStatistics&
 SampleStatistics::operator+=(const SampleStatistics& other) {
     nSamples += other.nSamples;
@@ -39,6 +39,10 @@ S64 currentTimeMillis();
 /** Return current wall clock time in seconds, starting at some arbitrary point in time. */
 double currentTime();
 
+/** Return the peak resident memory usage of this process in bytes,
+ *  or 0 if not supported on this platform. */
+U64 peakMemoryUsage();
+
 
 
 /** Class that measures average CPU utilization. */
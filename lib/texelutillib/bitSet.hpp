@@ -168,6 +168,37 @@ public:
         return cnt;
     }
 
+    /** Return the number of bits in (*this | b), without creating the union.
+     *  Only the first nBits bits are examined, higher bits must be zero. */
+    int orBitCount(const BitSet& b, int nBits = N) const {
+        const BitSet* sets[2] = { this, &b };
+        return unionBitCount(sets, 2, nBits);
+    }
+
+    /** Return the number of bits in the union of sets[0], ..., sets[n-1].
+     *  Only the first nBits bits are examined, higher bits must be zero. */
+    static int unionBitCount(const BitSet* const sets[], int n, int nBits = N) {
+        const int nW = std::min(nWords, (nBits + 63) / 64);
+        // Four independent accumulators to avoid a serial dependency chain
+        int cnt[4] = { 0, 0, 0, 0 };
+        int i = 0;
+        for ( ; i + 4 <= nW; i += 4) {
+            for (int k = 0; k < 4; k++) {
+                U64 w = sets[0]->data[i+k];
+                for (int s = 1; s < n; s++)
+                    w |= sets[s]->data[i+k];
+                cnt[k] += BitUtil::bitCount(w);
+            }
+        }
+        for ( ; i < nW; i++) {
+            U64 w = sets[0]->data[i];
+            for (int s = 1; s < n; s++)
+                w |= sets[s]->data[i];
+            cnt[0] += BitUtil::bitCount(w);
+        }
+        return cnt[0] + cnt[1] + cnt[2] + cnt[3];
+    }
+
 private:
     U64 data[nWords] = { 0 };
 };
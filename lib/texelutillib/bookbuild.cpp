@@ -30,6 +30,7 @@
 #include "search.hpp"
 #include "histogram.hpp"
 #include "textio.hpp"
+#include "timeUtil.hpp"
 #include <random>
 
 namespace BookBuild {
@@ -347,26 +348,71 @@ Book::abortExtendBook() {
 
 void
 Book::importPGN(const std::string& bookFile, const std::string& pgnFile,
-                int maxPly) {
+                int maxPly, int nThreads) {
     readFromFile(bookFile);
 
-    // Create book nodes for all positions in the PGN file
-    std::ifstream is(pgnFile);
-    PgnReader reader(is);
-    GameTree gt;
+    // Worker threads parse the PGN file and collect the moves to add to the
+    // book, in the same order as the sequential algorithm would add them.
+    // Adding the moves to the book is done in this thread.
+    struct AddInfo {
+        U64 childHash;
+        Position::SerializeData parentPos;
+        Move move;
+    };
+    struct ImportChunk {
+        std::vector<AddInfo> toAdd;
+        std::unordered_set<U64> childHashes; // Child positions in toAdd
+        int nGames = 0;
+    };
+
+    auto parseGame = [maxPly](GameTree& gt, ImportChunk& chunk) {
+        chunk.nGames++;
+        GameNode gn = gt.getRootNode();
+        std::function<void(int)> collect = [&collect,&chunk,maxPly,&gn](int ply) {
+            if (ply >= maxPly)
+                return;
+            Position base = gn.getPos();
+            for (int i = 0; i < gn.nChildren(); i++) {
+                gn.goForward(i);
+                U64 childHash = gn.getPos().bookHash();
+                if (chunk.childHashes.insert(childHash).second) {
+                    AddInfo ai;
+                    ai.childHash = childHash;
+                    base.serialize(ai.parentPos);
+                    ai.move = gn.getMove();
+                    chunk.toAdd.push_back(ai);
+                }
+                collect(ply+1);
+                gn.goBack();
+            }
+        };
+        collect(0);
+    };
+
     int nGames = 0;
     int nAdded = 0;
-    try {
-        while (reader.readPGN(gt)) {
-            nGames++;
-            GameNode gn = gt.getRootNode();
-            addToBook(maxPly, gn, nAdded);
+    auto consume = [this,&nGames,&nAdded](const ImportChunk& chunk) {
+        std::lock_guard<std::mutex> L(mutex);
+        for (const AddInfo& ai : chunk.toAdd) {
+            if (!getBookNode(ai.childHash)) {
+                assert(!ai.move.isEmpty());
+                Position base;
+                base.deSerialize(ai.parentPos);
+                std::vector<U64> toSearch;
+                addPosToBook(base, ai.move, toSearch);
+                nAdded++;
+            }
         }
-    } catch (...) {
-        std::cerr << "Error parsing game " << nGames << std::endl;
-        throw;
-    }
+        nGames += chunk.nGames;
+    };
+
+    double t0 = currentTime();
+    GameTreeUtil::iteratePgnParallel<GameTree, ImportChunk>(pgnFile, nThreads,
+                                                            parseGame, consume);
+    double t = currentTime() - t0;
     std::cout << "Added " << nAdded << " positions from " << nGames << " games" << std::endl;
+    std::cout << "t: " << t << " games/s: " << (t > 0 ? nGames / t : 0)
+              << " peak memory: " << peakMemoryUsage() / (1024 * 1024) << "MB" << std::endl;
 }
 
 void
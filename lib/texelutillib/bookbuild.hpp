@@ -304,8 +304,10 @@ public:
     /** Stop improving the opening book as soon as possible. */
     void abortExtendBook();
 
-    /** Add moves from a PGN file to the book. */
-    void importPGN(const std::string& bookFile, const std::string& pgnFile, int maxPly);
+    /** Add moves from a PGN file to the book. The PGN file is parsed by
+     *  nThreads worker threads. */
+    void importPGN(const std::string& bookFile, const std::string& pgnFile, int maxPly,
+                   int nThreads);
 
     /** Add all moves in a game tree up to ply maxPly to the book. */
     void addToBook(int maxPly, GameNode& gn, int& nAdded);
@@ -39,8 +39,13 @@ PgnToken::PgnToken(int type0, const std::string& token0)
 // --------------------------------------------------------------------------------
 
 PgnScanner::PgnScanner(std::istream& is0)
-    : is(is0), col0(true), eofReached(false),
-      hasReturnedChar(false), returnedChar(0) {
+    : is(&is0), buf(65536), bufPtr(nullptr), bufEnd(nullptr), col0(true),
+      eofReached(false), hasReturnedChar(false), returnedChar(0) {
+}
+
+PgnScanner::PgnScanner(const char* data, size_t size)
+    : is(nullptr), bufPtr(data), bufEnd(data + size), col0(true),
+      eofReached(false), hasReturnedChar(false), returnedChar(0) {
 }
 
 void
@@ -48,51 +53,69 @@ PgnScanner::putBack(const PgnToken& tok) {
     savedTokens.push_back(tok);
 }
 
-char
-PgnScanner::getNextChar() {
-    int c;
-    c = is.get();
-    if (eofReached || (c == EOF))
-        throw std::out_of_range("");
-    return c;
+bool
+PgnScanner::fillBuffer() {
+    if (!is)
+        return false;
+    is->read(buf.data(), buf.size());
+    size_t len = is->gcount();
+    if (len == 0) {
+        is = nullptr;
+        return false;
+    }
+    bufPtr = buf.data();
+    bufEnd = bufPtr + len;
+    return true;
 }
 
-char
+int
 PgnScanner::getTokenChar() {
     if (hasReturnedChar) {
         hasReturnedChar = false;
         return returnedChar;
     }
-    try {
-        while (true) {
-            char c = getNextChar();
-            if (c == '%' && col0) {
-                while (true) {
-                    char nextChar = getNextChar();
-                    if ((nextChar == '\n') || (nextChar == '\r'))
-                        break;
-                }
-                col0 = true;
-            } else {
-                col0 = ((c == '\n') || (c == '\r'));
-                return c;
+    while (true) {
+        int c = getNextChar();
+        if (c < 0) {
+            if (eofReached)
+                return -1;
+            eofReached = true;
+            return '\n'; // Terminating whitespace simplifies the tokenizer
+        }
+        if (c == '%' && col0) {
+            while (true) {
+                int nextChar = getNextChar();
+                if ((nextChar < 0) || (nextChar == '\n') || (nextChar == '\r'))
+                    break;
             }
+            col0 = true;
+        } else {
+            col0 = ((c == '\n') || (c == '\r'));
+            return c;
         }
-    } catch (const std::out_of_range&) {
-        if (eofReached)
-            throw;
-        eofReached = true;
-        return '\n'; // Terminating whitespace simplifies the tokenizer
     }
 }
 
 void
-PgnScanner::returnTokenChar(char c) {
+PgnScanner::returnTokenChar(int c) {
     assert(!hasReturnedChar);
     hasReturnedChar = true;
     returnedChar = c;
 }
 
+/** Return true if c terminates a symbol token. */
+static inline bool
+isSymbolTerminator(int c) {
+    switch (c) {
+    case ' ': case '\t': case '\n': case '\r': case '\v': case '\f':
+    case '.': case '*': case '[': case ']': case '(': case ')':
+    case '{': case ';': case '"': case '$':
+        return true;
+    default:
+        return false;
+    }
+}
+
 PgnToken
 PgnScanner::nextToken() {
     if (savedTokens.size() > 0) {
@@ -103,98 +126,94 @@ PgnScanner::nextToken() {
     }
 
     PgnToken ret(PgnToken::END, "");
-    try {
-        while (true) {
-            char c = getTokenChar();
-            if (isspace(c)) {
-                // Skip
-            } else if (c == '.') {
-                ret.type = PgnToken::PERIOD;
-                break;
-            } else if (c == '*') {
-                ret.type = PgnToken::ASTERISK;
-                break;
-            } else if (c == '[') {
-                ret.type = PgnToken::LEFT_BRACKET;
-                break;
-            } else if (c == ']') {
-                ret.type = PgnToken::RIGHT_BRACKET;
-                break;
-            } else if (c == '(') {
-                ret.type = PgnToken::LEFT_PAREN;
-                break;
-            } else if (c == ')') {
-                ret.type = PgnToken::RIGHT_PAREN;
-                break;
-            } else if (c == '{') {
-                ret.type = PgnToken::COMMENT;
-                std::string sb;
-                while ((c = getTokenChar()) != '}')
-                    sb += c;
-                ret.token = sb;
-                break;
-            } else if (c == ';') {
-                ret.type = PgnToken::COMMENT;
-                std::string sb;
-                while (true) {
-                    c = getTokenChar();
-                    if ((c == '\n') || (c == '\r'))
-                        break;
-                    sb += c;
-                }
-                ret.token = sb;
-                break;
-            } else if (c == '"') {
-                ret.type = PgnToken::STRING;
-                std::string sb;
-                while (true) {
+    while (true) {
+        int c = getTokenChar();
+        if (c < 0) {
+            break;
+        } else if (isspace(c)) {
+            // Skip
+        } else if (c == '.') {
+            ret.type = PgnToken::PERIOD;
+            break;
+        } else if (c == '*') {
+            ret.type = PgnToken::ASTERISK;
+            break;
+        } else if (c == '[') {
+            ret.type = PgnToken::LEFT_BRACKET;
+            break;
+        } else if (c == ']') {
+            ret.type = PgnToken::RIGHT_BRACKET;
+            break;
+        } else if (c == '(') {
+            ret.type = PgnToken::LEFT_PAREN;
+            break;
+        } else if (c == ')') {
+            ret.type = PgnToken::RIGHT_PAREN;
+            break;
+        } else if (c == '{') {
+            while ((c = getTokenChar()) != '}') {
+                if (c < 0)
+                    return PgnToken(PgnToken::END, "");
+                ret.token += (char)c;
+            }
+            ret.type = PgnToken::COMMENT;
+            break;
+        } else if (c == ';') {
+            while (true) {
+                c = getTokenChar();
+                if (c < 0)
+                    return PgnToken(PgnToken::END, "");
+                if ((c == '\n') || (c == '\r'))
+                    break;
+                ret.token += (char)c;
+            }
+            ret.type = PgnToken::COMMENT;
+            break;
+        } else if (c == '"') {
+            while (true) {
+                c = getTokenChar();
+                if (c == '"') {
+                    break;
+                } else if (c == '\\') {
                     c = getTokenChar();
-                    if (c == '"') {
-                        break;
-                    } else if (c == '\\') {
-                        c = getTokenChar();
-                    }
-                    sb += c;
                 }
-                ret.token = sb;
-                break;
-            } else if (c == '$') {
-                ret.type = PgnToken::NAG;
-                std::string sb;
-                while (true) {
-                    c = getTokenChar();
-                    if (!isdigit(c)) {
-                        returnTokenChar(c);
-                        break;
-                    }
-                    sb += c;
+                if (c < 0)
+                    return PgnToken(PgnToken::END, "");
+                ret.token += (char)c;
+            }
+            ret.type = PgnToken::STRING;
+            break;
+        } else if (c == '$') {
+            while (true) {
+                c = getTokenChar();
+                if (c < 0)
+                    return PgnToken(PgnToken::END, "");
+                if (!isdigit(c)) {
+                    returnTokenChar(c);
+                    break;
                 }
-                ret.token = sb;
-                break;
-            } else { // Start of symbol or integer
-                ret.type = PgnToken::SYMBOL;
-                std::string sb;
-                sb += c;
-                bool onlyDigits = isdigit(c);
-                const std::string term = ".*[](){;\"$";
-                while (true) {
-                    c = getTokenChar();
-                    if (isspace(c) || (term.find_first_of(c) != std::string::npos)) {
-                        returnTokenChar(c);
-                        break;
-                    }
-                    sb += c;
-                    if (!isdigit(c))
-                        onlyDigits = false;
+                ret.token += (char)c;
+            }
+            ret.type = PgnToken::NAG;
+            break;
+        } else { // Start of symbol or integer
+            ret.token += (char)c;
+            bool onlyDigits = isdigit(c);
+            while (true) {
+                c = getTokenChar();
+                if (c < 0)
+                    return PgnToken(PgnToken::END, "");
+                if (isSymbolTerminator(c)) {
+                    returnTokenChar(c);
+                    break;
                 }
-                if (onlyDigits)
-                    ret.type = PgnToken::INTEGER;
-                ret.token = sb;
-                break;
+                ret.token += (char)c;
+                if (!isdigit(c))
+                    onlyDigits = false;
             }
+            ret.type = onlyDigits ? PgnToken::INTEGER : PgnToken::SYMBOL;
+            break;
         }
-    } catch (const std::out_of_range&) {
-        ret.type = PgnToken::END;
     }
     return ret;
 }
@@ -500,16 +519,22 @@ GameTree::insertTree(const GameTree& src, int maxPly) {
     iterateTree(0);
 }
 
-GameTree::Result
-GameTree::getResult() const {
+/** Convert a PGN result string to a GameTree::Result value. */
+static GameTree::Result
+strToResult(const std::string& result) {
     if (result =="1-0")
-        return WHITE_WIN;
+        return GameTree::WHITE_WIN;
     else if (result == "0-1")
-        return BLACK_WIN;
+        return GameTree::BLACK_WIN;
     else if (result == "1/2-1/2")
-        return DRAW;
+        return GameTree::DRAW;
     else
-        return UNKNOWN;
+        return GameTree::UNKNOWN;
+}
+
+GameTree::Result
+GameTree::getResult() const {
+    return strToResult(result);
 }
 
 void
@@ -588,17 +613,35 @@ GameTree::getGameTreeString(std::string& str, std::set<RangeToNode>& posToNodes)
 
 // --------------------------------------------------------------------------------
 
+std::string
+PgnGame::getTag(const std::string& tagName) const {
+    for (const TagPair& tp : tagPairs)
+        if (tp.tagName == tagName)
+            return tp.tagValue;
+    return "?";
+}
+
+GameTree::Result
+PgnGame::getResult() const {
+    return strToResult(getTag("Result"));
+}
+
+// --------------------------------------------------------------------------------
+
 PgnReader::PgnReader(std::istream& is)
     : scanner(is) {
 }
 
-bool
-PgnReader::readPGN(GameTree& tree) {
+PgnReader::PgnReader(const char* data, size_t size)
+    : scanner(data, size) {
+}
+
+void
+PgnReader::readTagPairs(std::vector<GameTree::TagPair>& tPairs) {
     PgnToken tok = scanner.nextToken();
 
-    // Parse tag section
     using TagPair = GameTree::TagPair;
-    std::vector<TagPair> tPairs;
+    tPairs.clear();
     while (tok.type == PgnToken::LEFT_BRACKET) {
         TagPair tp;
         tok = scanner.nextTokenDropComments();
@@ -630,6 +673,14 @@ PgnReader::readPGN(GameTree& tree) {
         tok = scanner.nextToken();
     }
     scanner.putBack(tok);
+}
+
+bool
+PgnReader::readPGN(GameTree& tree) {
+    // Parse tag section
+    using TagPair = GameTree::TagPair;
+    std::vector<TagPair> tPairs;
+    readTagPairs(tPairs);
 
     std::string fen = TextIO::startPosFEN;
     int nTags = tPairs.size();
@@ -651,3 +702,177 @@ PgnReader::readPGN(GameTree& tree) {
 
     return true;
 }
+
+bool
+PgnReader::readMainLine(PgnGame& game) {
+    readTagPairs(game.tagPairs);
+
+    static const Position stdStartPos(TextIO::readFEN(TextIO::startPosFEN));
+    game.startPos = stdStartPos;
+    for (const GameTree::TagPair& tp : game.tagPairs)
+        if (tp.tagName == "FEN")
+            game.startPos = TextIO::readFEN(tp.tagValue);
+
+    parseMainLine(game);
+
+    return !game.tagPairs.empty() || !game.moves.empty();
+}
+
+void
+PgnReader::parseMainLine(PgnGame& game) {
+    game.moves.clear();
+    game.comments.clear();
+
+    // Comments are attached to moves the same way as in Node::parsePgn
+    Position pos(game.startPos);
+    UndoInfo ui;
+    Move move;
+    bool moveAdded = false;
+    std::string preComment, postComment;
+    auto addMove = [&]() {
+        game.moves.push_back(move);
+        if (!preComment.empty() && !postComment.empty())
+            preComment += ' ';
+        game.comments.push_back(preComment + postComment);
+        preComment.clear();
+        postComment.clear();
+        pos.makeMove(move, ui);
+        moveAdded = false;
+    };
+
+    while (true) {
+        PgnToken tok = scanner.nextToken();
+        switch (tok.type) {
+        case PgnToken::INTEGER:
+        case PgnToken::PERIOD:
+        case PgnToken::NAG:
+            break;
+        case PgnToken::LEFT_PAREN: {
+            if (moveAdded)
+                addMove();
+            int nestLevel = 1;
+            while (nestLevel > 0) {
+                switch (scanner.nextToken().type) {
+                case PgnToken::LEFT_PAREN: nestLevel++; break;
+                case PgnToken::RIGHT_PAREN: nestLevel--; break;
+                case PgnToken::END: return; // Broken PGN file. Just give up.
+                }
+            }
+            break;
+        }
+        case PgnToken::SYMBOL: {
+            std::string& str = tok.token;
+            if ((str == "1-0") || (str == "0-1") || (str == "1/2-1/2") || (str == "*")) {
+                if (moveAdded)
+                    addMove();
+                return;
+            }
+            size_t len = str.length();
+            while ((len > 0) && ((str[len-1] == '!') || (str[len-1] == '?')))
+                len--;
+            str.resize(len);
+            if (len > 0) {
+                if (moveAdded)
+                    addMove();
+                move = TextIO::stringToMove(pos, str);
+                if (move.isEmpty()) {
+                    std::cerr << TextIO::asciiBoard(pos) << " wtm:" << (pos.isWhiteMove()?1:0) << " move:" << str << std::endl;
+                    throw ChessParseError("Invalid move");
+                }
+                moveAdded = true;
+            }
+            break;
+        }
+        case PgnToken::COMMENT:
+            if (moveAdded)
+                postComment += tok.token;
+            else
+                preComment += tok.token;
+            break;
+        case PgnToken::ASTERISK:
+        case PgnToken::LEFT_BRACKET:
+        case PgnToken::RIGHT_BRACKET:
+        case PgnToken::STRING:
+        case PgnToken::RIGHT_PAREN:
+        case PgnToken::END:
+            if (moveAdded)
+                addMove();
+            return;
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------
+
+PgnSplitter::PgnSplitter(const char* data0, size_t size0, size_t chunkSize0)
+    : data(data0), size(size0), chunkSize(chunkSize0) {
+}
+
+bool
+PgnSplitter::nextChunk(const char*& chunk, size_t& chunkLen) {
+    if (pos >= size)
+        return false;
+
+    // A new game starts at a '[' that is not inside a comment or string and
+    // that follows movetext. Scanner states are tracked the same way as
+    // in PgnScanner, so that chunks never split a token.
+    enum State { NORMAL, TAG, STRING, COMMENT, LINE_COMMENT };
+    State state = NORMAL;
+    State stringReturnState = NORMAL;
+    bool col0 = true;
+    bool moveText = false;
+    size_t i = pos;
+    for ( ; i < size; i++) {
+        const char c = data[i];
+        switch (state) {
+        case NORMAL:
+            if (c == '[') {
+                if (moveText && (i - pos >= chunkSize)) {
+                    chunk = data + pos;
+                    chunkLen = i - pos;
+                    pos = i;
+                    return true;
+                }
+                moveText = false;
+                state = TAG;
+            } else if (c == '{') {
+                state = COMMENT;
+            } else if ((c == ';') || ((c == '%') && col0)) {
+                state = LINE_COMMENT;
+            } else if (c == '"') {
+                stringReturnState = NORMAL;
+                state = STRING;
+            } else if (!isspace((unsigned char)c)) {
+                moveText = true;
+            }
+            break;
+        case TAG:
+            if (c == ']') {
+                state = NORMAL;
+            } else if (c == '"') {
+                stringReturnState = TAG;
+                state = STRING;
+            }
+            break;
+        case STRING:
+            if (c == '"')
+                state = stringReturnState;
+            else if ((c == '\\') && (i + 1 < size))
+                i++;
+            break;
+        case COMMENT:
+            if (c == '}')
+                state = NORMAL;
+            break;
+        case LINE_COMMENT:
+            if ((c == '\n') || (c == '\r'))
+                state = NORMAL;
+            break;
+        }
+        col0 = (c == '\n') || (c == '\r');
+    }
+    chunk = data + pos;
+    chunkLen = size - pos;
+    pos = size;
+    return true;
+}
@@ -64,24 +64,36 @@ public:
 
 class PgnScanner {
 public:
+    /** Read PGN data from a stream. */
     explicit PgnScanner(std::istream& is);
 
+    /** Read PGN data from a memory buffer, for example a memory mapped file.
+     *  The data must remain valid as long as the scanner is used. */
+    PgnScanner(const char* data, size_t size);
+
     void putBack(const PgnToken& tok);
 
     PgnToken nextToken();
 
     PgnToken nextTokenDropComments();
 
-    char getNextChar();
-    char getTokenChar();
-    void returnTokenChar(char c);
+    /** Return the next input character, or -1 at end of input. */
+    int getNextChar();
+    int getTokenChar();
+    void returnTokenChar(int c);
 
 private:
-    std::istream& is;
+    /** Read more data from the input stream. Return false at end of stream. */
+    bool fillBuffer();
+
+    std::istream* is;       // Null if reading from a memory buffer
+    std::vector<char> buf;  // Buffered stream data
+    const char* bufPtr;     // Next character to return
+    const char* bufEnd;     // End of available data
     bool col0;
     bool eofReached;
     bool hasReturnedChar;
-    char returnedChar;
+    int returnedChar;
     std::vector<PgnToken> savedTokens;
 };
 
@@ -245,15 +257,73 @@ private:
 };
 
 
+/** The main line of a PGN game. Reading only the main line is much faster
+ *  than building a GameTree, since no Node objects have to be created. */
+class PgnGame {
+public:
+    using TagPair = GameTree::TagPair;
+
+    /** Get value of a PGN tag, or "?" if the tag is not present. */
+    std::string getTag(const std::string& tagName) const;
+
+    /** Get game result. */
+    GameTree::Result getResult() const;
+
+    std::vector<TagPair> tagPairs;     // All tag pairs, in file order
+    Position startPos;
+    std::vector<Move> moves;           // Main line moves
+    std::vector<std::string> comments; // comments[i] is the comment for moves[i]
+};
+
+
 class PgnReader {
 public:
     explicit PgnReader(std::istream& is);
 
+    /** Read PGN data from a memory buffer. */
+    PgnReader(const char* data, size_t size);
+
     /** Read next game. Return false if no more games to read. */
     bool readPGN(GameTree& tree);
 
+    /** Read next game, ignoring variations. Return false if no more games to read. */
+    bool readMainLine(PgnGame& game);
+
 private:
+    /** Read the tag section of a game. */
+    void readTagPairs(std::vector<GameTree::TagPair>& tPairs);
+
+    /** Read main line moves and comments, skipping variations. */
+    void parseMainLine(PgnGame& game);
+
     PgnScanner scanner;
 };
 
+
+/** Splits PGN data into chunks of complete games, so that the chunks can be
+ *  parsed independently, for example by different threads. */
+class PgnSplitter {
+public:
+    /** Split the memory buffer [data,data+size). All chunks except the last
+     *  one contain at least chunkSize bytes. */
+    PgnSplitter(const char* data, size_t size, size_t chunkSize);
+
+    /** Get the next chunk. Return false if there are no more chunks. */
+    bool nextChunk(const char*& chunk, size_t& chunkLen);
+
+private:
+    const char* data;
+    size_t size;
+    size_t chunkSize;
+    size_t pos = 0;    // Start of next chunk
+};
+
+
+inline int
+PgnScanner::getNextChar() {
+    if (bufPtr == bufEnd && !fillBuffer())
+        return -1;
+    return (unsigned char)*bufPtr++;
+}
+
 #endif /* GAMETREE_HPP_ */
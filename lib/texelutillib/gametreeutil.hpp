@@ -27,7 +27,12 @@
 #define GAMETREEUTIL_HPP_
 
 #include "gametree.hpp"
+#include "threadpool.hpp"
+#include "mappedFile.hpp"
 #include <functional>
+#include <algorithm>
+#include <exception>
+#include <iostream>
 
 class GameTreeUtil {
 public:
@@ -37,6 +42,21 @@ public:
      */
     template <typename Func>
     static void iteratePgn(PgnReader& reader, Func func);
+
+    /**
+     * Parse all games in pgnFile using nThreads worker threads. The file is split
+     * into chunks of complete games. For each game in a chunk, parseGame(game, result)
+     * is called in a worker thread, where "game" is a GameTree or a PgnGame and
+     * "result" is the ChunkResult object for the chunk. consume(result) is called
+     * in the calling thread for each chunk, in file order.
+     */
+    template <typename Game, typename ChunkResult, typename ParseGame, typename Consume>
+    static void iteratePgnParallel(const std::string& pgnFile, int nThreads,
+                                   ParseGame parseGame, Consume consume);
+
+private:
+    static bool readGame(PgnReader& reader, GameTree& game) { return reader.readPGN(game); }
+    static bool readGame(PgnReader& reader, PgnGame& game) { return reader.readMainLine(game); }
 };
 
 template <typename Func>
@@ -57,4 +77,55 @@ void GameTreeUtil::iteratePgn(PgnReader& reader, Func func) {
     }
 }
 
+template <typename Game, typename ChunkResult, typename ParseGame, typename Consume>
+void GameTreeUtil::iteratePgnParallel(const std::string& pgnFile, int nThreads,
+                                      ParseGame parseGame, Consume consume) {
+    MappedFile mf;
+    mf.open(pgnFile); // A missing file is treated as an empty file
+    const size_t size = mf.size();
+    const size_t chunkSize = std::clamp(size / (nThreads * 8), (size_t)64 * 1024,
+                                        (size_t)1024 * 1024);
+    PgnSplitter splitter((const char*)mf.data(), size, chunkSize);
+
+    struct Chunk {
+        ChunkResult result;
+        int nGames = 0;
+        std::exception_ptr error; // Set if parsing failed after nGames games
+    };
+    using ChunkPtr = std::shared_ptr<Chunk>;
+
+    auto getTask = [&splitter,&parseGame](std::function<ChunkPtr(int)>& task) {
+        const char* data;
+        size_t len;
+        if (!splitter.nextChunk(data, len))
+            return false;
+        task = [data,len,&parseGame](int workerNo) {
+            auto chunk = std::make_shared<Chunk>();
+            try {
+                PgnReader reader(data, len);
+                Game game;
+                while (readGame(reader, game)) {
+                    parseGame(game, chunk->result);
+                    chunk->nGames++;
+                }
+            } catch (...) {
+                chunk->error = std::current_exception();
+            }
+            return chunk;
+        };
+        return true;
+    };
+
+    int nGames = 0;
+    auto consumeChunk = [&nGames,&consume](const ChunkPtr& chunk) {
+        consume(chunk->result);
+        nGames += chunk->nGames;
+        if (chunk->error) {
+            std::cerr << "Error parsing game " << nGames << std::endl;
+            std::rethrow_exception(chunk->error);
+        }
+    };
+    orderedPipeline<ChunkPtr>(nThreads, nThreads * 4, getTask, consumeChunk);
+}
+
 #endif /* GAMETREEUTIL_HPP_ */
@@ -0,0 +1,182 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * nativegamerunner.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "nativegamerunner.hpp"
+#include "computerPlayer.hpp"
+#include "game.hpp"
+#include "moveGen.hpp"
+#include "parameters.hpp"
+#include "textio.hpp"
+#include "util.hpp"
+#include "timeUtil.hpp"
+
+#include <cmath>
+#include <iostream>
+
+
+NativeGameRunner::TimeControl
+NativeGameRunner::TimeControl::parse(const std::string& tcStr) {
+    TimeControl tc;
+    if (startsWith(tcStr, "nodes=")) {
+        if (!str2Num(tcStr.substr(6), tc.nodes) || tc.nodes <= 0)
+            throw ChessParseError("Invalid node limit: " + tcStr);
+        return tc;
+    }
+
+    std::string s = tcStr;
+    size_t idx = s.find('/');
+    if (idx != std::string::npos) {
+        if (!str2Num(s.substr(0, idx), tc.moves) || tc.moves <= 0)
+            throw ChessParseError("Invalid time control: " + tcStr);
+        s = s.substr(idx + 1);
+    }
+    double time = 0, inc = 0;
+    idx = s.find('+');
+    if (idx != std::string::npos) {
+        if (!str2Num(s.substr(idx + 1), inc) || inc < 0)
+            throw ChessParseError("Invalid time control: " + tcStr);
+        s = s.substr(0, idx);
+    }
+    if (!str2Num(s, time) || time <= 0)
+        throw ChessParseError("Invalid time control: " + tcStr);
+    tc.timeMs = (int)std::rint(time * 1000);
+    tc.incMs = (int)std::rint(inc * 1000);
+    return tc;
+}
+
+NativeGameRunner::NativeGameRunner(int nWorkers, const TimeControl& tc1, const TimeControl& tc2,
+                                   int hashMB, const std::vector<std::vector<Move>>& openings)
+    : tc1(tc1), tc2(tc2), openings(openings), nextOpening(0) {
+    U64 nEntries = hashMB > 0 ? ((U64)hashMB) * (1 << 20) / sizeof(TranspositionTable::TTEntry)
+                              : (U64)1024;
+    for (int i = 0; i < nWorkers * 2; i++) {
+        auto cp = std::make_unique<ComputerPlayer>();
+        cp->useBook(false);
+        cp->setTTSize(nEntries);
+        engines.push_back(std::move(cp));
+    }
+}
+
+NativeGameRunner::~NativeGameRunner() = default;
+
+void
+NativeGameRunner::playGamePair(int workerNo, int (&stats)[5]) {
+    const std::vector<Move>& opening = openings[nextOpening++ % openings.size()];
+    ComputerPlayer& engine1 = *engines[workerNo * 2];
+    ComputerPlayer& engine2 = *engines[workerNo * 2 + 1];
+
+    double score = playGame(engine1, tc1, engine2, tc2, opening);
+    score += 1 - playGame(engine2, tc2, engine1, tc1, opening);
+
+    for (int i = 0; i < 5; i++)
+        stats[i] = 0;
+    stats[(int)std::rint(score * 2)]++;
+}
+
+double
+NativeGameRunner::playGame(ComputerPlayer& white, const TimeControl& wTc,
+                           ComputerPlayer& black, const TimeControl& bTc,
+                           const std::vector<Move>& opening) {
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    std::vector<Position> history; // Positions since last zeroing move
+    auto doMove = [&pos,&history](const Move& m) {
+        history.push_back(pos);
+        UndoInfo ui;
+        pos.makeMove(m, ui);
+        TextIO::fixupEPSquare(pos);
+        if (pos.getHalfMoveClock() == 0)
+            history.clear();
+    };
+    for (const Move& m : opening)
+        doMove(m);
+
+    white.clearTT();
+    black.clearTT();
+
+    int timeLeft[2] = { wTc.timeMs, bTc.timeMs };
+    int movesToGo[2] = { wTc.moves, bTc.moves };
+    while (true) {
+        const bool wtm = pos.isWhiteMove();
+        const double loss = wtm ? 0 : 1;
+        MoveList moves;
+        MoveGen::pseudoLegalMoves(pos, moves);
+        MoveGen::removeIllegal(pos, moves);
+        if (moves.size == 0)
+            return MoveGen::inCheck(pos) ? loss : 0.5;
+        if (Game::insufficientMaterial(pos) || pos.getHalfMoveClock() >= 100)
+            return 0.5;
+        int nRep = 1;
+        for (const Position& p : history)
+            if (p.drawRuleEquals(pos))
+                nRep++;
+        if (nRep >= 3)
+            return 0.5;
+
+        const int c = wtm ? 0 : 1;
+        const TimeControl& tc = wtm ? wTc : bTc;
+        ComputerPlayer& player = wtm ? white : black;
+        if (tc.nodes > 0) {
+            player.timeLimit(-1, -1);
+            player.nodeLimit(tc.nodes);
+        } else {
+            int nMoves = tc.moves > 0 ? movesToGo[c] : 999;
+            nMoves = std::min(nMoves, static_cast<int>(timeMaxRemainingMoves));
+            const int time = timeLeft[c];
+            const int margin = std::min(static_cast<int>(bufferTime), time * 9 / 10);
+            int minTime = (time + tc.incMs * (nMoves - 1) - margin) / nMoves;
+            int maxTime = (int)(minTime * clamp(nMoves * 0.5, 2.0, maxTimeUsage * 0.01));
+            minTime = clamp(minTime, 1, time - margin);
+            maxTime = clamp(maxTime, 1, time - margin);
+            player.timeLimit(minTime, maxTime);
+        }
+
+        S64 t0 = currentTimeMillis();
+        std::string cmd = player.getCommand(pos, false, history);
+        S64 t1 = currentTimeMillis();
+
+        if (tc.nodes <= 0) {
+            timeLeft[c] -= (int)(t1 - t0);
+            if (timeLeft[c] < 0)
+                return loss;
+            timeLeft[c] += tc.incMs;
+            if (tc.moves > 0 && --movesToGo[c] == 0) {
+                movesToGo[c] = tc.moves;
+                timeLeft[c] += tc.timeMs;
+            }
+        }
+
+        // Draw claims are verified by the draw rule checks above after the move is played
+        if (startsWith(cmd, "draw rep") || startsWith(cmd, "draw 50"))
+            cmd = trim(cmd.substr(8));
+        Move m = TextIO::stringToMove(pos, cmd);
+        if (m.isEmpty()) {
+            std::cerr << "Invalid move: " << cmd << " in position: "
+                      << TextIO::toFEN(pos) << std::endl;
+            return loss;
+        }
+        doMove(m);
+    }
+}
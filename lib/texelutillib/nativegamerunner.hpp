@@ -0,0 +1,82 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * nativegamerunner.hpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#ifndef NATIVEGAMERUNNER_HPP_
+#define NATIVEGAMERUNNER_HPP_
+
+#include "move.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+class ComputerPlayer;
+
+
+/** Plays games between two engines running in this process. */
+class NativeGameRunner {
+public:
+    /** Time control for one engine. */
+    struct TimeControl {
+        int moves = 0;      // Moves per time control period, 0 for sudden death
+        int timeMs = 0;     // Time per period
+        int incMs = 0;      // Time increment per move
+        int nodes = -1;     // Fixed number of nodes per move if positive
+
+        /** Parse time control string. Valid formats are "[moves/]time[+inc]",
+         *  with times in seconds, and "nodes=N". Throws ChessParseError if the
+         *  string is invalid. */
+        static TimeControl parse(const std::string& tc);
+    };
+
+    /** Constructor. Creates two engine instances for each worker thread. */
+    NativeGameRunner(int nWorkers, const TimeControl& tc1, const TimeControl& tc2,
+                     int hashMB, const std::vector<std::vector<Move>>& openings);
+
+    /** Destructor. */
+    ~NativeGameRunner();
+
+    /** Play two games from the next opening line, one with each engine playing
+     *  white. stats[i] is incremented, where i/2 is the total score for engine 1. */
+    void playGamePair(int workerNo, int (&stats)[5]);
+
+private:
+    /** Play one game starting with the moves in "opening".
+     *  Return the score for the white player, 0, 0.5 or 1. */
+    static double playGame(ComputerPlayer& white, const TimeControl& wTc,
+                           ComputerPlayer& black, const TimeControl& bTc,
+                           const std::vector<Move>& opening);
+
+    TimeControl tc1;
+    TimeControl tc2;
+    std::vector<std::vector<Move>> openings;
+    std::atomic<U64> nextOpening;
+    std::vector<std::unique_ptr<ComputerPlayer>> engines; // engine1, engine2 for each worker
+};
+
+
+#endif /* NATIVEGAMERUNNER_HPP_ */
@@ -65,9 +65,6 @@ NNUtil::posToRecord(Position& pos, int searchScore, Record& r) {
 
 void
 NNUtil::recordToPos(const Record& r, Position& pos, int& searchScore) {
-    for (Square sq : AllSquares())
-        pos.clearPiece(sq);
-
     int castleMask = 0;
     int wk = r.wKing;
     int bk = r.bKing;
@@ -79,10 +76,12 @@ NNUtil::recordToPos(const Record& r, Position& pos, int& searchScore) {
         castleMask |= (bk - 63) << 2;
         bk = E8;
     }
-    pos.setPiece(Square(wk), Piece::WKING);
-    pos.setPiece(Square(bk), Piece::BKING);
-    pos.setCastleMask(castleMask);
 
+    int squares[64];
+    for (int sq = 0; sq < 64; sq++)
+        squares[sq] = Piece::EMPTY;
+    squares[wk] = Piece::WKING;
+    squares[bk] = Piece::BKING;
     int pieceType = 0;
     for (int i = 0; i < 30; i++) {
         while (pieceType < 9 && i >= r.nPieces[pieceType])
@@ -90,9 +89,17 @@ NNUtil::recordToPos(const Record& r, Position& pos, int& searchScore) {
         int sq = r.squares[i];
         if (sq == -1)
             continue;
-        pos.setPiece(Square(sq), ptVec[pieceType]);
+        squares[sq] = ptVec[pieceType];
     }
 
+    // Only change squares that differ from the current position, so that a
+    // connected NNEvaluator can update its state incrementally when
+    // consecutive records are similar
+    for (Square sq : AllSquares())
+        if (pos.getPiece(sq) != squares[sq.asInt()])
+            pos.setPiece(sq, squares[sq.asInt()]);
+    pos.setCastleMask(castleMask);
+
     pos.setWhiteMove(true);
     pos.setEpSquare(Square(-1));
     pos.setHalfMoveClock(r.halfMoveClock);
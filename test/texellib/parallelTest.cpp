@@ -300,3 +300,41 @@ TEST(ParallelTest, testCommunicator) {
     root.poll(h0);
     ASSERT_EQ(2, h0.getNStopAck());
 }
+
+TEST(ParallelTest, testCreateWorkers) {
+    Notifier notifier;
+    TranspositionTable& tt = SearchTest::tt;
+    ThreadCommunicator root(nullptr, tt, notifier, false);
+    std::vector<std::shared_ptr<WorkerThread>> children;
+
+    auto checkChildren = [&children](int nChildren) {
+        ASSERT_EQ(nChildren, children.size());
+        for (int i = 0; i < nChildren; i++)
+            ASSERT_EQ(i + 1, children[i]->getThreadNo());
+    };
+
+    WorkerThread::createWorkers(0, &root, 1, tt, children);
+    checkChildren(0);
+
+    WorkerThread::createWorkers(0, &root, 3, tt, children);
+    checkChildren(2);
+    WorkerThread* w1 = children[0].get();
+    WorkerThread* w2 = children[1].get();
+
+    WorkerThread::createWorkers(0, &root, 30, tt, children);
+    checkChildren(4);
+    ASSERT_EQ(w1, children[0].get());
+    ASSERT_EQ(w2, children[1].get());
+    WorkerThread* w4 = children[3].get();
+
+    // Threads not needed are kept for later use
+    WorkerThread::createWorkers(0, &root, 2, tt, children);
+    checkChildren(4);
+    ASSERT_EQ(w1, children[0].get());
+    ASSERT_EQ(w4, children[3].get());
+
+    WorkerThread::createWorkers(0, &root, 10, tt, children);
+    checkChildren(4);
+    ASSERT_EQ(w1, children[0].get());
+    ASSERT_EQ(w4, children[3].get());
+}
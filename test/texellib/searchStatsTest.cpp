@@ -0,0 +1,90 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * searchStatsTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "searchStats.hpp"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+
+TEST(SearchStatsTest, testCounters) {
+    SearchStats::clear();
+    SearchStats::Totals totals;
+    SearchStats::getTotals(totals);
+    for (int i = 0; i < SearchStats::N_COUNTERS; i++)
+        EXPECT_EQ(0, totals[i]);
+
+    for (int i = 0; i < 10; i++)
+        SearchStats::inc(SearchStats::TT_PROBE);
+    for (int i = 0; i < 4; i++)
+        SearchStats::inc(SearchStats::TT_HIT);
+
+    const int nThreads = 4;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 1000; i++)
+                SearchStats::inc(SearchStats::SEARCH_NODES);
+            SearchStats::inc(SearchStats::TT_PROBE);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    SearchStats::getTotals(totals);
+    EXPECT_EQ(nThreads * 1000, totals[SearchStats::SEARCH_NODES]);
+    EXPECT_EQ(10 + nThreads, totals[SearchStats::TT_PROBE]);
+    EXPECT_EQ(4, totals[SearchStats::TT_HIT]);
+    EXPECT_EQ(0, totals[SearchStats::SEE]);
+
+    SearchStats::clear();
+    SearchStats::inc(SearchStats::SEE);
+    SearchStats::getTotals(totals);
+    EXPECT_EQ(0, totals[SearchStats::SEARCH_NODES]);
+    EXPECT_EQ(0, totals[SearchStats::TT_PROBE]);
+    EXPECT_EQ(1, totals[SearchStats::SEE]);
+}
+
+TEST(SearchStatsTest, testFormat) {
+    SearchStats::Totals totals{};
+    totals[SearchStats::TT_PROBE] = 8;
+    totals[SearchStats::TT_HIT] = 2;
+    totals[SearchStats::SEARCH_NODES] = 30;
+    totals[SearchStats::QSEARCH_NODES] = 10;
+
+    std::string str = SearchStats::toString(totals);
+    EXPECT_EQ(0, str.find("searchNodes 30 qsearchNodes 10 ttProbe 8 ttHit 2 "));
+    EXPECT_NE(std::string::npos, str.find(" qsShare 0.25 ttHitRate 0.25 "));
+    EXPECT_NE(std::string::npos, str.find(" nullCutoffRate 0 "));
+
+    std::string json = SearchStats::toJson(totals);
+    EXPECT_EQ(0, json.find("{\"enabled\":"));
+    EXPECT_NE(std::string::npos, json.find("\"counters\":{\"searchNodes\":30,"));
+    EXPECT_NE(std::string::npos, json.find("\"ttHitRate\":0.25"));
+    EXPECT_EQ(json.length() - 2, json.find("}}"));
+}
@@ -35,6 +35,7 @@
 #include "killerTable.hpp"
 #include "clustertt.hpp"
 #include "textio.hpp"
+#include "random.hpp"
 
 #include <vector>
 #include <memory>
@@ -249,6 +250,109 @@ SearchTest::testDrawRep() {
     EXPECT_EQ(0, score); // Draw, black can not escape from perpetual checks
 }
 
+TEST(SearchTest, testUpcomingRep) {
+    SearchTest::testUpcomingRep();
+}
+
+void
+SearchTest::testUpcomingRep() {
+    auto canReach = [](const std::string& targetFen, const std::string& fen,
+                       int posHashFirstNew = 0) {
+        Position target = TextIO::readFEN(targetFen);
+        Position pos = TextIO::readFEN(fen);
+        std::vector<U64> posHashList { target.zobristHash(), 0, 0 };
+        return Search::canReachDrawRep(pos, posHashList, posHashList.size(), posHashFirstNew);
+    };
+    EXPECT_TRUE(canReach("r3k3/8/8/8/8/8/8/4K3 w - - 0 1", "4k3/8/8/8/r7/8/8/4K3 b - - 3 2"));
+    EXPECT_FALSE(canReach("r3k3/8/8/8/8/8/8/4K3 w - - 0 1", "4k3/8/8/8/r7/8/8/4K3 b - - 2 2"));
+    EXPECT_FALSE(canReach("r3k3/8/8/8/8/8/8/4K3 w - - 0 1", "4k3/8/8/8/r7/8/8/4K3 b - - 3 2", 1));
+    EXPECT_FALSE(canReach("r3k3/8/P7/8/8/8/8/4K3 w - - 0 1", "4k3/8/P7/8/r7/8/8/4K3 b - - 3 2"));
+    EXPECT_FALSE(canReach("4k3/8/8/8/8/8/8/R3K3 w - - 0 1", "4k3/8/8/8/R7/8/8/4K3 b - - 3 2"));
+    EXPECT_TRUE(canReach("4k3/8/8/8/8/8/8/R3K3 b - - 0 1", "4k3/8/8/8/R7/8/8/4K3 w - - 3 2"));
+    EXPECT_TRUE(canReach("4k3/8/8/8/8/8/5N2/4K3 b - - 0 1", "4k3/8/8/8/6N1/8/8/4K3 w - - 3 2"));
+    EXPECT_FALSE(canReach("4k3/8/8/8/8/8/5N2/4K3 b - - 0 1", "4k3/8/8/8/5N2/8/8/4K3 w - - 3 2"));
+
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    std::vector<U64> posHashList;
+    UndoInfo ui;
+    for (const char* ms : { "Nf3", "Nf6", "Ng1" }) {
+        posHashList.push_back(pos.zobristHash());
+        pos.makeMove(TextIO::stringToMove(pos, ms), ui);
+    }
+    EXPECT_TRUE(Search::canReachDrawRep(pos, posHashList, posHashList.size(), 0));
+    posHashList.push_back(pos.zobristHash());
+    pos.makeMove(TextIO::stringToMove(pos, "e6"), ui);
+    EXPECT_FALSE(Search::canReachDrawRep(pos, posHashList, posHashList.size(), 0));
+}
+
+TEST(SearchTest, testPrevSearch) {
+    SearchTest::testPrevSearch();
+}
+
+void
+SearchTest::testPrevSearch() {
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    Search::PrevSearchInfo psi;
+    std::unique_ptr<Search> sc = getSearch(pos);
+    sc->setPrevSearchInfo(&psi);
+    Move bestM = idSearch(*sc, 4);
+    ASSERT_FALSE(psi.pv.empty());
+    EXPECT_EQ(bestM, psi.pv[0]);
+    EXPECT_EQ(psi.pv.size(), psi.pvHashes.size());
+    EXPECT_EQ(pos.zobristHash(), psi.pvHashes[0]);
+    EXPECT_EQ(20, psi.rootMoves.size());
+
+    auto setPrev = [&](const std::vector<std::string>& pv, const std::vector<std::string>& rootMoves) {
+        psi.clear();
+        Position tmpPos = TextIO::readFEN(TextIO::startPosFEN);
+        UndoInfo ui;
+        for (const std::string& ms : pv) {
+            Move m = TextIO::stringToMove(tmpPos, ms);
+            psi.pv.push_back(m);
+            psi.pvHashes.push_back(tmpPos.zobristHash());
+            tmpPos.makeMove(m, ui);
+        }
+        Position rootPos = TextIO::readFEN(TextIO::startPosFEN);
+        for (const std::string& ms : rootMoves)
+            psi.rootMoves.push_back(TextIO::stringToMove(rootPos, ms));
+    };
+    auto getRootMoves = [&](const std::string& moves, int expectedPly) {
+        Position pos = TextIO::readFEN(TextIO::startPosFEN);
+        UndoInfo ui;
+        std::vector<std::string> moveStrs;
+        splitString(moves, moveStrs);
+        for (const std::string& ms : moveStrs)
+            pos.makeMove(TextIO::stringToMove(pos, ms), ui);
+        std::unique_ptr<Search> sc = getSearch(pos);
+        sc->setPrevSearchInfo(&psi);
+        MoveList moves0;
+        MoveGen::pseudoLegalMoves(pos, moves0);
+        MoveGen::removeIllegal(pos, moves0);
+        std::vector<Search::MoveInfo> rootMoves;
+        sc->getRootMoves(moves0, rootMoves, -1);
+        EXPECT_EQ(expectedPly, sc->usePrevSearch(rootMoves));
+        std::vector<std::string> ret;
+        for (const Search::MoveInfo& mi : rootMoves)
+            ret.push_back(TextIO::moveToUCIString(mi.move));
+        return ret;
+    };
+
+    setPrev({ "e4", "e5", "Nf3", "Nc6" }, { "d4", "h3", "e4", "a3" });
+    std::vector<std::string> rootMoves = getRootMoves("", 0);
+    ASSERT_EQ(20, rootMoves.size());
+    EXPECT_EQ("e2e4", rootMoves[0]);
+    EXPECT_EQ("d2d4", rootMoves[1]);
+    EXPECT_EQ("h2h3", rootMoves[2]);
+    EXPECT_EQ("a2a3", rootMoves[3]);
+
+    rootMoves = getRootMoves("e2e4 e7e5", 2);
+    EXPECT_EQ("g1f3", rootMoves[0]);
+    rootMoves = getRootMoves("e2e4 c7c5", -1);
+    EXPECT_NE("g1f3", rootMoves[0]);
+    rootMoves = getRootMoves("e2e4", -1);
+    EXPECT_NE("e7e5", rootMoves[0]);
+}
+
 TEST(SearchTest, testHashing) {
     SearchTest::testHashing();
 }
@@ -334,12 +438,16 @@ SearchTest::testNullMoveVerification() {
     EXPECT_EQ(SearchConst::MATE0-4, bestM.score());
 }
 
-/** Compute SEE(m) and assure that signSEE and negSEE give matching results. */
+/** Compute SEE(m) and assure that signSEE, negSEE and seeGE give matching results. */
 int
 SearchTest::getSEE(Search& sc, const Move& m) {
     const int mate0 = SearchConst::MATE0;
     int see = sc.SEE(m, -mate0, mate0);
 
+    EXPECT_TRUE(sc.seeGE(m, see - 1));
+    EXPECT_TRUE(sc.seeGE(m, see));
+    EXPECT_FALSE(sc.seeGE(m, see + 1));
+
     bool neg = sc.negSEE(m);
     EXPECT_EQ(see < 0, neg);
 
@@ -514,6 +622,39 @@ SearchTest::testSEE() {
     EXPECT_EQ(h1, h2);
 }
 
+TEST(SearchTest, testSEEGE) {
+    SearchTest::testSEEGE();
+}
+
+void
+SearchTest::testSEEGE() {
+    const int mate0 = SearchConst::MATE0;
+    Random rnd(17);
+    int nTested = 0;
+    for (int game = 0; game < 200; game++) {
+        Position pos = TextIO::readFEN(TextIO::startPosFEN);
+        UndoInfo ui;
+        for (int ply = 0; ply < 200; ply++) {
+            MoveList moves;
+            MoveGen::pseudoLegalMoves(pos, moves);
+            for (int i = 0; i < moves.size; i++) {
+                const Move& m = moves[i];
+                int see = Search::SEE(pos, m, -mate0, mate0);
+                for (int t : { see - 1, see, see + 1, -(int)::pV, 0, 1, (int)::pV }) {
+                    ASSERT_EQ(see >= t, Search::seeGE(pos, m, t))
+                        << TextIO::toFEN(pos) << ' ' << TextIO::moveToUCIString(m) << ' ' << t;
+                }
+                nTested++;
+            }
+            MoveGen::removeIllegal(pos, moves);
+            if (moves.size == 0 || pos.getHalfMoveClock() >= 100)
+                break;
+            pos.makeMove(moves[rnd.nextInt(moves.size)], ui);
+        }
+    }
+    EXPECT_GT(nTested, 100000);
+}
+
 TEST(SearchTest, testScoreMoveList) {
     SearchTest::testScoreMoveList();
 }
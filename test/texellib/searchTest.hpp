@@ -42,6 +42,8 @@ public:
     static void testSearch();
     static void testDraw50();
     static void testDrawRep();
+    static void testUpcomingRep();
+    static void testPrevSearch();
     static void testHashing();
     static void testLMP();
     static void testCheckEvasion();
@@ -49,6 +51,7 @@ public:
     static void testKQKRNullMove();
     static void testNullMoveVerification();
     static void testSEE();
+    static void testSEEGE();
     static void testScoreMoveList();
     static void testTBSearch();
     static void testFortress();
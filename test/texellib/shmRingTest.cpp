@@ -0,0 +1,143 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * shmRingTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "shmRing.hpp"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+
+/** Deterministic message contents used by the tests. */
+static int
+msgLen(int msgNo) {
+    return (msgNo * 37) % 1000;
+}
+
+static U8
+msgByte(int msgNo, int i) {
+    return (U8)(msgNo * 7 + i * 13);
+}
+
+TEST(ShmRingTest, testPutGet) {
+    const size_t capacity = 256;
+    SharedMemory shm(ShmRing::memSize(capacity));
+    ShmRing ring(shm.data(), capacity, true);
+
+    U8 buf[256];
+    EXPECT_EQ(-1, ring.get(buf, sizeof(buf)));
+
+    U8 data[100];
+    for (int i = 0; i < 100; i++)
+        data[i] = i;
+    EXPECT_TRUE(ring.put(data, 100));
+    EXPECT_TRUE(ring.put(data, 0));
+    EXPECT_TRUE(ring.put(data, 100));
+    EXPECT_FALSE(ring.put(data, 100)); // Full
+    EXPECT_TRUE(ring.put(data, 30));
+    EXPECT_FALSE(ring.put(data, 1));
+
+    EXPECT_EQ(100, ring.get(buf, sizeof(buf)));
+    for (int i = 0; i < 100; i++)
+        EXPECT_EQ(i, buf[i]);
+    EXPECT_EQ(0, ring.get(buf, sizeof(buf)));
+
+    // Wraps around the end of the buffer
+    EXPECT_TRUE(ring.put(data + 1, 99));
+    EXPECT_EQ(100, ring.get(buf, sizeof(buf)));
+    EXPECT_EQ(30, ring.get(buf, sizeof(buf)));
+    EXPECT_EQ(99, ring.get(buf, 10)); // Truncated
+    for (int i = 0; i < 10; i++)
+        EXPECT_EQ(i + 1, buf[i]);
+    EXPECT_EQ(-1, ring.get(buf, sizeof(buf)));
+
+    for (int n = 0; n < 1000; n++) {
+        int len = n % 200;
+        std::vector<U8> msg(len);
+        for (int i = 0; i < len; i++)
+            msg[i] = msgByte(n, i);
+        ASSERT_TRUE(ring.put(msg.data(), len));
+        ASSERT_EQ(len, ring.get(buf, sizeof(buf)));
+        for (int i = 0; i < len; i++)
+            ASSERT_EQ(msgByte(n, i), buf[i]);
+    }
+}
+
+TEST(ShmRingTest, testMultiProcess) {
+    const size_t capacity = 4096;
+    const size_t memSize = ShmRing::memSize(capacity);
+    SharedMemory shm(2 * memSize);
+    ShmRing(shm.data(), capacity, true);
+    ShmRing(shm.data() + memSize, capacity, true);
+    const int nMsg = 20000;
+
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        // Child process. Verify all messages, then reply with the number of bad messages.
+        ShmRing in(shm.data(), capacity, false);
+        ShmRing out(shm.data() + memSize, capacity, false);
+        std::vector<U8> buf(1000);
+        int nBad = 0;
+        for (int n = 0; n < nMsg; n++) {
+            int len;
+            while ((len = in.get(buf.data(), buf.size())) < 0)
+                sched_yield();
+            bool ok = len == msgLen(n);
+            for (int i = 0; i < len && ok; i++)
+                ok = buf[i] == msgByte(n, i);
+            if (!ok)
+                nBad++;
+        }
+        while (!out.put((const U8*)&nBad, sizeof(nBad)))
+            sched_yield();
+        _exit(0);
+    }
+
+    ShmRing out(shm.data(), capacity, false);
+    ShmRing in(shm.data() + memSize, capacity, false);
+    std::vector<U8> msg(1000);
+    for (int n = 0; n < nMsg; n++) {
+        int len = msgLen(n);
+        for (int i = 0; i < len; i++)
+            msg[i] = msgByte(n, i);
+        while (!out.put(msg.data(), len))
+            sched_yield();
+    }
+    int nBad = -1;
+    while (in.get((U8*)&nBad, sizeof(nBad)) < 0)
+        sched_yield();
+    EXPECT_EQ(0, nBad);
+
+    int status;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+}
+#endif
@@ -25,9 +25,13 @@
 
 #include "tbgenTest.hpp"
 #include "tbgen.hpp"
+#include "tbcache.hpp"
 #include "moveGen.hpp"
 #include "textio.hpp"
 #include "tbprobe.hpp"
+#include "timeUtil.hpp"
+
+#include <filesystem>
 
 #include "gtest/gtest.h"
 
@@ -321,3 +325,94 @@ TBGenTest::testGenerate() {
         testGenerateInternal(pieceCount(0,0,1,1, 0,0,0,0));
     }
 }
+
+TEST(TBGenTest, testGenerateThreads) {
+    TBGenTest::testGenerateThreads();
+}
+
+void
+TBGenTest::testGenerateThreads() {
+    PieceCount pc = pieceCount(0,1,0,0, 0,0,0,1); // KRKN
+    const U32 nPos = TBPosition(pc).nPositions();
+
+    VectorStorage vs1;
+    TBGenerator<VectorStorage> tbGen1(vs1, pc);
+    RelaxedShared<S64> maxTimeMillis(-1);
+    double t0 = currentTime();
+    ASSERT_TRUE(tbGen1.generate(maxTimeMillis, false, 1));
+    double t1 = currentTime();
+    std::cout << "threads: 1 t: " << (t1 - t0) << std::endl;
+
+    for (int nThreads : {2, 4, 8}) {
+        VectorStorage vs;
+        TBGenerator<VectorStorage> tbGen(vs, pc);
+        t0 = currentTime();
+        ASSERT_TRUE(tbGen.generate(maxTimeMillis, false, nThreads));
+        t1 = currentTime();
+        std::cout << "threads: " << nThreads << " t: " << (t1 - t0) << std::endl;
+        for (U32 idx = 0; idx < nPos; idx++)
+            ASSERT_EQ(vs1[idx].getState(), vs[idx].getState()) << "idx:" << idx;
+    }
+
+    TranspositionTable tt(512*1024);
+    TTStorage tts(tt);
+    TBGenerator<TTStorage> tbGenTT(tts, pc);
+    ASSERT_TRUE(tbGenTT.generate(maxTimeMillis, false, 4));
+    for (U32 idx = 0; idx < nPos; idx++)
+        ASSERT_EQ(vs1[idx].getState(), tts[idx].getState()) << "idx:" << idx;
+}
+
+TEST(TBGenTest, testCache) {
+    TBGenTest::testCache();
+}
+
+void
+TBGenTest::testCache() {
+    namespace fs = std::filesystem;
+    const std::string dir = (fs::temp_directory_path() / "texel_tbcache_test").string();
+    fs::remove_all(dir);
+
+    PieceCount krk = pieceCount(0,1,0,0, 0,0,0,0);
+    PieceCount kqk = pieceCount(1,0,0,0, 0,0,0,0);
+    ASSERT_EQ("KRK.tbc", TBCache::fileName(krk));
+    ASSERT_EQ("KQK.tbc", TBCache::fileName(kqk));
+    ASSERT_EQ("KQRKBN.tbc", TBCache::fileName(pieceCount(1,1,0,0, 0,0,1,1)));
+
+    auto generate = [](const PieceCount& pc) {
+        VectorStorage vs;
+        TBGenerator<VectorStorage> tbGen(vs, pc);
+        RelaxedShared<S64> maxTimeMillis(-1);
+        tbGen.generate(maxTimeMillis, false);
+        std::vector<U8> table(TBPosition(pc).nPositions());
+        for (U32 idx = 0; idx < table.size(); idx++)
+            table[idx] = (U8)vs[idx].getState();
+        return table;
+    };
+    std::vector<U8> krkTable = generate(krk);
+    std::vector<U8> kqkTable = generate(kqk);
+
+    MappedStorage ms;
+    ASSERT_FALSE(TBCache::load(dir, krk, ms));
+    ASSERT_FALSE(TBCache::save(dir, krk, krkTable, krkTable.size()));
+    ASSERT_TRUE(TBCache::save(dir, krk, krkTable, 1024*1024));
+    ASSERT_TRUE(TBCache::load(dir, krk, ms));
+    for (U32 idx = 0; idx < krkTable.size(); idx++)
+        ASSERT_EQ(krkTable[idx], (U8)ms[idx].getState());
+    ASSERT_FALSE(TBCache::load(dir, kqk, ms));
+
+    TBGenerator<MappedStorage> tbGen(ms, krk);
+    Position pos = TextIO::readFEN("8/8/8/8/8/2k5/8/K6R b - - 0 1");
+    int score;
+    ASSERT_TRUE(tbGen.probeDTM(pos, 0, score));
+    ASSERT_LT(score, 0);
+
+    // Size limit only allows one table, so KRK is removed when KQK is stored
+    ASSERT_TRUE(TBCache::save(dir, kqk, kqkTable, kqkTable.size() + 100));
+    ASSERT_FALSE(fs::exists(fs::path(dir) / "KRK.tbc"));
+    ASSERT_TRUE(TBCache::load(dir, kqk, ms));
+    for (U32 idx = 0; idx < kqkTable.size(); idx++)
+        ASSERT_EQ(kqkTable[idx], (U8)ms[idx].getState());
+
+    ms.close();
+    fs::remove_all(dir);
+}
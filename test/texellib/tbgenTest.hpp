@@ -35,6 +35,8 @@ public:
     static void testTBPosition();
     static void testMoveGen();
     static void testGenerate();
+    static void testGenerateThreads();
+    static void testCache();
 
 private:
     static void testGenerateInternal(const PieceCount& pc);
@@ -24,6 +24,7 @@
  */
 
 #include "textio.hpp"
+#include "moveGen.hpp"
 
 #include "gtest/gtest.h"
 
@@ -345,6 +346,38 @@ TEST(TextIOTest, testStringToMove) {
     EXPECT_EQ(mNf3, TextIO::stringToMove(pos, "Nf"));
 }
 
+TEST(TextIOTest, testStringToMoveRoundTrip) {
+    // Positions with promotions, en passant captures, castling and pins
+    std::vector<std::string> fens = {
+        TextIO::startPosFEN,
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "1Q6/1K2q2k/1QQ5/8/7P/8/8/8 w - - 3 88",
+        "4k3/8/8/2KpP2r/8/8/8/8 w - d6 0 2",
+    };
+    for (const std::string& fen : fens) {
+        Position pos = TextIO::readFEN(fen);
+        UndoInfo ui;
+        for (int ply = 0; ply < 40; ply++) {
+            MoveList moves;
+            MoveGen::pseudoLegalMoves(pos, moves);
+            MoveGen::removeIllegal(pos, moves);
+            if (moves.size == 0)
+                break;
+            for (int i = 0; i < moves.size; i++) {
+                const Move& m = moves[i];
+                std::string sanStr = TextIO::moveToString(pos, m, false);
+                EXPECT_EQ(m, TextIO::stringToMove(pos, sanStr)) << fen << " " << sanStr;
+                std::string lanStr = TextIO::moveToString(pos, m, true);
+                EXPECT_EQ(m, TextIO::stringToMove(pos, lanStr)) << fen << " " << lanStr;
+            }
+            pos.makeMove(moves[(ply * 7 + 3) % moves.size], ui);
+        }
+    }
+}
+
 TEST(TextIOTest, testGetSquare) {
     EXPECT_EQ(Square(0, 0), TextIO::getSquare("a1"));
     EXPECT_EQ(Square(1, 7), TextIO::getSquare("b8"));
@@ -24,10 +24,13 @@
  */
 
 #include "transpositionTable.hpp"
+#include "clustertt.hpp"
 #include "position.hpp"
 #include "textio.hpp"
 #include "searchTest.hpp"
+#include "random.hpp"
 #include <iostream>
+#include <algorithm>
 
 #include "gtest/gtest.h"
 
@@ -306,3 +309,69 @@ TEST(TranspositionTableTest, testHashFuncBackComp) {
     EXPECT_EQ(0xFE05FCA83AC9EF47ULL, hash1);
     EXPECT_EQ(0x9CCCE083C803D732ULL, hash2);
 }
+
+TEST(TranspositionTableTest, testBatchCodec) {
+    const int mate0 = SearchConst::MATE0;
+    Random rnd(17);
+    for (int n : {0, 1, 2, 100, 700}) {
+        std::vector<TTEntry> ents;
+        int nBits = TTBatchCodec::headerBits;
+        for (int i = 0; i < n; i++) {
+            TTEntry ent;
+            U64 key = rnd.nextU64();
+            if (i == 1)
+                key = 0;
+            if (i == 2)
+                key = ~0ULL;
+            ent.setKey(key);
+            Move m(Square(rnd.nextInt(64)), Square(rnd.nextInt(64)),
+                   rnd.nextInt(8) == 0 ? rnd.nextInt(16) : 0);
+            ent.setMove(m);
+            int score = rnd.nextInt(400) - 200;
+            if (i % 10 == 3)
+                score = mate0 - rnd.nextInt(100);
+            if (i % 10 == 4)
+                score = -(mate0 - rnd.nextInt(100));
+            ent.setScore(score, 0);
+            ent.setDepth(rnd.nextInt(i % 5 == 0 ? 512 : 30));
+            ent.setBusy(rnd.nextInt(2));
+            ent.setGeneration(rnd.nextInt(16));
+            ent.setType(rnd.nextInt(4));
+            ent.setEvalScore(i % 7 == 0 ? SearchConst::UNKNOWN_SCORE : rnd.nextInt(2000) - 1000);
+            ents.push_back(ent);
+            nBits += TTBatchCodec::entryBits(ent);
+        }
+        std::vector<TTEntry> orig = ents;
+
+        std::vector<U8> buf((nBits + 7) / 8 + 8, 0xAA);
+        U8* end = TTBatchCodec::encode(ents, &buf[0]);
+        int len = (int)(end - &buf[0]);
+        EXPECT_LE(len, (nBits + 7) / 8);
+        if (n >= 100) {
+            EXPECT_LT(len, n * 16 * 9 / 10);
+        }
+
+        std::vector<TTEntry> decoded;
+        TTBatchCodec::decode(&buf[0], len, decoded);
+        ASSERT_EQ(n, (int)decoded.size());
+
+        std::sort(orig.begin(), orig.end(), [](const TTEntry& a, const TTEntry& b) {
+            return a.getKey() < b.getKey();
+        });
+        for (int i = 0; i < n; i++) {
+            const TTEntry& e1 = orig[i];
+            const TTEntry& e2 = decoded[i];
+            ASSERT_EQ(e1.getKey(), e2.getKey());
+            Move m1, m2;
+            e1.getMove(m1);
+            e2.getMove(m2);
+            ASSERT_EQ(m1, m2);
+            ASSERT_EQ(e1.getScore(0), e2.getScore(0));
+            ASSERT_EQ(e1.getDepth(), e2.getDepth());
+            ASSERT_EQ(e1.getBusy(), e2.getBusy());
+            ASSERT_EQ(e1.getType(), e2.getType());
+            ASSERT_EQ(e1.getEvalScore(), e2.getEvalScore());
+            ASSERT_EQ(0, e2.getGeneration());
+        }
+    }
+}
@@ -27,6 +27,7 @@
 #include "treeLogger.hpp"
 #include "position.hpp"
 #include "textio.hpp"
+#include "parameters.hpp"
 #include <iostream>
 #include <cstring>
 
@@ -175,3 +176,61 @@ TreeLoggerTest::testLoggerData() {
         EXPECT_EQ(e.ee.hashKey,    e2.ee.hashKey);
     }
 }
+
+TEST(TreeLoggerTest, testSampling) {
+    TreeLoggerTest::testSampling();
+}
+
+void
+TreeLoggerTest::testSampling() {
+    const U64 noNode = TreeLoggerWriter::noNode;
+    Position pos = TextIO::readFEN(TextIO::startPosFEN);
+    Move m;
+
+    TreeLoggerWriter log;
+    log.open("", 0);
+    EXPECT_FALSE(log.isOpened());
+    EXPECT_EQ(noNode, log.logPosition(pos));
+    EXPECT_EQ(noNode, log.logNodeStart(0, m, 0, -100, 100, 1, 3, 0));
+
+    const std::string fileName = "/tmp/treeLoggerTest.dmp";
+    UciParams::treeLogMaxPly->set("3");
+    UciParams::treeLogRootMoves->set("2");
+    log.open(fileName, 0);
+    EXPECT_TRUE(log.isOpened());
+    U64 root = log.logPosition(pos);
+    EXPECT_EQ(0, root);
+    U64 n1 = log.logNodeStart(root, m, 1, -100, 100, 1, 3, 1);
+    EXPECT_NE(noNode, n1);
+    U64 n2 = log.logNodeStart(n1, m, 7, -100, 100, 2, 2, 2);
+    EXPECT_NE(noNode, n2);
+    EXPECT_EQ(noNode, log.peekNextNodeIdx(n2, 3, 0, 3)); // Ply too large
+    EXPECT_EQ(noNode, log.logNodeStart(n2, m, 0, -100, 100, 3, 1, 3));
+    EXPECT_EQ(n2 + 1, log.logNodeEnd(n2, 0, 0, 0, 2));
+    EXPECT_EQ(noNode, log.logNodeStart(root, m, 2, -100, 100, 1, 3, 4)); // Root move too late
+    EXPECT_EQ(noNode, log.logNodeStart(noNode, m, 0, -100, 100, 2, 2, 5));
+    EXPECT_EQ(noNode, log.logNodeEnd(noNode, 0, 0, 0, 5));
+
+    UciParams::treeLogMaxPly->set("0");
+    UciParams::treeLogRootMoves->set("0");
+    UciParams::treeLogSampleBits->set("2");
+    log.open(fileName, 0);
+    root = log.logPosition(pos);
+    EXPECT_EQ(0, root);
+    n1 = log.logNodeStart(root, m, 5, -100, 100, 1, 3, 1);
+    EXPECT_NE(noNode, n1);
+    int nSampled = 0;
+    const int N = 1000;
+    for (int i = 0; i < N; i++) {
+        U64 idx = log.logNodeStart(n1, m, i, -100, 100, 2, 2, i);
+        if (idx != noNode) {
+            nSampled++;
+            log.logNodeEnd(idx, 0, 0, 0, i);
+        }
+    }
+    EXPECT_GT(nSampled, N / 8);
+    EXPECT_LT(nSampled, N / 2);
+    UciParams::treeLogSampleBits->set("0");
+    log.close();
+    ::remove((fileName + ".0").c_str());
+}
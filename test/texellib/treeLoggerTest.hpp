@@ -30,6 +30,7 @@ class TreeLoggerTest {
 public:
     static void testSerialize();
     static void testLoggerData();
+    static void testSampling();
 };
 
 #endif /* TREELOGGERTEST_HPP_ */
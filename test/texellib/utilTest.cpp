@@ -27,6 +27,7 @@
 #include "timeUtil.hpp"
 #include "histogram.hpp"
 #include "nntypes.hpp"
+#include "threadpool.hpp"
 
 #include <iostream>
 #include <memory>
@@ -274,3 +275,48 @@ TEST(UtilTest, nnDataTest) {
 
     ASSERT_EQ(net.weight1.data[0], net2.weight1.data[0]);
 }
+
+TEST(UtilTest, testOrderedPipeline) {
+    for (int nThreads : {1, 2, 4}) {
+        for (int maxPending : {1, 3, 100}) {
+            const int nTasks = 200;
+            int nCreated = 0;
+            std::vector<int> consumed;
+            auto getTask = [&nCreated](std::function<int(int)>& task) {
+                if (nCreated >= nTasks)
+                    return false;
+                int i = nCreated++;
+                task = [i](int workerNo) {
+                    if (i % 7 == 0) // Make tasks finish out of order
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                    return i * i;
+                };
+                return true;
+            };
+            auto consume = [&](int result) {
+                ASSERT_LE((int)consumed.size() + 1, nCreated);
+                ASSERT_LE(nCreated - (int)consumed.size(), maxPending);
+                consumed.push_back(result);
+            };
+            orderedPipeline<int>(nThreads, maxPending, getTask, consume);
+            ASSERT_EQ(nTasks, consumed.size());
+            for (int i = 0; i < nTasks; i++)
+                ASSERT_EQ(i * i, consumed[i]);
+        }
+    }
+
+    // Exceptions in tasks are propagated to the caller
+    int nCreated = 0;
+    auto getTask = [&nCreated](std::function<int(int)>& task) {
+        if (nCreated >= 10)
+            return false;
+        int i = nCreated++;
+        task = [i](int workerNo) -> int {
+            if (i == 5)
+                throw std::runtime_error("task failed");
+            return i;
+        };
+        return true;
+    };
+    EXPECT_THROW(orderedPipeline<int>(2, 4, getTask, [](int) {}), std::runtime_error);
+}
@@ -120,6 +120,33 @@ CspSolverTest::testBitSet() {
         bs2.removeSmaller(0);
         ASSERT_EQ(4, bs2.bitCount());
     }
+    {
+        // orBitCount/unionBitCount must match explicit union, also for
+        // sizes that are not a multiple of the unroll factor
+        constexpr int N = 64*7;
+        BitSet<N> bs[3];
+        for (int i = 0; i < N; i++) {
+            if (i % 3 == 0)
+                bs[0].setBit(i);
+            if (i % 5 == 0)
+                bs[1].setBit(i);
+            if (i % 7 == 0 || i > 400)
+                bs[2].setBit(i);
+        }
+        BitSet<N> u(bs[0]);
+        u |= bs[1];
+        ASSERT_EQ(u.bitCount(), bs[0].orBitCount(bs[1]));
+        u |= bs[2];
+        const BitSet<N>* sets[3] = { &bs[0], &bs[1], &bs[2] };
+        ASSERT_EQ(u.bitCount(), BitSet<N>::unionBitCount(sets, 3));
+        ASSERT_EQ(bs[2].bitCount(), BitSet<N>::unionBitCount(&sets[2], 1));
+        for (int k = 0; k < 3; k++)
+            bs[k].removeLarger(199);
+        u = bs[0];
+        u |= bs[1];
+        u |= bs[2];
+        ASSERT_EQ(u.bitCount(), BitSet<N>::unionBitCount(sets, 3, 200));
+    }
     {
         constexpr int N = 1024;
         BitSet<N> primes;
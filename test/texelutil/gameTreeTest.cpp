@@ -191,3 +191,107 @@ e4 e5 Nf3 Nc6 Bb5 (Bc4 Bc5 c3) (Nc3 Nf6) a6 Ba4
     });
     ASSERT_EQ("1:e4 1:e5 2:Nf3 2:Nc6 3:Bb5 3:a6 4:Ba4 3:Bc4 3:Bc5 4:c3 3:Nc3 3:Nf6", result);
 }
+
+TEST(GameTreeTest, testReadMainLine) {
+    std::string pgn = R"raw(
+[Event "event01"]
+[White "white player"]
+[Black "black player"]
+[Result "0-1"]
+
+{start} 1. e4 {c1} e5! $1 2. Nf3 (2. Nc3 {var} Nf6 (2... Nc6)) {c2}
+Nc6 {c3} {c4} 3. Bb5 a6?! ; line comment
+% escaped line
+4. Ba4 Nf6 5. O-O Be7 0-1
+
+[Event "event02"]
+[FEN "4k3/1P6/8/8/8/8/8/4K3 w - - 0 1"]
+
+1. b8=Q+ Kd7 2. Qb5+ *
+)raw";
+
+    auto check = [](PgnReader& reader, PgnReader& treeReader) {
+        PgnGame game;
+        ASSERT_TRUE(reader.readMainLine(game));
+        EXPECT_EQ(4, game.tagPairs.size());
+        EXPECT_EQ("white player", game.getTag("White"));
+        EXPECT_EQ("?", game.getTag("Site"));
+        EXPECT_EQ(GameTree::BLACK_WIN, game.getResult());
+        EXPECT_EQ(10, game.moves.size());
+        ASSERT_EQ(game.moves.size(), game.comments.size());
+
+        // Main line and comments must agree with the tree parser
+        GameTree gt;
+        ASSERT_TRUE(treeReader.readPGN(gt));
+        GameNode gn = gt.getRootNode();
+        EXPECT_EQ(TextIO::toFEN(gn.getPos()), TextIO::toFEN(game.startPos));
+        for (size_t i = 0; i < game.moves.size(); i++) {
+            ASSERT_GT(gn.nChildren(), 0);
+            gn.goForward(0);
+            EXPECT_EQ(gn.getMove(), game.moves[i]);
+            EXPECT_EQ(gn.getComment(), game.comments[i]);
+        }
+        EXPECT_EQ(0, gn.nChildren());
+        EXPECT_EQ("start c1", game.comments[0]);
+        EXPECT_EQ("c2 c3c4", game.comments[3]);
+        EXPECT_EQ(" line comment", game.comments[5]);
+
+        ASSERT_TRUE(reader.readMainLine(game));
+        EXPECT_EQ("?", game.getTag("Result"));
+        EXPECT_EQ(GameTree::UNKNOWN, game.getResult());
+        EXPECT_EQ("4k3/1P6/8/8/8/8/8/4K3 w - - 0 1", TextIO::toFEN(game.startPos));
+        ASSERT_EQ(3, game.moves.size());
+        EXPECT_EQ(Move(Square(1,6), Square(1,7), Piece::WQUEEN), game.moves[0]);
+
+        EXPECT_FALSE(reader.readMainLine(game));
+    };
+
+    {
+        std::stringstream is(pgn);
+        std::stringstream is2(pgn);
+        PgnReader reader(is);
+        PgnReader treeReader(is2);
+        check(reader, treeReader);
+    }
+    {
+        PgnReader reader(pgn.data(), pgn.size());
+        PgnReader treeReader(pgn.data(), pgn.size());
+        check(reader, treeReader);
+    }
+}
+
+TEST(GameTreeTest, testPgnSplitter) {
+    std::string pgn = R"raw([Event "e1"]
+[White "w[1]"]
+
+1. e4 {[%eval 0.1]} e5 ; [comment
+2. Nf3 1-0
+
+[Event "e2"]
+% [escaped
+1. d4 {"[} d5 *
+[Event "e3"]
+
+1. c4 0-1
+)raw";
+
+    for (size_t chunkSize : {0, 1, 50, 1000}) {
+        PgnSplitter splitter(pgn.data(), pgn.size(), chunkSize);
+        std::string all;
+        std::vector<std::string> events;
+        const char* chunk;
+        size_t len;
+        int nChunks = 0;
+        while (splitter.nextChunk(chunk, len)) {
+            nChunks++;
+            all += std::string(chunk, len);
+            PgnReader reader(chunk, len);
+            PgnGame game;
+            while (reader.readMainLine(game))
+                events.push_back(game.getTag("Event"));
+        }
+        EXPECT_EQ(pgn, all);
+        EXPECT_EQ(chunkSize < 50 ? 3 : (chunkSize < 1000 ? 2 : 1), nChunks);
+        EXPECT_EQ((std::vector<std::string>{"e1", "e2", "e3"}), events);
+    }
+}
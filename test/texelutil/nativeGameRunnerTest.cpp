@@ -0,0 +1,60 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * nativeGameRunnerTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "nativeGameRunnerTest.hpp"
+#include "nativegamerunner.hpp"
+#include "chessError.hpp"
+
+#include "gtest/gtest.h"
+
+TEST(NativeGameRunnerTest, testParseTimeControl) {
+    NativeGameRunnerTest::testParseTimeControl();
+}
+
+void
+NativeGameRunnerTest::testParseTimeControl() {
+    using TimeControl = NativeGameRunner::TimeControl;
+    auto test = [](const std::string& tcStr, int moves, int timeMs, int incMs, int nodes) {
+        TimeControl tc = TimeControl::parse(tcStr);
+        EXPECT_EQ(moves, tc.moves) << tcStr;
+        EXPECT_EQ(timeMs, tc.timeMs) << tcStr;
+        EXPECT_EQ(incMs, tc.incMs) << tcStr;
+        EXPECT_EQ(nodes, tc.nodes) << tcStr;
+    };
+    test("60", 0, 60000, 0, -1);
+    test("0.5", 0, 500, 0, -1);
+    test("10+0.1", 0, 10000, 100, -1);
+    test("3+0", 0, 3000, 0, -1);
+    test("40/60", 40, 60000, 0, -1);
+    test("40/120+1.5", 40, 120000, 1500, -1);
+    test("nodes=1", 0, 0, 0, 1);
+    test("nodes=25000", 0, 0, 0, 25000);
+
+    for (const std::string tcStr : { "", "0", "-1", "abc", "10+", "10+-1", "+1", "/60",
+                                     "0/60", "-5/60", "40/", "40/0", "x/60", "nodes=",
+                                     "nodes=0", "nodes=-100", "nodes=abc" }) {
+        EXPECT_THROW(TimeControl::parse(tcStr), ChessParseError) << tcStr;
+    }
+}
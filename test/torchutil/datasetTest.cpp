@@ -206,3 +206,158 @@ DataSetTest::testSplitData() {
 
     std::remove(fileName.c_str());
 }
+
+TEST(DataSetTest, testMappedDS) {
+    DataSetTest::testMappedDS();
+}
+
+void
+DataSetTest::testMappedDS() {
+    const std::string fileName(".testMappedDS_file");
+    {
+        std::vector<Record> data;
+        Record r;
+        for (int i = 0; i < 100; i++) {
+            initRecord(r, i);
+            data.push_back(r);
+        }
+        writeFileDS(data, fileName);
+    }
+
+    {
+        MappedDataSet ds(fileName);
+        ASSERT_EQ(100, ds.getSize());
+        Record r;
+        for (int i = 99; i >= 0; i--) {
+            ds.getItem(i, r);
+            ASSERT_EQ(i, r.searchScore);
+        }
+        ds.prefetch(10, 20);
+        ds.prefetch(90, 200);
+
+        MemDataSet mDs(ds, [](S64 idx) {
+            return (idx % 2) != 0;
+        });
+        ASSERT_EQ(50, mDs.getSize());
+        for (S64 idx = 0; idx < 50; idx++) {
+            mDs.getItem(idx, r);
+            ASSERT_EQ(idx * 2 + 1, r.searchScore);
+        }
+    }
+
+    std::remove(fileName.c_str());
+}
+
+TEST(DataSetTest, testBlockShuffledDS) {
+    DataSetTest::testBlockShuffledDS();
+}
+
+void
+DataSetTest::testBlockShuffledDS() {
+    MemDataSet mDs;
+    Record r;
+    const int N = 1000;
+    for (int i = 0; i < N; i++) {
+        initRecord(r, i);
+        mDs.addData(r);
+    }
+
+    for (S64 blockSize : {1, 7, 100, 999, 1000, 1001, 5000}) {
+        BlockShuffledDataSet<MemDataSet> shuffled(mDs, blockSize, 4711);
+        ASSERT_EQ(N, shuffled.getSize());
+        ASSERT_EQ(blockSize, shuffled.getBlockSize());
+
+        std::vector<int> v;
+        for (int i = 0; i < N; i++) {
+            shuffled.getItem(i, r);
+            ASSERT_EQ(shuffled.getBaseIdx(i), r.searchScore);
+            // All items in a block come from the same block in the base data set
+            ASSERT_EQ(shuffled.getBaseIdx(i / blockSize * blockSize) / blockSize,
+                      r.searchScore / blockSize);
+            v.push_back(r.searchScore);
+        }
+        std::sort(v.begin(), v.end());
+        for (int i = 0; i < N; i++)
+            ASSERT_EQ(i, v[i]);
+    }
+
+    {
+        BlockShuffledDataSet<MemDataSet> shuffled1(mDs, 100, 1);
+        BlockShuffledDataSet<MemDataSet> shuffled2(mDs, 100, 2);
+        int nDiff = 0;
+        for (int i = 0; i < N; i++)
+            if (shuffled1.getBaseIdx(i) != shuffled2.getBaseIdx(i))
+                nDiff++;
+        ASSERT_GT(nDiff, N / 2);
+    }
+}
+
+TEST(DataSetTest, testMappedSplitData) {
+    DataSetTest::testMappedSplitData();
+}
+
+void
+DataSetTest::testMappedSplitData() {
+    const std::string fileName(".testMappedSplitData_file");
+    const int N = 2000;
+    {
+        std::vector<Record> data;
+        Record r;
+        for (int i = 0; i < N; i++) {
+            initRecord(r, i);
+            data.push_back(r);
+        }
+        writeFileDS(data, fileName);
+    }
+
+    {
+        // Validation data is the same as for SplitData
+        FileDataSet fDs(fileName);
+        SplitData split(fDs, 10);
+        MemDataSet validate;
+        split.getData(0, -1, nullptr, -1, nullptr, &validate);
+
+        MappedDataSet ds(fileName);
+        MappedSplitData mSplit(ds, 10, 64);
+        ASSERT_EQ(split.numTrainData(), mSplit.numTrainData());
+        ASSERT_EQ(10, mSplit.getBatchSize());
+        MemDataSet mValidate;
+        mSplit.getValidateData(mValidate);
+        ASSERT_EQ(N / 10, mValidate.getSize());
+        ASSERT_EQ(validate.getSize(), mValidate.getSize());
+        std::vector<bool> isValidate(N);
+        Record r1, r2;
+        for (S64 i = 0; i < validate.getSize(); i++) {
+            validate.getItem(i, r1);
+            mValidate.getItem(i, r2);
+            ASSERT_EQ(r1.searchScore, r2.searchScore);
+            isValidate[r1.searchScore] = true;
+        }
+
+        // Each epoch returns all training data exactly once
+        for (U64 seed : {1, 2}) {
+            auto shuffled = mSplit.shuffledData(seed);
+            std::vector<int> v;
+            MemDataSet batch;
+            S64 pos = 0;
+            while (pos < shuffled->getSize()) {
+                pos = mSplit.getTrainBatch(*shuffled, pos, batch);
+                ASSERT_GT(batch.getSize(), 0);
+                ASSERT_LE(batch.getSize(), 10);
+                for (S64 i = 0; i < batch.getSize(); i++) {
+                    batch.getItem(i, r1);
+                    ASSERT_FALSE(isValidate[r1.searchScore]);
+                    v.push_back(r1.searchScore);
+                }
+                if (pos < shuffled->getSize()) {
+                    ASSERT_EQ(10, batch.getSize());
+                }
+            }
+            ASSERT_EQ(mSplit.numTrainData(), (S64)v.size());
+            std::sort(v.begin(), v.end());
+            ASSERT_EQ(v.end(), std::adjacent_find(v.begin(), v.end()));
+        }
+    }
+
+    std::remove(fileName.c_str());
+}
@@ -32,6 +32,9 @@ public:
     static void testFileDS();
     static void testShuffledDS();
     static void testSplitData();
+    static void testMappedDS();
+    static void testBlockShuffledDS();
+    static void testMappedSplitData();
 };
 
 #endif /* DATASETTEST_HPP_ */
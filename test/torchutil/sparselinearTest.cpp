@@ -0,0 +1,77 @@
+/*
+    Texel - A UCI chess engine.
+    Copyright (C) 2026  Peter Österlund, peterosterlund2@gmail.com
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/*
+ * sparselinearTest.cpp
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: petero
+ */
+
+#include "sparselinearTest.hpp"
+#include "sparselinear.hpp"
+
+#include <tuple>
+
+#include "gtest/gtest.h"
+
+TEST(SparseLinearTest, testForwardBackward) {
+    SparseLinearTest::testForwardBackward();
+}
+
+void
+SparseLinearTest::testForwardBackward() {
+    torch::manual_seed(1234);
+    // Large sizes use more than one at::parallel_for chunk
+    for (auto [batchSize, nIn, nOut] : { std::make_tuple(7, 20, 5),
+                                         std::make_tuple(600, 300, 40) }) {
+        const int nIdx = 8;
+
+        // Random active features padded with -1. Features can occur more than once.
+        torch::Tensor idx = torch::randint(0, nIn, {batchSize, nIdx}, torch::kInt32);
+        torch::Tensor x = torch::zeros({batchSize, nIn});
+        {
+            auto idxAcc = idx.accessor<int,2>();
+            auto xAcc = x.accessor<float,2>();
+            for (int b = 0; b < batchSize; b++) {
+                int nActive = b % (nIdx + 1); // Includes rows with only padding
+                for (int i = 0; i < nIdx; i++) {
+                    if (i < nActive)
+                        xAcc[b][idxAcc[b][i]] += 1;
+                    else
+                        idxAcc[b][i] = -1;
+                }
+            }
+        }
+
+        torch::Tensor w = torch::randn({nIn, nOut}).requires_grad_(true);
+        torch::Tensor wRef = w.detach().clone().requires_grad_(true);
+
+        torch::Tensor out = SparseLinearFunction::apply(idx, w);
+        torch::Tensor outRef = torch::mm(x, wRef);
+        ASSERT_EQ(outRef.sizes(), out.sizes());
+        EXPECT_TRUE(torch::allclose(out, outRef, 1e-5, 1e-5));
+
+        torch::Tensor gradOut = torch::randn({batchSize, nOut});
+        (out * gradOut).sum().backward();
+        (outRef * gradOut).sum().backward();
+        ASSERT_EQ(wRef.grad().sizes(), w.grad().sizes());
+        EXPECT_TRUE(torch::allclose(w.grad(), wRef.grad(), 1e-4, 1e-4));
+    }
+}